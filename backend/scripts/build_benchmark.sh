@@ -0,0 +1,33 @@
+#!/bin/bash
+
+# Optimised native benchmarks (extra flags are passed on, e.g. -march=native)
+g++ -std=c++17 -O2 \
+    -Iglm \
+    -Isrc \
+    -Isrc/implement \
+    "$@" \
+    -o build/rdp_benchmark \
+    src/benchmark/rdp_benchmark.cpp || exit 1
+
+g++ -std=c++17 -O2 \
+    -Iglm \
+    -Isrc \
+    -Isrc/implement \
+    "$@" \
+    -o build/engine_benchmark \
+    src/benchmark/engine_benchmark.cpp \
+    src/implement/DrawingEngine/DrawingEngine.cpp \
+    src/implement/OperationalTransform/OperationLog.cpp \
+    src/implement/CrdtDocument/CrdtDocument.cpp
+
+g++ -std=c++17 -O2 -pthread \
+    -Iglm \
+    -Isrc \
+    -Isrc/implement \
+    "$@" \
+    -o build/room_benchmark \
+    src/benchmark/room_benchmark.cpp \
+    src/implement/DrawingEngine/DrawingEngine.cpp \
+    src/implement/CrdtDocument/CrdtDocument.cpp \
+    src/implement/RoomServer/RoomServer.cpp \
+    src/implement/RoomServer/SendQueue.cpp
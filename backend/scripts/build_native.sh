@@ -1,11 +1,16 @@
 #!/bin/bash
 
 # Native build script for testing C++ code
-g++ -std=c++17 \
+g++ -std=c++17 -pthread \
     -I/opt/homebrew/Cellar/glm/1.0.1/include \
     -Iglm \
     -Isrc \
     -Isrc/implement \
     -o build/test_native \
     src/main.cpp \
-    src/implement/DrawingEngine/DrawingEngine.cpp
+    src/implement/DrawingEngine/DrawingEngine.cpp \
+    src/implement/OperationalTransform/OperationLog.cpp \
+    src/implement/CrdtDocument/CrdtDocument.cpp \
+    src/implement/RoomServer/RoomServer.cpp \
+    src/implement/RoomServer/SendQueue.cpp \
+    src/implement/Rasterizer/Rasterizer.cpp
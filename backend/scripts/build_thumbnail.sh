@@ -0,0 +1,12 @@
+#!/bin/bash
+
+# Native board preview renderer (build/thumbnail); extra flags are passed on
+g++ -std=c++17 -O2 -pthread \
+    -Iglm \
+    -Isrc \
+    -Isrc/implement \
+    "$@" \
+    -o build/thumbnail \
+    src/thumbnail/thumbnail.cpp \
+    src/implement/Rasterizer/Rasterizer.cpp \
+    src/implement/DrawingEngine/DrawingEngine.cpp
@@ -7,6 +7,8 @@ emcc -std=c++17 \
      -Isrc/implement \
      -s USE_WEBGPU=1 \
      -s ALLOW_MEMORY_GROWTH=1 \
+     -s WASM_BIGINT=1 \
+     -msimd128 \
      -s EXPORTED_RUNTIME_METHODS='["ccall","cwrap"]' \
      -s MODULARIZE=1 \
      -s EXPORT_NAME="DrawingEngineModule" \
@@ -14,6 +16,8 @@ emcc -std=c++17 \
      --bind \
      src/bindings.cpp \
      src/implement/DrawingEngine/DrawingEngine.cpp \
+     src/implement/OperationalTransform/OperationLog.cpp \
+     src/implement/CrdtDocument/CrdtDocument.cpp \
      -o build/drawing_engine.js
 
 # Copy to frontend/public if build succeeded
@@ -0,0 +1,433 @@
+#include "DrawingEngine/DrawingEngine.hpp"
+#include "OperationalTransform/OperationLog.hpp"
+#include "CrdtDocument/CrdtDocument.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+
+// Micro-benchmarks for the DrawingEngine hot paths on synthetic boards.
+//
+//   build/engine_benchmark [--max-strokes N] [--points N] [--mutations N]
+//                          [--budget-ms N] [--label TEXT] [--json FILE]
+//
+// Boards grow by 10x from 1k strokes. Mutating operations run a fixed number
+// of times so every run sees the same board; read-only ones repeat until the
+// time budget is spent. Reports ns/op, heap allocations and bytes per op
+// (counted by replacing global operator new) and peak RSS. --json writes the
+// same numbers for comparing runs across commits, e.g.
+// --label "$(git rev-parse --short HEAD)".
+//
+// The OperationLog cases process one room's ops; the target is 100k ops/s
+// per room, i.e. under 10000 ns/op.
+
+namespace {
+
+std::atomic<size_t> allocationCount{0};
+std::atomic<size_t> allocationBytes{0};
+
+void* allocate(size_t size, size_t alignment = 0) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocationBytes.fetch_add(size, std::memory_order_relaxed);
+    if (size == 0) size = 1;
+    void* p = nullptr;
+    if (alignment <= alignof(std::max_align_t)) {
+        p = std::malloc(size);
+    } else if (posix_memalign(&p, alignment, size) != 0) {
+        p = nullptr;
+    }
+    return p;
+}
+
+// Kept out of line so GCC pairs each delete with the replaced new, not
+// with the malloc behind it
+__attribute__((noinline)) void release(void* p) noexcept { std::free(p); }
+
+} // namespace
+
+// Every replaceable form, so no allocation skips the count and every delete
+// matches its new
+void* operator new(size_t size) {
+    if (void* p = allocate(size)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new(size_t size, std::align_val_t alignment) {
+    if (void* p = allocate(size, size_t(alignment))) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size, std::align_val_t alignment) { return operator new(size, alignment); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocate(size, size_t(alignment));
+}
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocate(size, size_t(alignment));
+}
+
+void operator delete(void* p) noexcept { release(p); }
+void operator delete[](void* p) noexcept { release(p); }
+void operator delete(void* p, size_t) noexcept { release(p); }
+void operator delete[](void* p, size_t) noexcept { release(p); }
+void operator delete(void* p, std::align_val_t) noexcept { release(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { release(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { release(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { release(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { release(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { release(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { release(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { release(p); }
+
+namespace {
+
+struct Options {
+    size_t maxStrokes = 1000000;
+    size_t pointsPerStroke = 16;
+    size_t mutations = 1000;
+    double budgetMs = 250.0;
+    std::string label;
+    std::string jsonPath;
+};
+
+struct Result {
+    std::string name;
+    size_t strokes;
+    size_t iterations;
+    double nsPerOp;
+    double allocsPerOp;
+    double bytesPerOp;
+};
+
+long peakRssKb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;  // bytes on macOS
+#else
+    return usage.ru_maxrss;         // kilobytes on Linux
+#endif
+}
+
+// Runs op(i) until the time budget or maxIterations runs out (at least once).
+// The clock is read between doubling batches so cheap ops are not skewed by it.
+template<typename Op>
+Result measure(const std::string& name, size_t strokes, size_t maxIterations, double budgetMs, Op op) {
+    size_t allocsBefore = allocationCount;
+    size_t bytesBefore = allocationBytes;
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::duration<double, std::milli>(budgetMs);
+
+    size_t i = 0;
+    for (size_t batch = 1;; batch = std::min<size_t>(batch * 2, 1024)) {
+        for (size_t k = 0; k < batch && i < maxIterations; k++) op(i++);
+        if (i >= maxIterations || std::chrono::steady_clock::now() >= deadline) break;
+    }
+
+    double elapsedNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    return {name, strokes, i, elapsedNs / i,
+            double(allocationCount - allocsBefore) / i, double(allocationBytes - bytesBefore) / i};
+}
+
+StrokeShape randomStroke(std::mt19937& rng, size_t points) {
+    std::uniform_real_distribution<float> position(0.0f, 100000.0f);
+    std::uniform_real_distribution<float> step(-4.0f, 4.0f);
+    std::vector<Point> path;
+    path.reserve(points);
+    float x = position(rng), y = position(rng);
+    for (size_t i = 0; i < points; i++) {
+        path.emplace_back(x, y);
+        x += step(rng);
+        y += step(rng);
+    }
+    return StrokeShape(Color(0.1f, 0.2f, 0.3f, 1.0f), 2.0f, path);
+}
+
+void runBoard(size_t strokes, const Options& options, std::vector<Result>& results) {
+    std::mt19937 rng(1234);
+    std::vector<StrokeShape> input;
+    input.reserve(strokes);
+    for (size_t i = 0; i < strokes; i++) input.push_back(randomStroke(rng, options.pointsPerStroke));
+
+    // Each stroke's last point, so appended points stay next to their stroke
+    std::vector<Point> tips;
+    tips.reserve(strokes);
+    for (const StrokeShape& stroke : input) tips.push_back(stroke.pointAt(stroke.pointCount() - 1));
+
+    DrawingEngine engine;
+    results.push_back(measure("addStroke", strokes, strokes, 1e12, [&](size_t i) {
+        engine.addStroke(input[i]);
+    }));
+    input.clear();
+    input.shrink_to_fit();
+
+    results.push_back(measure("getVertexBufferData", strokes, 1000, options.budgetMs, [&](size_t) {
+        volatile size_t size = engine.getVertexBufferData().size();
+        (void)size;
+    }));
+    results.push_back(measure("getStrokes", strokes, 1000, options.budgetMs, [&](size_t) {
+        volatile size_t size = engine.getStrokes().size();
+        (void)size;
+    }));
+    std::uniform_real_distribution<float> anywhere(0.0f, 100000.0f);
+    results.push_back(measure("hitTest", strokes, 1000000, options.budgetMs, [&](size_t) {
+        volatile size_t size = engine.hitTest(anywhere(rng), anywhere(rng), 50.0f).size();
+        (void)size;
+    }));
+
+    // Mutations go through the by-id API and extend strokes the way a pen
+    // does, a few units past their last point
+    size_t mutations = std::min(options.mutations, strokes / 2);
+    std::vector<ShapeId> ids = engine.getShapeIds();
+    std::uniform_int_distribution<size_t> anyStroke(0, strokes - 1);
+    std::uniform_real_distribution<float> step(-4.0f, 4.0f);
+    auto extend = [&](size_t stroke) {
+        tips[stroke] = Point(tips[stroke].x + step(rng), tips[stroke].y + step(rng));
+        return tips[stroke];
+    };
+    results.push_back(measure("addPointToStrokeById", strokes, mutations, 1e12, [&](size_t) {
+        size_t stroke = anyStroke(rng);
+        engine.addPointToStrokeById(ids[stroke], extend(stroke));
+    }));
+    // One 32-point live frame per op, decoded and applied in a single call
+    std::vector<std::vector<uint8_t>> packets;
+    for (size_t i = 0; i < mutations; i++) {
+        PointFrameWriter writer;
+        size_t stroke = anyStroke(rng);
+        for (int k = 0; k < 32; k++) writer.add(ids[stroke], extend(stroke), uint32_t(k * 4));
+        packets.push_back(writer.take());
+    }
+    results.push_back(measure("applyPointFrames/32pts", strokes, mutations, 1e12, [&](size_t i) {
+        engine.applyPointFrames(packets[i].data(), packets[i].size());
+    }));
+    // The same 32 points as ring records, handed over with one applyBatch()
+    engine.initCommandRing(1 << 12);
+    CommandWriter commands(engine.getCommandRing());
+    results.push_back(measure("applyBatch/32pts", strokes, mutations, 1e12, [&](size_t) {
+        size_t stroke = anyStroke(rng);
+        for (int k = 0; k < 32; k++) {
+            Point at = extend(stroke);
+            commands.addPoint(ids[stroke], at.x, at.y);
+        }
+        engine.applyBatch();
+    }));
+    results.push_back(measure("moveShapeById", strokes, mutations, 1e12, [&](size_t) {
+        engine.moveShapeById(ids[anyStroke(rng)], 1.0f, -1.0f);
+    }));
+    // The index-based API for comparison: a slot scan before the same move
+    results.push_back(measure("moveStroke/legacy", strokes, mutations, 1e12, [&](size_t) {
+        engine.moveStroke(static_cast<int>(anyStroke(rng)), 1.0f, -1.0f);
+    }));
+
+    // History on: one recorded move, then undone and redone, by id so the
+    // cost is the change's and not a walk of the board
+    engine.setHistoryBudget(64u << 20);
+    results.push_back(measure("move+undo+redo", strokes, mutations, 1e12, [&](size_t) {
+        engine.moveShapeById(ids[rng() % ids.size()], 1.0f, -1.0f);
+        engine.undo();
+        engine.redo();
+    }));
+    // Dragging a 1000-shape selection: one pass and one merged op per event
+    engine.selectIds(std::vector<ShapeId>(ids.begin(), ids.begin() + std::min<size_t>(1000, ids.size())));
+    results.push_back(measure("moveSelection/1000", strokes, mutations, 1e12, [&](size_t) {
+        engine.moveSelection(1.0f, -1.0f);
+    }));
+    engine.clearSelection();
+    engine.setHistoryBudget(0);
+
+    results.push_back(measure("removeShapeById", strokes, mutations, 1e12, [&](size_t i) {
+        std::swap(ids[rng() % (strokes - i)], ids[strokes - i - 1]);
+        engine.removeShapeById(ids[strokes - i - 1]);
+    }));
+}
+
+void runSimplify(size_t points, const Options& options, std::vector<Result>& results) {
+    std::mt19937 rng(99);
+    StrokeShape stroke = randomStroke(rng, points);
+    std::vector<Point> path = stroke.getPoints();
+    results.push_back(measure("RDP::simplify/" + std::to_string(points) + "pts", 1, 100000, options.budgetMs, [&](size_t) {
+        volatile size_t size = RDP::simplify(path, 1.0f).size();
+        (void)size;
+    }));
+}
+
+// A board of strokes, rectangles and ellipses in equal parts: per-shape
+// dispatch dominates these loops
+void runMixed(size_t count, const Options& options, std::vector<Result>& results) {
+    std::mt19937 rng(4321);
+    std::uniform_real_distribution<float> position(0.0f, 100000.0f);
+    std::uniform_real_distribution<float> size(2.0f, 40.0f);
+    DrawingEngine engine;
+    for (size_t i = 0; i < count; i++) {
+        Color color(0.1f, 0.2f, 0.3f, 1.0f);
+        Point at(position(rng), position(rng));
+        if (i % 3 == 0) {
+            engine.addStroke(randomStroke(rng, options.pointsPerStroke));
+        } else if (i % 3 == 1) {
+            engine.addShape(std::make_unique<RectangleShape>(at, Point(at.x + size(rng), at.y + size(rng)), color, 2.0f));
+        } else {
+            engine.addShape(std::make_unique<EllipseShape>(at, size(rng), size(rng), color, 2.0f));
+        }
+    }
+    engine.takeGpuBufferUpdate();
+
+    results.push_back(measure("getVertexBufferData/mixed", count, 1000, options.budgetMs, [&](size_t) {
+        volatile size_t size = engine.getVertexBufferData().size();
+        (void)size;
+    }));
+    results.push_back(measure("hitTest/mixed", count, 1000000, options.budgetMs, [&](size_t) {
+        volatile size_t size = engine.hitTest(position(rng), position(rng), 50.0f).size();
+        (void)size;
+    }));
+    // Every shape rewritten: recolor all, then one GPU sync
+    std::vector<ShapeId> ids = engine.getShapeIds();
+    engine.selectIds(ids);
+    results.push_back(measure("recolorAll+gpuSync/mixed", count, 1000, options.budgetMs, [&](size_t i) {
+        engine.recolorSelection(Color(float(i % 2), 0.0f, 0.0f, 1.0f));
+        volatile size_t ranges = engine.takeGpuBufferUpdate().vertexRanges.size();
+        (void)ranges;
+    }));
+}
+
+// Drag events on one huge stroke and on a dot; lazy transforms make them equal
+void runDrag(const Options& options, std::vector<Result>& results) {
+    std::mt19937 rng(7);
+    DrawingEngine engine;
+    ShapeId big = engine.addStroke(randomStroke(rng, 10000));
+    ShapeId dot = engine.addStroke(randomStroke(rng, 1));
+    for (ShapeId id : {big, dot}) {
+        std::string name = id == big ? "drag/10000pts" : "drag/1pt";
+        results.push_back(measure(name, 2, 1000000, options.budgetMs, [&](size_t) {
+            engine.moveShapeById(id, 0.5f, -0.5f);
+        }));
+    }
+}
+
+// One room with 8 users editing 256 strokes. Senders trail the head by up
+// to `maxLag` versions, so each op is transformed against that many
+void runOperationLog(uint64_t maxLag, const Options& options, std::vector<Result>& results) {
+    std::mt19937 rng(11);
+    OperationLog log(1024);
+    const OperationType types[] = {OperationType::StrokeUpdate, OperationType::StrokeUpdate, OperationType::StrokeUpdate,
+                                   OperationType::StrokeCreate, OperationType::StrokeDelete, OperationType::CursorMove};
+    results.push_back(measure("OperationLog::process/lag" + std::to_string(maxLag), 256, 10000000, options.budgetMs,
+                              [&](size_t i) {
+        uint64_t lag = std::min<uint64_t>(rng() % (maxLag + 1), log.currentVersion());
+        Operation op(types[rng() % 6], rng() % 8, rng() % 256, i, log.currentVersion() - lag);
+        log.process(op);
+    }));
+}
+
+// 8 replicas ink strokes (create, then appends of 4 points) and recolor
+// concurrently; a ninth merges their ops as a relay interleaves them
+void runCrdtMerge(std::vector<Result>& results) {
+    constexpr int Writers = 8;
+    constexpr size_t OpsPerWriter = 2500;
+    std::mt19937 rng(21);
+    std::uniform_real_distribution<float> position(0.0f, 10000.0f);
+    std::uniform_real_distribution<float> step(-4.0f, 4.0f);
+    std::vector<DrawingEngine> engines(Writers);
+    std::vector<std::vector<uint8_t>> packets;
+    std::vector<std::vector<std::vector<uint8_t>>> perWriter(Writers);
+    for (int w = 0; w < Writers; w++) {
+        CrdtDocument writer(engines[w], w + 1);
+        ElementId stroke;
+        Point at;
+        for (size_t i = 0; i < OpsPerWriter; i++) {
+            at = Point(at.x + step(rng), at.y + step(rng));
+            if (i % 16 == 0) {
+                at = Point(position(rng), position(rng));
+                stroke = writer.createStroke(Color(0.1f, 0.2f, 0.3f, 1.0f), 2.0f, {at});
+            } else if (i % 16 == 15) {
+                writer.setColor(stroke, Color(0.5f, 0.0f, 0.0f, 1.0f));
+            } else {
+                writer.appendPoints(stroke, {at, Point(at.x + 1, at.y), Point(at.x + 2, at.y), Point(at.x + 3, at.y)});
+            }
+            perWriter[w].push_back(writer.takeOps());
+        }
+    }
+    for (size_t i = 0; i < OpsPerWriter; i++) {
+        for (int w = 0; w < Writers; w++) packets.push_back(std::move(perWriter[w][i]));
+    }
+
+    DrawingEngine engine;
+    CrdtDocument reader(engine, Writers + 1);
+    results.push_back(measure("CrdtDocument::apply/8writers", Writers * OpsPerWriter / 16, packets.size(), 1e12,
+                              [&](size_t i) {
+        reader.applyEncoded(packets[i].data(), packets[i].size());
+    }));
+}
+
+void writeJson(const Options& options, const std::vector<Result>& results, long rssKb) {
+    FILE* out = fopen(options.jsonPath.c_str(), "w");
+    if (!out) {
+        fprintf(stderr, "Cannot write %s\n", options.jsonPath.c_str());
+        return;
+    }
+    fprintf(out, "{\n  \"label\": \"%s\",\n  \"pointsPerStroke\": %zu,\n  \"mutations\": %zu,\n"
+                 "  \"peakRssKb\": %ld,\n  \"results\": [\n",
+            options.label.c_str(), options.pointsPerStroke, options.mutations, rssKb);
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        fprintf(out, "    {\"name\": \"%s\", \"strokes\": %zu, \"iterations\": %zu, \"nsPerOp\": %.1f, "
+                     "\"allocsPerOp\": %.3f, \"bytesPerOp\": %.1f}%s\n",
+                r.name.c_str(), r.strokes, r.iterations, r.nsPerOp, r.allocsPerOp, r.bytesPerOp,
+                i + 1 < results.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+    fclose(out);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        if (flag == "--max-strokes") options.maxStrokes = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (flag == "--points") options.pointsPerStroke = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (flag == "--mutations") options.mutations = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (flag == "--budget-ms") options.budgetMs = std::strtod(argv[i + 1], nullptr);
+        else if (flag == "--label") options.label = argv[i + 1];
+        else if (flag == "--json") options.jsonPath = argv[i + 1];
+        else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (options.pointsPerStroke < 2) options.pointsPerStroke = 2;
+
+    std::vector<Result> results;
+    for (size_t strokes = 1000; strokes <= options.maxStrokes; strokes *= 10) {
+        runBoard(strokes, options, results);
+    }
+    for (size_t count = 1000; count <= options.maxStrokes; count *= 10) {
+        runMixed(count, options, results);
+    }
+    for (size_t points : {1000, 10000, 100000}) {
+        runSimplify(points, options, results);
+    }
+    runDrag(options, results);
+    for (uint64_t lag : {16, 1000}) {
+        runOperationLog(lag, options, results);
+    }
+    runCrdtMerge(results);
+    long rssKb = peakRssKb();
+
+    printf("%-24s %10s %10s %14s %12s %12s\n", "operation", "strokes", "iters", "ns/op", "allocs/op", "bytes/op");
+    for (const Result& r : results) {
+        printf("%-24s %10zu %10zu %14.1f %12.2f %12.1f\n",
+               r.name.c_str(), r.strokes, r.iterations, r.nsPerOp, r.allocsPerOp, r.bytesPerOp);
+    }
+    printf("peak RSS: %.1f MB\n", rssKb / 1024.0);
+
+    if (!options.jsonPath.empty()) writeJson(options, results, rssKb);
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include "draw.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// Compares the iterative SIMD RDP against the recursive version it replaced.
+// Build with scripts/build_benchmark.sh; pass a point count to run just that size.
+
+namespace {
+
+// The previous implementation, kept verbatim as the baseline
+std::vector<Point> legacySimplify(const std::vector<Point>& points, float epsilon) {
+    if (points.size() <= 2) return points;
+
+    float maxDistance = 0;
+    size_t maxIndex = 0;
+
+    for (size_t i = 1; i < points.size() - 1; i++) {
+        float distance = RDP::pointToLineDistance(points[i], points[0], points[points.size() - 1]);
+        if (distance > maxDistance) {
+            maxDistance = distance;
+            maxIndex = i;
+        }
+    }
+
+    if (maxDistance > epsilon) {
+        std::vector<Point> firstHalf(points.begin(), points.begin() + maxIndex + 1);
+        std::vector<Point> secondHalf(points.begin() + maxIndex, points.end());
+
+        auto firstResult = legacySimplify(firstHalf, epsilon);
+        auto secondResult = legacySimplify(secondHalf, epsilon);
+
+        firstResult.pop_back();
+        firstResult.insert(firstResult.end(), secondResult.begin(), secondResult.end());
+        return firstResult;
+    } else {
+        return {points[0], points[points.size() - 1]};
+    }
+}
+
+// A pen-like random walk: smooth heading changes plus a little jitter
+std::vector<Point> randomStroke(size_t count, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> turn(0.0f, 0.15f);
+    std::normal_distribution<float> jitter(0.0f, 0.3f);
+    std::vector<Point> points;
+    points.reserve(count);
+    float x = 0, y = 0, heading = 0;
+    for (size_t i = 0; i < count; i++) {
+        heading += turn(rng);
+        x += std::cos(heading) * 2.0f + jitter(rng);
+        y += std::sin(heading) * 2.0f + jitter(rng);
+        points.emplace_back(x, y);
+    }
+    return points;
+}
+
+template<typename F>
+double bestOfMs(int runs, F f) {
+    double best = 1e300;
+    for (int r = 0; r < runs; r++) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
+
+const char* kernelName() {
+#if defined(__wasm_simd128__)
+    return "wasm-simd128";
+#elif defined(__AVX2__)
+    return "AVX2";
+#elif defined(__SSE2__)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes = {10000, 100000, 1000000};
+    if (argc > 1) sizes = {static_cast<size_t>(std::strtoull(argv[1], nullptr, 10))};
+    const float epsilon = 1.0f;
+    bool allMatch = true;
+
+    printf("RDP benchmark (kernel: %s, epsilon %.1f, best of 5)\n", kernelName(), epsilon);
+    printf("%10s %12s %12s %12s %9s %8s\n", "points", "kept", "legacy ms", "new ms", "in-place", "speedup");
+
+    for (size_t n : sizes) {
+        std::vector<Point> stroke = randomStroke(n, 42);
+        size_t legacyKept = 0, kept = 0;
+
+        double legacyMs = bestOfMs(5, [&] { legacyKept = legacySimplify(stroke, epsilon).size(); });
+        double newMs = bestOfMs(5, [&] { kept = RDP::simplify(stroke, epsilon).size(); });
+
+        std::vector<float> xs(n), ys(n);
+        double inPlaceMs = bestOfMs(5, [&] {
+            for (size_t i = 0; i < n; i++) {
+                xs[i] = stroke[i].x;
+                ys[i] = stroke[i].y;
+            }
+            RDP::simplifyInPlace(xs.data(), ys.data(), n, epsilon);
+        });
+
+        printf("%10zu %12zu %12.2f %12.2f %9.2f %7.1fx\n", n, kept, legacyMs, newMs, inPlaceMs, legacyMs / newMs);
+        if (kept != legacyKept) {
+            printf("  note: legacy kept %zu points (float rounding differs near epsilon)\n", legacyKept);
+            allMatch = allMatch && (kept > legacyKept ? kept - legacyKept : legacyKept - kept) * 1000 < legacyKept;
+        }
+    }
+    return allMatch ? 0 : 1;
+}
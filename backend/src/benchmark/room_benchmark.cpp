@@ -0,0 +1,256 @@
+#include "RoomServer/RoomServer.hpp"
+#include "CrdtDocument/CrdtDocument.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+
+// Load run for the native room server over in-process connections.
+//
+//   build/room_benchmark [--connections N] [--rooms N] [--shards N]
+//                        [--frames N] [--senders N] [--slow PERCENT]
+//                        [--cursor-hz N]
+//
+// Opens N connections spread evenly over the rooms, then replays
+// pre-encoded CRDT op frames (a pen stroke being inked, 4 points per
+// frame) from --senders transport threads. Every room's frames go through
+// one sender thread, in order, rotating over the room's members. Peers drain
+// their outbox as soon as it is ready and only count what they get, so the
+// numbers are the server's own cost: frames in/s, frames out/s (fan-out)
+// and RSS per connection. --slow connections never read until the end,
+// which shows their queues staying bounded. --cursor-hz moves every
+// connection's cursor at that rate while the ops run, to compare op
+// throughput with and without presence traffic. The target is 10k
+// connections per node.
+
+namespace {
+
+struct Options {
+    size_t connections = 10000;
+    size_t rooms = 500;
+    unsigned shards = 0;
+    size_t frames = 200000;
+    unsigned senders = 2;
+    double slowPercent = 0;
+    double cursorHz = 0;
+};
+
+long peakRssKb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;  // bytes on macOS
+#else
+    return usage.ru_maxrss;         // kilobytes on Linux
+#endif
+}
+
+struct Totals {
+    std::atomic<uint64_t> frames{0};
+    std::atomic<uint64_t> welcomes{0};
+    std::atomic<uint64_t> bytes{0};
+};
+
+// Drains on the worker thread that signals it, like a transport whose
+// socket is always writable; a slow one never drains by itself
+struct CountingPeer : Peer {
+    CountingPeer(Totals& totals, bool slow) : totals(totals), slow(slow) {}
+
+    void ready() override {
+        if (!slow) drain();
+    }
+
+    void drain() {
+        thread_local std::vector<RoomProtocol::SharedFrame> frames;
+        frames.clear();
+        session->outbox.drain(frames);
+        for (const RoomProtocol::SharedFrame& frame : frames) {
+            if ((*frame)[0] == RoomProtocol::Welcome) totals.welcomes++;
+            totals.bytes += frame->size();
+        }
+        totals.frames += frames.size();
+        frames.clear();
+    }
+
+    Totals& totals;
+    std::atomic<bool> slow;
+    Session* session = nullptr;
+};
+
+// One replica's strokes as Ops frames
+std::vector<std::vector<uint8_t>> encodeFrames(size_t count, uint32_t replicaId, std::mt19937& rng) {
+    std::uniform_real_distribution<float> position(0.0f, 10000.0f);
+    std::uniform_real_distribution<float> step(-4.0f, 4.0f);
+    DrawingEngine engine;
+    CrdtDocument writer(engine, replicaId);
+    std::vector<std::vector<uint8_t>> frames;
+    frames.reserve(count);
+    ElementId stroke;
+    Point at;
+    for (size_t i = 0; i < count; i++) {
+        at = Point(at.x + step(rng), at.y + step(rng));
+        if (i % 32 == 0) {
+            at = Point(position(rng), position(rng));
+            stroke = writer.createStroke(Color(0.1f, 0.2f, 0.3f, 1.0f), 2.0f, {at});
+        } else {
+            writer.appendPoints(stroke, {at, Point(at.x + 1, at.y), Point(at.x + 2, at.y), Point(at.x + 3, at.y)});
+        }
+        std::vector<uint8_t> ops = writer.takeOps();
+        frames.push_back(RoomProtocol::frame(RoomProtocol::Ops, ops.data(), ops.size()));
+    }
+    return frames;
+}
+
+template<typename Done>
+bool waitFor(Done done, double timeoutMs) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double, std::milli>(timeoutMs);
+    while (!done()) {
+        if (std::chrono::steady_clock::now() >= deadline) return false;
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        if (flag == "--connections") options.connections = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (flag == "--rooms") options.rooms = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (flag == "--shards") options.shards = unsigned(std::strtoul(argv[i + 1], nullptr, 10));
+        else if (flag == "--frames") options.frames = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (flag == "--senders") options.senders = unsigned(std::strtoul(argv[i + 1], nullptr, 10));
+        else if (flag == "--slow") options.slowPercent = std::strtod(argv[i + 1], nullptr);
+        else if (flag == "--cursor-hz") options.cursorHz = std::strtod(argv[i + 1], nullptr);
+        else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (options.rooms == 0) options.rooms = 1;
+    if (options.connections < options.rooms) options.connections = options.rooms;
+    if (options.senders == 0) options.senders = 1;
+
+    // Frames per room, encoded up front so the run measures only the server
+    std::mt19937 rng(23);
+    size_t framesPerRoom = std::max<size_t>(1, options.frames / options.rooms);
+    std::vector<std::vector<std::vector<uint8_t>>> roomFrames;
+    roomFrames.reserve(options.rooms);
+    for (size_t r = 0; r < options.rooms; r++) roomFrames.push_back(encodeFrames(framesPerRoom, uint32_t(r + 1), rng));
+
+    ServerOptions serverOptions;
+    serverOptions.shards = options.shards;
+    RoomServer server(serverOptions);
+    Totals totals;
+
+    long rssBefore = peakRssKb();
+    std::vector<std::vector<std::shared_ptr<Session>>> members(options.rooms);
+    std::vector<std::shared_ptr<CountingPeer>> slowPeers;
+    size_t slowEvery = options.slowPercent > 0 ? std::max<size_t>(1, size_t(100.0 / options.slowPercent)) : 0;
+    auto joinStart = std::chrono::steady_clock::now();
+    for (size_t c = 0; c < options.connections; c++) {
+        size_t room = c % options.rooms;
+        // Slow peers still read their Welcome, then stop
+        auto peer = std::make_shared<CountingPeer>(totals, false);
+        members[room].push_back(server.open(peer));
+        peer->session = members[room].back().get();
+        if (slowEvery && c % slowEvery == slowEvery - 1) slowPeers.push_back(peer);
+        std::vector<uint8_t> join = RoomProtocol::join("room-" + std::to_string(room));
+        server.receive(members[room].back(), join.data(), join.size());
+    }
+    if (!waitFor([&] { return totals.welcomes == options.connections; }, 30000)) {
+        fprintf(stderr, "Timed out waiting for welcomes\n");
+        return 1;
+    }
+    double joinMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - joinStart).count();
+    long rssJoined = peakRssKb();
+    for (const std::shared_ptr<CountingPeer>& peer : slowPeers) peer->slow = true;
+
+    // Each Ops frame is pushed to every other member of its room
+    uint64_t expectedOut = totals.frames;
+    for (size_t r = 0; r < options.rooms; r++) expectedOut += framesPerRoom * (members[r].size() - 1);
+    uint64_t framesIn = framesPerRoom * options.rooms;
+
+    // One thread plays every connection's mouse, a round per 1/cursorHz
+    std::atomic<bool> sending{true};
+    std::thread cursors;
+    if (options.cursorHz > 0) {
+        cursors = std::thread([&] {
+            auto round = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(1.0 / options.cursorHz));
+            auto next = std::chrono::steady_clock::now();
+            for (uint32_t k = 0; sending; k++) {
+                for (size_t r = 0; r < options.rooms; r++) {
+                    for (size_t m = 0; m < members[r].size(); m++) {
+                        std::vector<uint8_t> frame = RoomProtocol::cursor(uint32_t(m), float(k % 1000), float(m));
+                        server.receive(members[r][m], frame.data(), frame.size());
+                    }
+                }
+                next += round;
+                std::this_thread::sleep_until(next);
+            }
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> senders;
+    for (unsigned t = 0; t < options.senders; t++) {
+        senders.emplace_back([&, t] {
+            for (size_t i = 0; i < framesPerRoom; i++) {
+                for (size_t r = t; r < options.rooms; r += options.senders) {
+                    const std::vector<uint8_t>& frame = roomFrames[r][i];
+                    server.receive(members[r][i % members[r].size()], frame.data(), frame.size());
+                }
+            }
+        });
+    }
+    for (std::thread& sender : senders) sender.join();
+    if (!waitFor([&] { return server.stats().opsApplied >= framesIn; }, 120000)) {
+        fprintf(stderr, "Timed out: %llu of %llu ops applied\n",
+                (unsigned long long)server.stats().opsApplied, (unsigned long long)framesIn);
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    sending = false;
+    if (cursors.joinable()) cursors.join();
+    if (!waitFor([&] { return server.stats().framesOut >= expectedOut; }, 120000)) {
+        fprintf(stderr, "Timed out: %llu of %llu frames pushed\n",
+                (unsigned long long)server.stats().framesOut, (unsigned long long)expectedOut);
+        return 1;
+    }
+    ServerStats stats = server.stats();
+    server.stop();
+    size_t slowBacklog = 0;
+    for (const std::shared_ptr<CountingPeer>& peer : slowPeers) {
+        slowBacklog = std::max(slowBacklog, peer->session->outbox.size());
+        peer->drain();
+    }
+
+    printf("connections %zu, rooms %zu, shards %u, senders %u\n",
+           options.connections, options.rooms, server.shardCount(), options.senders);
+    printf("join:        %.1f ms for all connections\n", joinMs);
+    printf("frames in:   %llu (%.0f/s), ops applied %llu\n",
+           (unsigned long long)framesIn, framesIn / seconds, (unsigned long long)stats.opsApplied);
+    printf("frames out:  %llu (%.0f/s), %llu written, %.1f MB\n", (unsigned long long)stats.framesOut,
+           (stats.framesOut - options.connections) / seconds, (unsigned long long)totals.frames.load(),
+           totals.bytes / (1024.0 * 1024.0));
+    if (options.cursorHz > 0) {
+        printf("presence:    %llu cursors in, %llu snapshots\n",
+               (unsigned long long)stats.cursorsIn, (unsigned long long)stats.presenceTicks);
+    }
+    if (!slowPeers.empty()) {
+        printf("slow peers:  %zu, largest backlog %zu frames, %llu coalesced, %llu resyncs\n", slowPeers.size(),
+               slowBacklog, (unsigned long long)stats.coalesced, (unsigned long long)stats.resyncs);
+    }
+    printf("RSS per connection: %.1f KB (peak RSS %.1f MB)\n",
+           double(rssJoined - rssBefore) / options.connections, peakRssKb() / 1024.0);
+    return 0;
+}
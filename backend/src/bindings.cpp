@@ -1,10 +1,35 @@
 #include <emscripten/bind.h>
+#include <emscripten/heap.h>
 #include "./implement/DrawingEngine/DrawingEngine.hpp"
+#include "./implement/OperationalTransform/OperationLog.hpp"
+#include "./implement/CrdtDocument/CrdtDocument.hpp"
 #include "./implement/shape.hpp"
 #include "./implement/stroke_shape.hpp"
 
 using namespace emscripten;
 
+// Growing WASM memory detaches every typed-memory view at once, so fold heap
+// growth into the generation JS compares against (both only ever increase).
+static uint32_t heapGrowthEpoch() {
+    static size_t lastHeapSize = 0;
+    static uint32_t epoch = 0;
+    size_t heapSize = emscripten_get_heap_size();
+    if (heapSize != lastHeapSize) {
+        lastHeapSize = heapSize;
+        epoch++;
+    }
+    return epoch;
+}
+
+// Flat [x0, y0, x1, y1, ...] from JS
+static std::vector<Point> pointsFromXY(const val& xy) {
+    std::vector<float> flat = convertJSArrayToNumberVector<float>(xy);
+    std::vector<Point> points;
+    points.reserve(flat.size() / 2);
+    for (size_t i = 0; i + 1 < flat.size(); i += 2) points.emplace_back(flat[i], flat[i + 1]);
+    return points;
+}
+
 EMSCRIPTEN_BINDINGS(drawing_module) {
     // Color bindings
     value_object<Color>("Color")
@@ -18,6 +43,63 @@ EMSCRIPTEN_BINDINGS(drawing_module) {
     .field("x", &Point::x)
     .field("y", &Point::y);
 
+    // Bounding boxes / query rectangles
+    value_object<AABB>("AABB")
+    .field("minX", &AABB::minX)
+    .field("minY", &AABB::minY)
+    .field("maxX", &AABB::maxX)
+    .field("maxY", &AABB::maxY);
+
+    // Per-shape affine transforms (canvas setTransform layout)
+    value_object<Affine>("Affine")
+    .field("a", &Affine::a)
+    .field("b", &Affine::b)
+    .field("c", &Affine::c)
+    .field("d", &Affine::d)
+    .field("tx", &Affine::tx)
+    .field("ty", &Affine::ty);
+
+    // Persistent GPU buffer updates
+    value_object<DirtyRange>("DirtyRange")
+    .field("offset", &DirtyRange::offset)
+    .field("size", &DirtyRange::size);
+
+    value_object<GpuBufferUpdate>("GpuBufferUpdate")
+    .field("vertexRanges", &GpuBufferUpdate::vertexRanges)
+    .field("drawCommandRanges", &GpuBufferUpdate::drawCommandRanges)
+    .field("vertexByteLength", &GpuBufferUpdate::vertexByteLength)
+    .field("drawCommandByteLength", &GpuBufferUpdate::drawCommandByteLength)
+    .field("fullUpload", &GpuBufferUpdate::fullUpload);
+
+    // Stroke tessellation style
+    enum_<JoinStyle>("JoinStyle")
+    .value("Miter", JoinStyle::Miter)
+    .value("Round", JoinStyle::Round)
+    .value("Bevel", JoinStyle::Bevel);
+
+    enum_<CapStyle>("CapStyle")
+    .value("Butt", CapStyle::Butt)
+    .value("Round", CapStyle::Round)
+    .value("Square", CapStyle::Square);
+
+    value_object<TessellationStyle>("TessellationStyle")
+    .field("join", &TessellationStyle::join)
+    .field("cap", &TessellationStyle::cap)
+    .field("miterLimit", &TessellationStyle::miterLimit)
+    .field("arcTolerance", &TessellationStyle::arcTolerance);
+
+    // Encodes one point frame for sending (timestamps may be empty)
+    function("encodePointFrame", optional_override([](ShapeId strokeId, const std::vector<Point>& points,
+                                                      const std::vector<uint32_t>& timestamps) {
+        PointFrame frame;
+        frame.strokeId = strokeId;
+        frame.points = points;
+        frame.timestamps = timestamps;
+        std::vector<uint8_t> bytes;
+        PointFrameCodec::encode(frame, bytes);
+        return val::global("Uint8Array").new_(typed_memory_view(bytes.size(), bytes.data()));
+    }));
+
     // ShapeType enum
     enum_<ShapeType>("ShapeType")
     .value("Stroke", ShapeType::Stroke)
@@ -29,6 +111,8 @@ EMSCRIPTEN_BINDINGS(drawing_module) {
         .constructor<const Color&, float>()
         .constructor<const Color&, float, const std::vector<Point>&>()
         .property("points", &StrokeShape::points)
+        .function("getPoints", &StrokeShape::getPoints)
+        .function("pointCount", &StrokeShape::pointCount)
         .function("getColor", &StrokeShape::getColor)
         .function("getThickness", &StrokeShape::getThickness)
         .function("simplify", &StrokeShape::simplify);
@@ -36,12 +120,113 @@ EMSCRIPTEN_BINDINGS(drawing_module) {
     // Binding stroke and point vectors
     register_vector<Point>("PointVector");
     register_vector<StrokeShape>("StrokeVector");
+    register_vector<ShapeId>("ShapeIdVector");
+    register_vector<uint32_t>("Uint32Vector");
+    register_vector<DirtyRange>("DirtyRangeVector");
+
+    // Operational transform core, the same rules the room server runs
+    enum_<OperationType>("OperationType")
+    .value("Noop", OperationType::Noop)
+    .value("StrokeCreate", OperationType::StrokeCreate)
+    .value("StrokeUpdate", OperationType::StrokeUpdate)
+    .value("StrokeDelete", OperationType::StrokeDelete)
+    .value("CursorMove", OperationType::CursorMove)
+    .value("Selection", OperationType::Selection)
+    .value("ClearAll", OperationType::ClearAll);
+
+    value_object<Operation>("Operation")
+    .field("version", &Operation::version)
+    .field("baseVersion", &Operation::baseVersion)
+    .field("timestamp", &Operation::timestamp)
+    .field("strokeId", &Operation::strokeId)
+    .field("userId", &Operation::userId)
+    .field("payload", &Operation::payload)
+    .field("type", &Operation::type)
+    .field("transforms", &Operation::transforms);
+
+    register_vector<Operation>("OperationVector");
+    function("transformOperation", &OT::transform);
+    // Rewrites `pending` in place; returns the op to apply locally
+    function("rebaseOperation", optional_override([](const Operation& incoming, std::vector<Operation>& pending) {
+        return OT::rebase(incoming, pending);
+    }));
+
+    // process/since return null when the base version is out of the log's window
+    class_<OperationLog>("OperationLog")
+        .constructor<size_t>()
+        .function("process", optional_override([](OperationLog& log, Operation op) {
+            return log.process(op) ? val(op) : val::null();
+        }))
+        .function("append", &OperationLog::append)
+        .function("since", optional_override([](const OperationLog& log, uint64_t version) {
+            std::vector<Operation> ops;
+            return log.since(version, ops) ? val(ops) : val::null();
+        }))
+        .function("currentVersion", &OperationLog::currentVersion)
+        .function("oldestVersion", &OperationLog::oldestVersion)
+        .function("size", &OperationLog::size)
+        .function("canTransform", &OperationLog::canTransform)
+        .function("reset", &OperationLog::reset);
+
+    // CRDT document mode: edits go through the document, which drives the
+    // engine; op packets are Uint8Arrays for any transport
+    value_object<ElementId>("ElementId")
+    .field("counter", &ElementId::counter)
+    .field("replica", &ElementId::replica);
+
+    register_vector<ElementId>("ElementIdVector");
+
+    class_<CrdtDocument>("CrdtDocument")
+        .constructor<DrawingEngine&, uint32_t>()
+        .function("replicaId", &CrdtDocument::replicaId)
+        .function("clock", &CrdtDocument::clock)
+        .function("createStroke", optional_override([](CrdtDocument& doc, const Color& color, float thickness, const val& xy) {
+            return doc.createStroke(color, thickness, pointsFromXY(xy));
+        }))
+        .function("createRectangle", &CrdtDocument::createRectangle)
+        .function("createEllipse", &CrdtDocument::createEllipse)
+        .function("appendPoints", optional_override([](CrdtDocument& doc, const ElementId& stroke, const val& xy) {
+            return doc.appendPoints(stroke, pointsFromXY(xy));
+        }))
+        .function("setColor", &CrdtDocument::setColor)
+        .function("setThickness", &CrdtDocument::setThickness)
+        .function("setTransform", &CrdtDocument::setTransform)
+        .function("moveShape", &CrdtDocument::moveShape)
+        .function("deleteShape", &CrdtDocument::deleteShape)
+        .function("applyOps", optional_override([](CrdtDocument& doc, const val& bytes) {
+            std::vector<uint8_t> data = convertJSArrayToNumberVector<uint8_t>(bytes);
+            return doc.applyEncoded(data.data(), data.size());
+        }))
+        .function("takeOps", optional_override([](CrdtDocument& doc) {
+            std::vector<uint8_t> bytes = doc.takeOps();
+            return val::global("Uint8Array").new_(typed_memory_view(bytes.size(), bytes.data()));
+        }))
+        .function("hasPendingOps", &CrdtDocument::hasPendingOps)
+        .function("encodeState", optional_override([](const CrdtDocument& doc) {
+            std::vector<uint8_t> bytes = doc.encodeState();
+            return val::global("Uint8Array").new_(typed_memory_view(bytes.size(), bytes.data()));
+        }))
+        .function("hasShape", &CrdtDocument::hasShape)
+        .function("shapeCount", &CrdtDocument::shapeCount)
+        .function("getShapeIds", &CrdtDocument::getShapeIds)
+        .function("engineId", &CrdtDocument::engineId)
+        .function("elementId", &CrdtDocument::elementId)
+        .function("getTransform", &CrdtDocument::getTransform);
 
     // Draw engine Binding
     class_<DrawingEngine>("DrawingEngine")
         .constructor<>()
         .function("addShape", &DrawingEngine::addShape)
         .function("addStroke", &DrawingEngine::addStroke)
+        // Rectangles and ellipses render through the same vertex and GPU buffers as strokes
+        .function("addRectangle", optional_override([](DrawingEngine& engine, const Point& topLeft, const Point& bottomRight,
+                                                       const Color& color, float thickness) {
+            return engine.addShape(std::make_unique<RectangleShape>(topLeft, bottomRight, color, thickness));
+        }))
+        .function("addEllipse", optional_override([](DrawingEngine& engine, const Point& center, float radiusX, float radiusY,
+                                                     const Color& color, float thickness) {
+            return engine.addShape(std::make_unique<EllipseShape>(center, radiusX, radiusY, color, thickness));
+        }))
         .function("addPointToStroke", &DrawingEngine::addPointToStroke)
         .function("removeShape", &DrawingEngine::removeShape)
         .function("removeStroke", &DrawingEngine::removeStroke)
@@ -50,5 +235,119 @@ EMSCRIPTEN_BINDINGS(drawing_module) {
         .function("clear", &DrawingEngine::clear)
         .function("getStrokes", &DrawingEngine::getStrokes)
         .function("getVertexBufferData", &DrawingEngine::getVertexBufferData)
-        .function("simplifyStroke", &DrawingEngine::simplifyStroke);
+        // Zero-copy Float32Array over the engine's packed vertex data. Valid
+        // until the next engine call; re-create it when getViewGeneration()
+        // changes.
+        .function("getVertexBufferView", optional_override([](DrawingEngine& engine) {
+            const auto& vertices = engine.getVertexBufferView();
+            return val(typed_memory_view(vertices.size(), vertices.data()));
+        }))
+        .function("getViewGeneration", optional_override([](const DrawingEngine& engine) {
+            return engine.getViewGeneration() + heapGrowthEpoch();
+        }))
+        .function("getContentVersion", &DrawingEngine::getContentVersion)
+        // Viewport-culled, level-of-detail vertex output (zoom = pixels per world unit)
+        .function("getVertexBufferDataForViewport", &DrawingEngine::getVertexBufferDataForViewport)
+        .function("getVertexBufferViewForViewport", optional_override([](DrawingEngine& engine, const AABB& viewport, float zoom) {
+            const auto& vertices = engine.getVertexBufferViewForViewport(viewport, zoom);
+            return val(typed_memory_view(vertices.size(), vertices.data()));
+        }))
+        // Triangulated strokes: [x, y, r, g, b, a] vertices plus uint32 triangle indices
+        .function("setTessellationStyle", &DrawingEngine::setTessellationStyle)
+        .function("getTessellationStyle", &DrawingEngine::getTessellationStyle)
+        .function("getTessellationVertexView", optional_override([](DrawingEngine& engine) {
+            const auto& mesh = engine.getTessellation();
+            return val(typed_memory_view(mesh.vertices.size(), mesh.vertices.data()));
+        }))
+        .function("getTessellationIndexView", optional_override([](DrawingEngine& engine) {
+            const auto& mesh = engine.getTessellation();
+            return val(typed_memory_view(mesh.indices.size(), mesh.indices.data()));
+        }))
+        .function("getStrokeMeshVertexView", optional_override([](DrawingEngine& engine, ShapeId id) {
+            const auto& mesh = engine.getStrokeMesh(id);
+            return val(typed_memory_view(mesh.vertices.size(), mesh.vertices.data()));
+        }))
+        .function("getStrokeMeshIndexView", optional_override([](DrawingEngine& engine, ShapeId id) {
+            const auto& mesh = engine.getStrokeMesh(id);
+            return val(typed_memory_view(mesh.indices.size(), mesh.indices.data()));
+        }))
+        // Batched mutations: write records into the ring view (see
+        // CommandBuffer.hpp / frontend commandRing.ts), then applyBatch once
+        .function("initCommandRing", &DrawingEngine::initCommandRing)
+        .function("getCommandRingView", optional_override([](DrawingEngine& engine) {
+            auto& words = engine.getCommandRing().words;
+            return val(typed_memory_view(words.size(), words.data()));
+        }))
+        .function("applyBatch", &DrawingEngine::applyBatch)
+        .function("getRejectedStrokes", &DrawingEngine::getRejectedStrokes)
+        .function("recolorShapeById", &DrawingEngine::recolorShapeById)
+        // Lazy transforms; bake idle ones from a timer or on pointer up
+        .function("transformShapeById", &DrawingEngine::transformShapeById)
+        .function("scaleShapeById", &DrawingEngine::scaleShapeById)
+        .function("rotateShapeById", &DrawingEngine::rotateShapeById)
+        .function("getShapeTransform", &DrawingEngine::getShapeTransform)
+        .function("bakeTransforms", &DrawingEngine::bakeTransforms)
+        // Undo/redo; recording starts once a byte budget is set
+        .function("setHistoryBudget", &DrawingEngine::setHistoryBudget)
+        .function("getHistoryBytes", &DrawingEngine::getHistoryBytes)
+        .function("undo", &DrawingEngine::undo)
+        .function("redo", &DrawingEngine::redo)
+        .function("canUndo", &DrawingEngine::canUndo)
+        .function("canRedo", &DrawingEngine::canRedo)
+        .function("beginHistoryGroup", &DrawingEngine::beginHistoryGroup)
+        .function("endHistoryGroup", &DrawingEngine::endHistoryGroup)
+        .function("clearHistory", &DrawingEngine::clearHistory)
+        // Live point frames (PointFrameCodec); one call per received packet
+        .function("applyPointFrames", optional_override([](DrawingEngine& engine, const val& bytes) {
+            std::vector<uint8_t> data = convertJSArrayToNumberVector<uint8_t>(bytes);
+            return engine.applyPointFrames(data.data(), data.size());
+        }))
+        // Binary snapshots: save returns a JS-owned Uint8Array copy
+        .function("saveSnapshot", optional_override([](const DrawingEngine& engine, float quantum) {
+            std::vector<uint8_t> bytes = engine.saveSnapshot(quantum);
+            return val::global("Uint8Array").new_(typed_memory_view(bytes.size(), bytes.data()));
+        }))
+        .function("loadSnapshot", optional_override([](DrawingEngine& engine, const val& bytes) {
+            std::vector<uint8_t> data = convertJSArrayToNumberVector<uint8_t>(bytes);
+            return engine.loadSnapshot(data.data(), data.size());
+        }))
+        .function("simplifyStroke", &DrawingEngine::simplifyStroke)
+        // Stable-ID API (ids are 64-bit, surfaced to JS as BigInt)
+        .function("hasShape", &DrawingEngine::hasShape)
+        .function("addPointToStrokeById", &DrawingEngine::addPointToStrokeById)
+        .function("removeShapeById", &DrawingEngine::removeShapeById)
+        .function("moveShapeById", &DrawingEngine::moveShapeById)
+        .function("simplifyStrokeById", &DrawingEngine::simplifyStrokeById)
+        .function("beginStrokeSimplification", &DrawingEngine::beginStrokeSimplification)
+        .function("endStrokeSimplification", &DrawingEngine::endStrokeSimplification)
+        .function("getStrokeId", &DrawingEngine::getStrokeId)
+        .function("getShapeIds", &DrawingEngine::getShapeIds)
+        // Spatial queries (eraser, selection, viewport culling)
+        .function("queryRect", &DrawingEngine::queryRect)
+        .function("hitTest", &DrawingEngine::hitTest)
+        .function("getShapeBounds", &DrawingEngine::getShapeBounds)
+        .function("getBoardBounds", &DrawingEngine::getBoardBounds)
+        // Selection and its bulk edits (one undo step each)
+        .function("selectByRect", &DrawingEngine::selectByRect)
+        .function("selectByLasso", optional_override([](DrawingEngine& engine, const val& xy, bool additive) {
+            return engine.selectByLasso(pointsFromXY(xy), additive);
+        }))
+        .function("selectIds", &DrawingEngine::selectIds)
+        .function("clearSelection", &DrawingEngine::clearSelection)
+        .function("getSelection", &DrawingEngine::getSelection)
+        .function("moveSelection", &DrawingEngine::moveSelection)
+        .function("transformSelection", &DrawingEngine::transformSelection)
+        .function("recolorSelection", &DrawingEngine::recolorSelection)
+        .function("deleteSelection", &DrawingEngine::deleteSelection)
+        // Incremental GPU upload: take the update, then writeBuffer each range
+        // out of these views (byte offsets index into the views' buffers)
+        .function("takeGpuBufferUpdate", &DrawingEngine::takeGpuBufferUpdate)
+        .function("getGpuVertexView", optional_override([](DrawingEngine& engine) {
+            const auto& vertices = engine.getGpuVertices();
+            return val(typed_memory_view(vertices.size(), vertices.data()));
+        }))
+        .function("getGpuDrawCommandView", optional_override([](DrawingEngine& engine) {
+            const auto& commands = engine.getGpuDrawCommands();
+            return val(typed_memory_view(commands.size(), commands.data()));
+        }));
 }
\ No newline at end of file
@@ -0,0 +1,397 @@
+#include "CrdtDocument.hpp"
+#include <algorithm>
+
+namespace {
+
+bool isRegisterWrite(CrdtOpType type) {
+    return type == CrdtOpType::SetColor || type == CrdtOpType::SetThickness || type == CrdtOpType::SetTransform;
+}
+
+} // namespace
+
+CrdtDocument::CrdtDocument(DrawingEngine& engine, uint32_t replicaId) : engine(engine), replica(replicaId) {}
+
+// ---- Local edits ----
+
+ElementId CrdtDocument::nextId() {
+    return ElementId(++lamport, replica);
+}
+
+CrdtOp CrdtDocument::localOp(CrdtOpType type, ElementId shape) {
+    CrdtOp op;
+    op.type = type;
+    op.id = nextId();
+    op.shape = type == CrdtOpType::CreateShape ? op.id : shape;
+    return op;
+}
+
+// Applies a local op and queues it. A register write replaces a queued
+// write to the same register: nobody has seen the older one yet.
+ElementId CrdtDocument::submit(CrdtOp op) {
+    for (Point& p : op.points) p = CrdtCodec::snap(p);
+    apply(op);
+    if (!outbox.empty() && isRegisterWrite(op.type) && outbox.back().type == op.type && outbox.back().shape == op.shape) {
+        outbox.back() = std::move(op);
+    } else {
+        outbox.push_back(std::move(op));
+    }
+    return outbox.back().id;
+}
+
+ElementId CrdtDocument::createStroke(const Color& color, float thickness, const std::vector<Point>& points) {
+    CrdtOp op = localOp(CrdtOpType::CreateShape, ElementId());
+    op.shapeType = ShapeType::Stroke;
+    op.color = color;
+    op.thickness = thickness;
+    op.points = points;
+    return submit(std::move(op));
+}
+
+ElementId CrdtDocument::createRectangle(const Point& topLeft, const Point& bottomRight, const Color& color, float thickness) {
+    CrdtOp op = localOp(CrdtOpType::CreateShape, ElementId());
+    op.shapeType = ShapeType::Rectangle;
+    op.color = color;
+    op.thickness = thickness;
+    op.points = {topLeft, bottomRight};
+    return submit(std::move(op));
+}
+
+ElementId CrdtDocument::createEllipse(const Point& center, float radiusX, float radiusY, const Color& color, float thickness) {
+    CrdtOp op = localOp(CrdtOpType::CreateShape, ElementId());
+    op.shapeType = ShapeType::Ellipse;
+    op.color = color;
+    op.thickness = thickness;
+    op.points = {center, Point(radiusX, radiusY)};
+    return submit(std::move(op));
+}
+
+bool CrdtDocument::appendPoints(ElementId stroke, const std::vector<Point>& points) {
+    DocShape* state = live(stroke);
+    if (!state || state->type != ShapeType::Stroke) return false;
+    if (points.empty()) return true;
+
+    // Inking sends a point at a time: grow the queued create or append
+    // while its run is still the stroke's last
+    if (!outbox.empty()) {
+        CrdtOp& queued = outbox.back();
+        bool extends = queued.shape == stroke &&
+                       (queued.type == CrdtOpType::AppendPoints || queued.type == CrdtOpType::CreateShape) &&
+                       !state->runs.empty() && state->runs.back().id == queued.id;
+        if (extends) {
+            std::vector<Point> snapped;
+            snapped.reserve(points.size());
+            for (const Point& p : points) snapped.push_back(CrdtCodec::snap(p));
+            queued.points.insert(queued.points.end(), snapped.begin(), snapped.end());
+            state->runs.back().points.insert(state->runs.back().points.end(), snapped.begin(), snapped.end());
+            appendToEngine(*state, snapped);
+            return true;
+        }
+    }
+    CrdtOp op = localOp(CrdtOpType::AppendPoints, stroke);
+    op.points = points;
+    submit(std::move(op));
+    return true;
+}
+
+bool CrdtDocument::setColor(ElementId shape, const Color& color) {
+    if (!live(shape)) return false;
+    CrdtOp op = localOp(CrdtOpType::SetColor, shape);
+    op.color = color;
+    submit(std::move(op));
+    return true;
+}
+
+bool CrdtDocument::setThickness(ElementId shape, float thickness) {
+    if (!live(shape)) return false;
+    CrdtOp op = localOp(CrdtOpType::SetThickness, shape);
+    op.thickness = thickness;
+    submit(std::move(op));
+    return true;
+}
+
+bool CrdtDocument::setTransform(ElementId shape, const Affine& transform) {
+    if (!live(shape)) return false;
+    CrdtOp op = localOp(CrdtOpType::SetTransform, shape);
+    op.transform = transform;
+    submit(std::move(op));
+    return true;
+}
+
+bool CrdtDocument::moveShape(ElementId shape, float dx, float dy) {
+    DocShape* state = live(shape);
+    return state && setTransform(shape, state->transform.value.then(Affine::translation(dx, dy)));
+}
+
+bool CrdtDocument::deleteShape(ElementId shape) {
+    if (!live(shape)) return false;
+    submit(localOp(CrdtOpType::DeleteShape, shape));
+    return true;
+}
+
+// ---- Merging ----
+
+bool CrdtDocument::apply(const CrdtOp& op) {
+    if (!op.id.valid() || !op.shape.valid()) return false;
+    bool stroke = op.shapeType == ShapeType::Stroke;
+    if (op.type == CrdtOpType::CreateShape && (op.shape != op.id || (!stroke && op.points.size() != 2))) return false;
+
+    auto found = shapes.find(op.shape);
+    if (op.type == CrdtOpType::AppendPoints && found != shapes.end() && found->second.created &&
+        found->second.type != ShapeType::Stroke) {
+        return false;
+    }
+    DocShape& state = found != shapes.end() ? found->second : shapes[op.shape];
+    bool deleted = state.deletedBy.valid();
+    lamport = std::max(lamport, op.id.counter);
+
+    switch (op.type) {
+        case CrdtOpType::CreateShape: {
+            if (state.created) return true;
+            state.created = true;
+            state.type = op.shapeType;
+            if (stroke) {
+                auto at = std::lower_bound(state.runs.begin(), state.runs.end(), op.id,
+                                           [](const PointRun& run, const ElementId& id) { return run.id < id; });
+                if (!deleted) state.runs.insert(at, PointRun{op.id, op.points});
+            } else {
+                state.geometry[0] = op.points[0];
+                state.geometry[1] = op.points[1];
+                state.runs.clear();  // appends that came early were to a non-stroke
+            }
+            state.color.write(op.color, op.id);
+            state.thickness.write(op.thickness, op.id);
+            if (state.visible()) show(op.shape, state);
+            return true;
+        }
+        case CrdtOpType::AppendPoints: {
+            if (deleted || op.points.empty()) return true;
+            auto at = std::lower_bound(state.runs.begin(), state.runs.end(), op.id,
+                                       [](const PointRun& run, const ElementId& id) { return run.id < id; });
+            if (at != state.runs.end() && at->id == op.id) return true;
+            bool last = at == state.runs.end();
+            state.runs.insert(at, PointRun{op.id, op.points});
+            if (state.engineId == 0) return true;
+            if (last) {
+                appendToEngine(state, op.points);
+            } else {
+                restack(position(op.shape));
+            }
+            return true;
+        }
+        case CrdtOpType::SetColor:
+            if (!deleted && state.color.write(op.color, op.id) && state.engineId != 0) {
+                engine.recolorShapeById(state.engineId, op.color);
+            }
+            return true;
+        case CrdtOpType::SetThickness:
+            if (!deleted && state.thickness.write(op.thickness, op.id) && state.engineId != 0) {
+                engine.setThicknessById(state.engineId, op.thickness);
+            }
+            return true;
+        case CrdtOpType::SetTransform: {
+            Affine previous = state.transform.value;
+            if (deleted || !state.transform.write(op.transform, op.id) || state.engineId == 0) return true;
+            // The engine composes the change in O(1): a drag moves the drawn
+            // shape, anything else undoes the previous transform and applies
+            // the new one. Only a collapsed (singular) previous transform
+            // needs the shape redrawn.
+            if (previous.isTranslation() && op.transform.isTranslation()) {
+                engine.moveShapeById(state.engineId, op.transform.tx - previous.tx, op.transform.ty - previous.ty);
+            } else if (previous.a * previous.d - previous.b * previous.c != 0.0f) {
+                engine.transformShapeById(state.engineId, previous.inverse().then(op.transform));
+            } else {
+                restack(position(op.shape));
+            }
+            return true;
+        }
+        case CrdtOpType::DeleteShape:
+            if (deleted) {
+                state.deletedBy = std::max(state.deletedBy, op.id);  // the tombstone converges too
+                return true;
+            }
+            if (state.visible()) {
+                order.erase(order.begin() + position(op.shape));
+                if (state.engineId != 0) {
+                    engine.removeShapeById(state.engineId);
+                    byEngineId.erase(state.engineId);
+                    state.engineId = 0;
+                }
+            }
+            state.deletedBy = op.id;
+            std::vector<PointRun>().swap(state.runs);
+            return true;
+    }
+    return false;
+}
+
+size_t CrdtDocument::applyEncoded(const uint8_t* data, size_t size) {
+    size_t applied = 0;
+    CrdtOp op;
+    while (size > 0) {
+        size_t used = CrdtCodec::decode(data, size, op);
+        if (used == 0) break;
+        // A rejected op is skipped, not a stop: whether apply() rejects can
+        // depend on arrival order, and the ops after it must land the same
+        // way on every replica
+        if (apply(op)) applied++;
+        data += used;
+        size -= used;
+    }
+    return applied;
+}
+
+std::vector<uint8_t> CrdtDocument::takeOps() {
+    std::vector<uint8_t> packet;
+    for (const CrdtOp& op : outbox) CrdtCodec::encode(op, packet);
+    outbox.clear();
+    return packet;
+}
+
+std::vector<uint8_t> CrdtDocument::encodeState() const {
+    // In id order, so replicas holding the same document encode the same bytes
+    std::vector<ElementId> ids;
+    ids.reserve(shapes.size());
+    for (const auto& entry : shapes) ids.push_back(entry.first);
+    std::sort(ids.begin(), ids.end());
+
+    std::vector<uint8_t> out;
+    for (const ElementId& id : ids) {
+        const DocShape& state = shapes.at(id);
+        CrdtOp op;
+        op.shape = id;
+        if (state.deletedBy.valid()) {
+            op.type = CrdtOpType::DeleteShape;
+            op.id = state.deletedBy;
+            CrdtCodec::encode(op, out);
+            continue;
+        }
+
+        size_t firstRun = 0;
+        if (state.created) {
+            op.type = CrdtOpType::CreateShape;
+            op.id = id;
+            op.shapeType = state.type;
+            op.color = state.color.value;
+            op.thickness = state.thickness.value;
+            if (state.type != ShapeType::Stroke) {
+                op.points = {state.geometry[0], state.geometry[1]};
+            } else if (!state.runs.empty() && state.runs[0].id == id) {
+                op.points = state.runs[0].points;
+                firstRun = 1;
+            }
+            CrdtCodec::encode(op, out);
+            op.points.clear();
+        }
+        // Register writes newer than the create, with their own stamps
+        if (state.color.stamp.valid() && state.color.stamp != id) {
+            op.type = CrdtOpType::SetColor;
+            op.id = state.color.stamp;
+            op.color = state.color.value;
+            CrdtCodec::encode(op, out);
+        }
+        if (state.thickness.stamp.valid() && state.thickness.stamp != id) {
+            op.type = CrdtOpType::SetThickness;
+            op.id = state.thickness.stamp;
+            op.thickness = state.thickness.value;
+            CrdtCodec::encode(op, out);
+        }
+        if (state.transform.stamp.valid()) {
+            op.type = CrdtOpType::SetTransform;
+            op.id = state.transform.stamp;
+            op.transform = state.transform.value;
+            CrdtCodec::encode(op, out);
+        }
+        for (size_t i = firstRun; i < state.runs.size(); i++) {
+            op.type = CrdtOpType::AppendPoints;
+            op.id = state.runs[i].id;
+            op.points = state.runs[i].points;
+            CrdtCodec::encode(op, out);
+        }
+    }
+    return out;
+}
+
+// ---- Lookups ----
+
+bool CrdtDocument::hasShape(ElementId shape) const {
+    auto it = shapes.find(shape);
+    return it != shapes.end() && it->second.visible();
+}
+
+ShapeId CrdtDocument::engineId(ElementId shape) const {
+    auto it = shapes.find(shape);
+    return it != shapes.end() ? it->second.engineId : 0;
+}
+
+ElementId CrdtDocument::elementId(ShapeId id) const {
+    auto it = byEngineId.find(id);
+    return it != byEngineId.end() ? it->second : ElementId();
+}
+
+Affine CrdtDocument::getTransform(ElementId shape) const {
+    auto it = shapes.find(shape);
+    return it != shapes.end() ? it->second.transform.value : Affine();
+}
+
+CrdtDocument::DocShape* CrdtDocument::live(ElementId shape) {
+    auto it = shapes.find(shape);
+    return it != shapes.end() && it->second.visible() ? &it->second : nullptr;
+}
+
+size_t CrdtDocument::position(ElementId shape) const {
+    return static_cast<size_t>(std::lower_bound(order.begin(), order.end(), shape) - order.begin());
+}
+
+// ---- Engine view ----
+
+void CrdtDocument::show(ElementId shape, DocShape& state) {
+    size_t at = position(shape);
+    order.insert(order.begin() + at, shape);
+    if (at + 1 == order.size()) {
+        draw(shape, state);
+    } else {
+        restack(at);
+    }
+}
+
+// Redraws every visible shape from `from` up, so the engine's draw order
+// matches the document's again
+void CrdtDocument::restack(size_t from) {
+    for (size_t i = from; i < order.size(); i++) {
+        ShapeId id = shapes[order[i]].engineId;
+        if (id != 0) engine.removeShapeById(id);
+    }
+    for (size_t i = from; i < order.size(); i++) draw(order[i], shapes[order[i]]);
+}
+
+void CrdtDocument::draw(ElementId shape, DocShape& state) {
+    std::unique_ptr<Shape> drawn;
+    const Color& color = state.color.value;
+    float thickness = state.thickness.value;
+    if (state.type == ShapeType::Stroke) {
+        size_t total = 0;
+        for (const PointRun& run : state.runs) total += run.points.size();
+        std::vector<Point> points;
+        points.reserve(total);
+        for (const PointRun& run : state.runs) points.insert(points.end(), run.points.begin(), run.points.end());
+        drawn = std::make_unique<StrokeShape>(color, thickness, points);
+    } else if (state.type == ShapeType::Rectangle) {
+        drawn = std::make_unique<RectangleShape>(state.geometry[0], state.geometry[1], color, thickness);
+    } else {
+        drawn = std::make_unique<EllipseShape>(state.geometry[0], state.geometry[1].x, state.geometry[1].y, color, thickness);
+    }
+    drawn->id = state.engineId;  // the engine keeps a freed id
+    drawn->transform = state.transform.value;
+
+    ShapeId id = engine.addShape(std::move(drawn));
+    if (id != state.engineId) {
+        if (state.engineId != 0) byEngineId.erase(state.engineId);
+        byEngineId[id] = shape;
+        state.engineId = id;
+    }
+}
+
+void CrdtDocument::appendToEngine(const DocShape& state, const std::vector<Point>& points) {
+    const Affine& transform = state.transform.value;
+    for (const Point& p : points) engine.addPointToStrokeById(state.engineId, transform.apply(p));
+}
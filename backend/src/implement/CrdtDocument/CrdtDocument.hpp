@@ -0,0 +1,130 @@
+#pragma once
+#include "CrdtOp.hpp"
+#include "../DrawingEngine/DrawingEngine.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Optional CRDT document mode: a replicated board that drives a
+// DrawingEngine, merging remote edits in any order with no central
+// transform step.
+//
+// Shapes are keyed by the ElementId of the op that created them and drawn in
+// id order. Colour, thickness and transform are last-writer-wins registers
+// stamped with op ids. Stroke points are a sequence of runs ordered by the
+// id of the append that made them; a replica's own appends always sort
+// last, and concurrent runs from other replicas interleave by id. Deletion
+// is permanent and beats every concurrent edit. Every merge is commutative
+// and idempotent: replicas that have applied the same set of ops, in any
+// order and with duplicates, hold the same document.
+//
+// The engine is a view of the document and must not be edited around it.
+// Ops in id order (the usual case: new shapes on top, appends at the end)
+// reach the engine incrementally, and register writes (colour, thickness,
+// transform) edit the drawn shape in place. An op that lands below existing
+// content, such as a concurrent create with a lower id, re-adds the shapes
+// from that point up. They keep their engine ids, so only the few shapes
+// above it pay.
+class CrdtDocument {
+    public:
+        CrdtDocument(DrawingEngine& engine, uint32_t replicaId);
+        CrdtDocument(const CrdtDocument&) = delete;
+        CrdtDocument& operator=(const CrdtDocument&) = delete;
+
+        uint32_t replicaId() const { return replica; }
+        uint64_t clock() const { return lamport; }
+
+        // Local edits: applied at once and queued for takeOps(). Points are
+        // snapped to the codec's 1/64 grid. Edits of unknown or deleted
+        // shapes return false (creates never fail).
+        ElementId createStroke(const Color& color, float thickness, const std::vector<Point>& points = {});
+        ElementId createRectangle(const Point& topLeft, const Point& bottomRight, const Color& color, float thickness);
+        ElementId createEllipse(const Point& center, float radiusX, float radiusY, const Color& color, float thickness);
+        // Points in the stroke's own space (before its transform). Appends
+        // while the previous one is still queued extend it into one op.
+        bool appendPoints(ElementId stroke, const std::vector<Point>& points);
+        bool setColor(ElementId shape, const Color& color);
+        bool setThickness(ElementId shape, float thickness);
+        bool setTransform(ElementId shape, const Affine& transform);  // replaces; relative to the created geometry
+        bool moveShape(ElementId shape, float dx, float dy);           // composes onto the current transform
+        bool deleteShape(ElementId shape);
+
+        // Remote ops, in any order; duplicates are ignored. False for ops
+        // that cannot be valid (a create with the wrong geometry, points
+        // appended to a rectangle).
+        bool apply(const CrdtOp& op);
+        // Applies a packet of encoded ops; returns how many it applied.
+        // Ops apply() rejects are skipped; decoding stops at the first op
+        // that does not decode.
+        size_t applyEncoded(const uint8_t* data, size_t size);
+
+        // Local ops since the previous take, encoded back to back
+        std::vector<uint8_t> takeOps();
+        bool hasPendingOps() const { return !outbox.empty(); }
+        // The whole document as ops, tombstones included, for a replica
+        // joining late. Shapes go in id order, so replicas holding the same
+        // document produce the same bytes.
+        std::vector<uint8_t> encodeState() const;
+
+        bool hasShape(ElementId shape) const;  // created and not deleted
+        size_t shapeCount() const { return order.size(); }
+        std::vector<ElementId> getShapeIds() const { return order; }  // draw order
+        ShapeId engineId(ElementId shape) const;    // 0 unless drawn
+        ElementId elementId(ShapeId id) const;      // invalid id if unknown
+        Affine getTransform(ElementId shape) const;  // identity if unknown
+
+    private:
+        template<typename T>
+        struct Register {
+            T value = T();
+            ElementId stamp;
+
+            // Keeps the write with the higher stamp
+            bool write(const T& v, ElementId at) {
+                if (!(stamp < at)) return false;
+                value = v;
+                stamp = at;
+                return true;
+            }
+        };
+
+        struct PointRun {
+            ElementId id;
+            std::vector<Point> points;
+        };
+
+        // A shape's merged state. Ops may arrive before the create; they are
+        // kept here and take effect once it lands.
+        struct DocShape {
+            bool created = false;
+            ElementId deletedBy;
+            ShapeType type = ShapeType::Stroke;
+            Point geometry[2];  // rectangle corners; ellipse centre and radii
+            Register<Color> color;
+            Register<float> thickness;
+            Register<Affine> transform;
+            std::vector<PointRun> runs;  // strokes, by id
+            ShapeId engineId = 0;
+
+            bool visible() const { return created && !deletedBy.valid(); }
+        };
+
+        ElementId nextId();
+        CrdtOp localOp(CrdtOpType type, ElementId shape);
+        ElementId submit(CrdtOp op);
+        DocShape* live(ElementId shape);
+        size_t position(ElementId shape) const;
+        void show(ElementId shape, DocShape& state);
+        void restack(size_t from);
+        void draw(ElementId shape, DocShape& state);
+        void appendToEngine(const DocShape& state, const std::vector<Point>& points);
+
+        DrawingEngine& engine;
+        uint32_t replica;
+        uint64_t lamport = 0;
+        std::unordered_map<ElementId, DocShape, ElementIdHash> shapes;
+        std::vector<ElementId> order;  // visible shapes, by id
+        std::unordered_map<ShapeId, ElementId> byEngineId;
+        std::vector<CrdtOp> outbox;
+};
@@ -0,0 +1,227 @@
+#pragma once
+#include "../shape.hpp"
+#include "../draw.hpp"
+#include "../point_frame.hpp"
+#include "../varint.hpp"
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+// Lamport stamp naming every CRDT op, and every shape after the op that
+// created it. Ordered by counter, then replica, so any two replicas sort
+// ids the same way; a replica's new ids are above every id it has seen.
+struct ElementId {
+    uint64_t counter = 0;
+    uint32_t replica = 0;
+
+    ElementId() = default;
+    ElementId(uint64_t counter, uint32_t replica) : counter(counter), replica(replica) {}
+
+    bool valid() const { return counter != 0; }
+    bool operator==(const ElementId& other) const { return counter == other.counter && replica == other.replica; }
+    bool operator!=(const ElementId& other) const { return !(*this == other); }
+    bool operator<(const ElementId& other) const {
+        return counter != other.counter ? counter < other.counter : replica < other.replica;
+    }
+};
+
+struct ElementIdHash {
+    size_t operator()(const ElementId& id) const {
+        return std::hash<uint64_t>()(id.counter * 0x9E3779B97F4A7C15ull ^ id.replica);
+    }
+};
+
+enum class CrdtOpType : uint8_t {
+    CreateShape,
+    AppendPoints,
+    SetColor,
+    SetThickness,
+    SetTransform,
+    DeleteShape
+};
+
+// One CRDT edit. `shape` is the target; a create's is its own id.
+struct CrdtOp {
+    CrdtOpType type = CrdtOpType::CreateShape;
+    ElementId id;
+    ElementId shape;
+    ShapeType shapeType = ShapeType::Stroke;  // creates
+    Color color;                              // creates, SetColor
+    float thickness = 0.0f;                   // creates, SetThickness
+    Affine transform;                         // SetTransform
+    // Creates: stroke points, rectangle corners, or ellipse centre and
+    // (radiusX, radiusY). AppendPoints: the run appended.
+    std::vector<Point> points;
+};
+
+// Binary CRDT op codec. One op is:
+//
+//   u8      type
+//   varint  id.counter, id.replica
+//   varint  shape.counter, shape.replica         (all but creates)
+//   create:    u8 shape type, f32 r g b a, f32 thickness, points
+//   append:    points
+//   color:     f32 r g b a
+//   thickness: f32
+//   transform: f32 a b c d tx ty
+//   delete:    -
+//
+// points is a varint count, then zig-zag varint coordinates in 1/64 world
+// units, the first absolute and the rest deltas (as in PointFrameCodec).
+// Floats are raw little-endian. Ops are self-delimiting, so a packet holds
+// any number back to back.
+//
+// Points are snapped to the 1/64 grid by the replica that makes the op, so
+// its own copy matches what every other replica decodes.
+namespace CrdtCodec {
+
+    constexpr uint8_t QuantumShift = 6;
+
+    inline Point snap(const Point& p) {
+        float scale = std::ldexp(1.0f, QuantumShift);
+        return Point(static_cast<float>(double(PointFrameCodec::quantize(p.x, scale)) / scale),
+                     static_cast<float>(double(PointFrameCodec::quantize(p.y, scale)) / scale));
+    }
+
+    namespace detail {
+
+        inline void writeFloats(std::vector<uint8_t>& out, const float* values, size_t count) {
+            size_t at = out.size();
+            out.resize(at + count * sizeof(float));
+            std::memcpy(out.data() + at, values, count * sizeof(float));
+        }
+
+        inline bool readFloats(const uint8_t*& p, const uint8_t* end, float* values, size_t count) {
+            if (size_t(end - p) < count * sizeof(float)) return false;
+            std::memcpy(values, p, count * sizeof(float));
+            p += count * sizeof(float);
+            return true;
+        }
+
+        inline void writeId(std::vector<uint8_t>& out, const ElementId& id) {
+            Varint::write(out, id.counter);
+            Varint::write(out, id.replica);
+        }
+
+        inline bool readId(const uint8_t*& p, const uint8_t* end, ElementId& id) {
+            uint64_t replica;
+            if (!Varint::read(p, end, id.counter) || !Varint::read(p, end, replica) || replica > UINT32_MAX) return false;
+            id.replica = static_cast<uint32_t>(replica);
+            return true;
+        }
+
+        inline void writePoints(std::vector<uint8_t>& out, const std::vector<Point>& points) {
+            float scale = std::ldexp(1.0f, QuantumShift);
+            Varint::write(out, points.size());
+            int64_t lastX = 0, lastY = 0;
+            for (const Point& p : points) {
+                int64_t x = PointFrameCodec::quantize(p.x, scale);
+                int64_t y = PointFrameCodec::quantize(p.y, scale);
+                Varint::writeSigned(out, x - lastX);
+                Varint::writeSigned(out, y - lastY);
+                lastX = x;
+                lastY = y;
+            }
+        }
+
+        inline bool readPoints(const uint8_t*& p, const uint8_t* end, std::vector<Point>& points) {
+            uint64_t count;
+            // Every point takes at least two bytes
+            if (!Varint::read(p, end, count) || count > uint64_t(end - p) / 2) return false;
+            float quantum = std::ldexp(1.0f, -int(QuantumShift));
+            points.reserve(count);
+            int64_t x = 0, y = 0, dx, dy;
+            for (uint64_t i = 0; i < count; i++) {
+                if (!Varint::readSigned(p, end, dx) || !Varint::readSigned(p, end, dy)) return false;
+                x += dx;
+                y += dy;
+                points.emplace_back(static_cast<float>(double(x) * quantum), static_cast<float>(double(y) * quantum));
+            }
+            return true;
+        }
+
+    } // namespace detail
+
+    inline void encode(const CrdtOp& op, std::vector<uint8_t>& out) {
+        out.push_back(static_cast<uint8_t>(op.type));
+        detail::writeId(out, op.id);
+        if (op.type != CrdtOpType::CreateShape) detail::writeId(out, op.shape);
+        const float rgba[4] = {op.color.r, op.color.g, op.color.b, op.color.a};
+        switch (op.type) {
+            case CrdtOpType::CreateShape:
+                out.push_back(static_cast<uint8_t>(op.shapeType));
+                detail::writeFloats(out, rgba, 4);
+                detail::writeFloats(out, &op.thickness, 1);
+                detail::writePoints(out, op.points);
+                break;
+            case CrdtOpType::AppendPoints:
+                detail::writePoints(out, op.points);
+                break;
+            case CrdtOpType::SetColor:
+                detail::writeFloats(out, rgba, 4);
+                break;
+            case CrdtOpType::SetThickness:
+                detail::writeFloats(out, &op.thickness, 1);
+                break;
+            case CrdtOpType::SetTransform: {
+                const float m[6] = {op.transform.a, op.transform.b, op.transform.c,
+                                    op.transform.d, op.transform.tx, op.transform.ty};
+                detail::writeFloats(out, m, 6);
+                break;
+            }
+            case CrdtOpType::DeleteShape:
+                break;
+        }
+    }
+
+    // Decodes one op from [data, data + size) into op. Returns the bytes
+    // consumed, or 0 if the input is malformed.
+    inline size_t decode(const uint8_t* data, size_t size, CrdtOp& op) {
+        op = CrdtOp();
+        if (size < 1 || data[0] > static_cast<uint8_t>(CrdtOpType::DeleteShape)) return 0;
+        op.type = static_cast<CrdtOpType>(data[0]);
+        const uint8_t* p = data + 1;
+        const uint8_t* end = data + size;
+        if (!detail::readId(p, end, op.id)) return 0;
+        if (op.type == CrdtOpType::CreateShape) {
+            op.shape = op.id;
+        } else if (!detail::readId(p, end, op.shape)) {
+            return 0;
+        }
+
+        float values[6];
+        switch (op.type) {
+            case CrdtOpType::CreateShape:
+                if (p == end || *p > static_cast<uint8_t>(ShapeType::Ellipse)) return 0;
+                op.shapeType = static_cast<ShapeType>(*p++);
+                if (!detail::readFloats(p, end, values, 5) || !detail::readPoints(p, end, op.points)) return 0;
+                op.color = Color(values[0], values[1], values[2], values[3]);
+                op.thickness = values[4];
+                break;
+            case CrdtOpType::AppendPoints:
+                if (!detail::readPoints(p, end, op.points)) return 0;
+                break;
+            case CrdtOpType::SetColor:
+                if (!detail::readFloats(p, end, values, 4)) return 0;
+                op.color = Color(values[0], values[1], values[2], values[3]);
+                break;
+            case CrdtOpType::SetThickness:
+                if (!detail::readFloats(p, end, &op.thickness, 1)) return 0;
+                break;
+            case CrdtOpType::SetTransform:
+                if (!detail::readFloats(p, end, values, 6)) return 0;
+                op.transform.a = values[0];
+                op.transform.b = values[1];
+                op.transform.c = values[2];
+                op.transform.d = values[3];
+                op.transform.tx = values[4];
+                op.transform.ty = values[5];
+                break;
+            case CrdtOpType::DeleteShape:
+                break;
+        }
+        return static_cast<size_t>(p - data);
+    }
+
+} // namespace CrdtCodec
@@ -0,0 +1,79 @@
+#pragma once
+#include "../draw.hpp"
+#include <cstddef>
+#include <vector>
+
+// Per-slot bounding boxes plus their union, as a segment tree: leaf i is
+// slot i's box and every inner node the union of its two children. Changing
+// or emptying one box walks a single leaf-to-root path (O(log n)), stopping
+// as soon as a node comes out unchanged, so the board's bounds stay O(1) to
+// read without rescanning shapes when one is erased.
+//
+// Empty boxes (erased slots) are the identity of the union. Slot compaction
+// moves leaves with moveLeaf() and then truncate(), which rebuilds the inner
+// nodes once.
+class BoundsTree {
+    public:
+        size_t size() const { return count; }
+        const AABB& operator[](size_t slot) const { return nodes[leaves + slot]; }
+
+        // Union of every box; empty when there are none
+        AABB total() const { return count ? nodes[1] : AABB(); }
+
+        void append(const AABB& box) {
+            if (count == leaves) grow(leaves ? leaves * 2 : 1);
+            set(count++, box);
+        }
+
+        void set(size_t slot, const AABB& box) {
+            size_t node = leaves + slot;
+            nodes[node] = box;
+            for (node >>= 1; node > 0; node >>= 1) {
+                AABB merged = nodes[2 * node];
+                merged.expand(nodes[2 * node + 1]);
+                if (merged == nodes[node]) break;
+                nodes[node] = merged;
+            }
+        }
+
+        // Copies a leaf without touching the inner nodes; truncate() after
+        void moveLeaf(size_t from, size_t to) { nodes[leaves + to] = nodes[leaves + from]; }
+
+        void truncate(size_t slots) {
+            for (size_t slot = slots; slot < count; slot++) nodes[leaves + slot] = AABB();
+            count = slots;
+            rebuild();
+        }
+
+        void reserve(size_t slots) {
+            size_t wanted = leaves ? leaves : 1;
+            while (wanted < slots) wanted *= 2;
+            if (wanted > leaves) grow(wanted);
+        }
+
+        void clear() {
+            nodes.clear();
+            leaves = 0;
+            count = 0;
+        }
+
+    private:
+        void grow(size_t newLeaves) {
+            std::vector<AABB> grown(2 * newLeaves);
+            for (size_t slot = 0; slot < count; slot++) grown[newLeaves + slot] = nodes[leaves + slot];
+            nodes.swap(grown);
+            leaves = newLeaves;
+            rebuild();
+        }
+
+        void rebuild() {
+            for (size_t node = leaves; node-- > 1;) {
+                nodes[node] = nodes[2 * node];
+                nodes[node].expand(nodes[2 * node + 1]);
+            }
+        }
+
+        std::vector<AABB> nodes;  // 1-based heap order; leaves start at `leaves`
+        size_t leaves = 0;        // capacity, a power of two
+        size_t count = 0;
+};
@@ -0,0 +1,164 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "../shape.hpp"
+
+// Packed mutation records for DrawingEngine::applyBatch().
+//
+// A record is a run of 32-bit words. Word 0 is opcode | (wordCount << 8),
+// wordCount including word 0; ids take two words (low, high); coordinates
+// and colour channels are float32 bit patterns.
+//
+//   Pad        [hdr]                          skip to the end of the ring
+//   NewStroke  [hdr, id lo, id hi, r, g, b, a, thickness]
+//   AddPoint   [hdr, id lo, id hi, x, y]
+//   Move       [hdr, id lo, id hi, dx, dy]
+//   Delete     [hdr, id lo, id hi]
+//   Recolor    [hdr, id lo, id hi, r, g, b, a]
+//   Simplify   [hdr, id lo, id hi, epsilon]
+//
+// The producer picks stroke ids. A NewStroke whose id is 0 or already in use
+// is rejected, and so is every later record in the batch for that id, so
+// they cannot land on an unrelated shape.
+enum class CommandOp : uint8_t {
+    Pad = 0,
+    NewStroke = 1,
+    AddPoint = 2,
+    Move = 3,
+    Delete = 4,
+    Recolor = 5,
+    Simplify = 6
+};
+
+// Single-producer, single-consumer ring of command words living in one
+// buffer, so JS can write through a Uint32Array/Float32Array pair over the
+// WASM heap and hand the whole batch over with one applyBatch() call.
+//
+//   words[0]  write index (producer advances it after writing a record)
+//   words[1]  read index  (applyBatch advances it)
+//   words[2]  capacity, in record words
+//   words[3]  NewStroke records the last applyBatch rejected
+//   words[4...] record words
+//
+// Indices are in [0, capacity). A record never wraps: when it does not fit
+// before the end, the producer writes a Pad record over the tail and
+// continues at 0. One word is always left free so full != empty.
+class CommandRing {
+    public:
+        static constexpr uint32_t ControlWords = 4;
+
+        explicit CommandRing(uint32_t capacity = 0) { resize(capacity); }
+
+        void resize(uint32_t capacity) {
+            words.assign(ControlWords + capacity, 0);
+            words[2] = capacity;
+        }
+
+        uint32_t capacity() const { return words[2]; }
+        uint32_t writeIndex() const { return words[0]; }
+        uint32_t readIndex() const { return words[1]; }
+        void setWriteIndex(uint32_t index) { words[0] = index; }
+        void setReadIndex(uint32_t index) { words[1] = index; }
+        uint32_t rejectedCount() const { return words[3]; }
+        void setRejectedCount(uint32_t count) { words[3] = count; }
+
+        uint32_t* records() { return words.data() + ControlWords; }
+        const uint32_t* records() const { return words.data() + ControlWords; }
+
+        std::vector<uint32_t> words;
+};
+
+// Native-side producer for a CommandRing (the frontend has a TypeScript twin)
+class CommandWriter {
+    public:
+        explicit CommandWriter(CommandRing& ring) : ring(ring) {}
+
+        bool newStroke(ShapeId id, const Color& color, float thickness) {
+            uint32_t* r = reserve(CommandOp::NewStroke, 8, id);
+            if (!r) return false;
+            putColor(r + 3, color);
+            putFloat(r + 7, thickness);
+            return commit(8);
+        }
+
+        bool addPoint(ShapeId id, float x, float y) { return idAndFloats(CommandOp::AddPoint, id, x, y); }
+        bool move(ShapeId id, float dx, float dy) { return idAndFloats(CommandOp::Move, id, dx, dy); }
+
+        bool remove(ShapeId id) {
+            return reserve(CommandOp::Delete, 3, id) && commit(3);
+        }
+
+        bool recolor(ShapeId id, const Color& color) {
+            uint32_t* r = reserve(CommandOp::Recolor, 7, id);
+            if (!r) return false;
+            putColor(r + 3, color);
+            return commit(7);
+        }
+
+        bool simplify(ShapeId id, float epsilon) {
+            uint32_t* r = reserve(CommandOp::Simplify, 4, id);
+            if (!r) return false;
+            putFloat(r + 3, epsilon);
+            return commit(4);
+        }
+
+        // NewStroke records the last applyBatch rejected; their ids are in
+        // DrawingEngine::getRejectedStrokes()
+        uint32_t rejected() const { return ring.rejectedCount(); }
+
+    private:
+        bool idAndFloats(CommandOp op, ShapeId id, float a, float b) {
+            uint32_t* r = reserve(op, 5, id);
+            if (!r) return false;
+            putFloat(r + 3, a);
+            putFloat(r + 4, b);
+            return commit(5);
+        }
+
+        // Space for a record at the write index (padding the tail if needed);
+        // null when the ring is full and the consumer must catch up first
+        uint32_t* reserve(CommandOp op, uint32_t length, ShapeId id) {
+            uint32_t capacity = ring.capacity();
+            uint32_t write = ring.writeIndex();
+            uint32_t read = ring.readIndex();
+            if (length >= capacity) return nullptr;
+
+            // The write index may never land on the read index: that means empty
+            uint32_t start = write;
+            if (read > write) {
+                if (read - write <= length) return nullptr;
+            } else if (capacity - write < length) {
+                // Wrapping: the tail becomes padding, so 0 must have room
+                if (read <= length) return nullptr;
+                ring.records()[write] = uint32_t(CommandOp::Pad) | ((capacity - write) << 8);
+                start = 0;
+                ring.setWriteIndex(0);
+            } else if (write + length == capacity && read == 0) {
+                return nullptr;
+            }
+
+            uint32_t* r = ring.records() + start;
+            r[0] = uint32_t(op) | (length << 8);
+            r[1] = uint32_t(id);
+            r[2] = uint32_t(id >> 32);
+            return r;
+        }
+
+        bool commit(uint32_t length) {
+            uint32_t next = ring.writeIndex() + length;
+            ring.setWriteIndex(next == ring.capacity() ? 0 : next);
+            return true;
+        }
+
+        static void putFloat(uint32_t* word, float v) { std::memcpy(word, &v, sizeof(v)); }
+
+        static void putColor(uint32_t* word, const Color& c) {
+            putFloat(word, c.r);
+            putFloat(word + 1, c.g);
+            putFloat(word + 2, c.b);
+            putFloat(word + 3, c.a);
+        }
+
+        CommandRing& ring;
+};
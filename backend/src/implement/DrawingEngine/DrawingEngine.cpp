@@ -1,110 +1,787 @@
 #include "DrawingEngine.hpp"
+#include "../varint.hpp"
+#include <cstdio>
+#ifndef __EMSCRIPTEN__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
-DrawingEngine::DrawingEngine() {}
+namespace {
 
-void DrawingEngine::addShape(std::unique_ptr<Shape> shape) {
-    shapes.push_back(std::move(shape));
+// Rough heap cost of keeping an erased shape around for history
+size_t parkedBytes(const Shape& shape) {
+    size_t bytes = sizeof(StrokeShape);
+    if (shape.type == ShapeType::Stroke) {
+        bytes += size_t(static_cast<const StrokeShape&>(shape).range.capacity) * 2 * sizeof(float);
+    }
+    return bytes;
 }
 
-void DrawingEngine::addStroke(const StrokeShape& stroke) {
-    // Create a unique_ptr to a copy of the stroke
-    auto strokePtr = std::make_unique<StrokeShape>(stroke);
-    shapes.push_back(std::move(strokePtr));
+// How far outlines without a known zoom may stray from an ellipse, in world units
+constexpr float OutlineTolerance = 0.25f;
+
+void applyTransform(const Shape& shape, std::vector<Point>& out, size_t first) {
+    if (!shape.transform.isIdentity()) {
+        for (size_t i = first; i < out.size(); i++) out[i] = shape.transform.apply(out[i]);
+    }
 }
 
-void DrawingEngine::addPointToStroke(int strokeIndex, const Point& pt) {
-    // Find the stroke at the given index
-    int strokeCount = 0;
-    for (auto& shape : shapes) {
-        if (shape->type == ShapeType::Stroke) {
-            if (strokeCount == strokeIndex) {
-                // Cast to StrokeShape and add point
-                StrokeShape* strokeShape = dynamic_cast<StrokeShape*>(shape.get());
-                if (strokeShape) {
-                    strokeShape->points.push_back(pt);
-                }
-                return;
+// A rectangle's or ellipse's outline in world space, as a closed polyline
+// (first point repeated last). Ellipses get as many segments as tolerance
+// needs at the size the transform gives them.
+void appendOutline(const RectangleShape& rect, float, std::vector<Point>& out) {
+    size_t first = out.size();
+    rect.appendOutline(out);
+    applyTransform(rect, out, first);
+}
+
+void appendOutline(const EllipseShape& ellipse, float tolerance, std::vector<Point>& out) {
+    size_t first = out.size();
+    float radius = std::max(ellipse.radiusX, ellipse.radiusY) * ellipse.transform.maxScale();
+    ellipse.appendOutline(EllipseShape::segmentsFor(radius, tolerance), out);
+    applyTransform(ellipse, out, first);
+}
+
+// Either of the above for a shape known not to be a stroke
+void appendOutline(const Shape& shape, float tolerance, std::vector<Point>& out) {
+    ShapeStore::visitShape(shape, [&](const auto& typed) {
+        if constexpr (!isStrokeType<decltype(typed)>) appendOutline(typed, tolerance, out);
+    });
+}
+
+// Calls edge(a, b) along the shape's world-space path until it returns true:
+// a stroke's polyline (a lone point as a zero-length edge) or a closed outline
+template<typename Edge>
+bool anyEdge(const Shape& shape, Edge edge) {
+    return ShapeStore::visitShape(shape, [&](const auto& typed) {
+        const Affine& t = typed.transform;
+        if constexpr (isStrokeType<decltype(typed)>) {
+            if (typed.range.length == 0) return false;
+            Point previous = t.apply(typed.pointAt(0));
+            if (typed.range.length == 1) return edge(previous, previous);
+            for (uint32_t i = 1; i < typed.range.length; i++) {
+                Point next = t.apply(typed.pointAt(i));
+                if (edge(previous, next)) return true;
+                previous = next;
+            }
+        } else {
+            thread_local std::vector<Point> outline;
+            outline.clear();
+            appendOutline(typed, OutlineTolerance, outline);
+            for (size_t i = 1; i < outline.size(); i++) {
+                if (edge(outline[i - 1], outline[i])) return true;
             }
-            strokeCount++;
         }
+        return false;
+    });
+}
+
+AABB inflate(const AABB& box, float pad) {
+    return box.empty() ? box : AABB(box.minX - pad, box.minY - pad, box.maxX + pad, box.maxY + pad);
+}
+
+// One [x, y, r, g, b, a, thickness] vertex
+void writeVertex(float* vertex, const Point& point, const Shape& shape) {
+    vertex[0] = point.x;
+    vertex[1] = point.y;
+    vertex[2] = shape.color.r;
+    vertex[3] = shape.color.g;
+    vertex[4] = shape.color.b;
+    vertex[5] = shape.color.a;
+    vertex[6] = shape.thickness;
+}
+
+void pushVertex(std::vector<float>& data, const Point& point, const Shape& shape) {
+    size_t at = data.size();
+    data.resize(at + GpuBuffers::FloatsPerVertex);
+    writeVertex(data.data() + at, point, shape);
+}
+
+} // namespace
+
+DrawingEngine::DrawingEngine() {}
+
+ShapeId DrawingEngine::addShape(std::unique_ptr<Shape> shape) {
+    if (!shape) return 0;
+
+    // Keep a caller-supplied id if it is free, otherwise hand out a new one
+    if (shape->id == 0 || hasShape(shape->id) || parked.count(shape->id)) {
+        shape->id = nextId++;
+    } else if (shape->id >= nextId) {
+        nextId = shape->id + 1;
+    }
+
+    if (shape->type == ShapeType::Stroke) {
+        StrokeShape* stroke = static_cast<StrokeShape*>(shape.get());
+        attachStroke(stroke);
+        stroke->recomputeBounds();
+    }
+
+    ShapeId id = shape->id;
+    if (!shape->transform.isIdentity()) transformed[id] = TransformState{true};
+    uint32_t slot = store.push(std::move(shape));
+    idToSlot.assign(id, slot);
+    gpu.addSlot();
+    slotBounds.append(AABB());
+    setBounds(slot, computeBounds(*store.at(slot)));
+    shapeChanged(slot, true);
+
+    if (recording()) {
+        bool merged;
+        recordOp(HistoryOp::Add, id, merged);
+        trimHistory();
+    }
+    return id;
+}
+
+ShapeId DrawingEngine::addStroke(const StrokeShape& stroke) {
+    // Copy the points straight into the arena, skipping a temporary vector
+    auto strokePtr = std::make_unique<StrokeShape>(stroke.color, stroke.thickness);
+    strokePtr->id = stroke.id;
+    strokePtr->range = stroke.arena ? pointArena.store(stroke.getPoints()) : pointArena.store(stroke.points);
+    strokePtr->arena = &pointArena;
+    return addShape(std::move(strokePtr));
+}
+
+void DrawingEngine::addPointToStroke(int strokeIndex, const Point& pt) {
+    int64_t slot = strokeSlot(strokeIndex);
+    if (slot >= 0) {
+        addPointToStrokeById(store.at(slot)->id, pt);
     }
 }
 
 void DrawingEngine::removeShape(int index) {
-    if (index >= 0 && index < shapes.size()) {
-        shapes.erase(shapes.begin() + index);
+    int64_t slot = shapeSlot(index);
+    if (slot >= 0) {
+        eraseSlot(slot);
     }
 }
 
 void DrawingEngine::removeStroke(int index) {
-    // Find the stroke at the given index and remove it
-    int strokeCount = 0;
-    for (auto it = shapes.begin(); it != shapes.end(); ++it) {
-        if ((*it)->type == ShapeType::Stroke) {
-            if (strokeCount == index) {
-                shapes.erase(it);
-                printf("Removed stroke at index %d\n", index);
-                return;
-            }
-            strokeCount++;
-        }
+    int64_t slot = strokeSlot(index);
+    if (slot >= 0) {
+        eraseSlot(slot);
+        printf("Removed stroke at index %d\n", index);
     }
 }
 
 void DrawingEngine::moveShape(int index, float dx, float dy) {
-    if (index >= 0 && index < shapes.size()) {
-        Shape* shape = shapes[index].get();
-        
-        // Handle different shape types
-        if (shape->type == ShapeType::Stroke) {
-            StrokeShape* strokeShape = dynamic_cast<StrokeShape*>(shape);
-            if (strokeShape) {
-                for (auto& point : strokeShape->points) {
-                    point.x += dx;
-                    point.y += dy;
-                }
-            }
-        }
-        // Add other shape types here as needed
-        // else if (shape->type == ShapeType::Rectangle) { ... }
+    int64_t slot = shapeSlot(index);
+    if (slot >= 0) {
+        moveShapeById(store.at(slot)->id, dx, dy);
     }
 }
 
 void DrawingEngine::moveStroke(int index, float dx, float dy) {
-    // Find the stroke at the given index and move it
-    int strokeCount = 0;
-    for (auto& shape : shapes) {
-        if (shape->type == ShapeType::Stroke) {
-            if (strokeCount == index) {
-                StrokeShape* strokeShape = dynamic_cast<StrokeShape*>(shape.get());
-                if (strokeShape) {
-                    for (auto& point : strokeShape->points) {
-                        point.x += dx;
-                        point.y += dy;
-                    }
-                }
-                return;
+    int64_t slot = strokeSlot(index);
+    if (slot >= 0) {
+        moveShapeById(store.at(slot)->id, dx, dy);
+    }
+}
+
+void DrawingEngine::clear() {
+    store.clear();
+    idToSlot.clear();
+    erasedSlots = 0;
+    pointArena.clear();
+    gpu.clear();
+    slotBounds.clear();
+    grid.clear();
+    inking.clear();
+    lodCache.clear();
+    meshCache.clear();
+    meshRebuild = true;
+    parked.clear();
+    transformed.clear();
+    selection.clear();
+    history.undo.clear();
+    history.redo.clear();
+    history.bytes = 0;
+    history.groupDepth = 0;
+    history.groupOpen = false;
+    contentVersion++;
+}
+
+bool DrawingEngine::hasShape(ShapeId id) const {
+    return id != 0 && idToSlot.find(id) >= 0;
+}
+
+bool DrawingEngine::addPointToStrokeById(ShapeId id, const Point& pt) {
+    int64_t slot = idToSlot.find(id);
+    if (slot < 0 || store.ref(slot).type != ShapeType::Stroke) return false;
+
+    StrokeShape* stroke = static_cast<StrokeShape*>(store.at(slot));
+    if (!stroke->transform.isIdentity()) bakeTransform(slot);
+    auto simplifier = inking.empty() ? inking.end() : inking.find(id);
+    bool replace = simplifier != inking.end() && simplifier->second.push(pt) == StreamingSimplifier::Action::Replace;
+    bool record = recording();
+    if (record) recordPoints(slot, replace ? stroke->range.length - 1 : stroke->range.length);
+
+    if (replace) {
+        // Bounds keep the replaced point; it lies within epsilon of the stroke
+        uint32_t last = stroke->range.length - 1;
+        pointArena.set(stroke->range, last, pt);
+        gpu.rewind(slot, last);
+    } else {
+        pointArena.append(stroke->range, pt);
+        if (pointArena.wantsCompaction()) compactArena();
+    }
+    stroke->bounds.expand(pt.x, pt.y);
+
+    AABB box = slotBounds[slot];
+    box.expand(pt.x, pt.y, stroke->thickness * 0.5f);
+    if (box != slotBounds[slot]) setBounds(slot, box);
+    shapeChanged(slot, false);
+    if (record) trimHistory();
+    return true;
+}
+
+bool DrawingEngine::applyPointFrame(const PointFrame& frame) {
+    int64_t slot = idToSlot.find(frame.strokeId);
+    if (slot < 0 || store.ref(slot).type != ShapeType::Stroke) return false;
+
+    if (!inking.empty() && inking.count(frame.strokeId)) {
+        // The streaming simplifier decides point by point
+        for (const Point& pt : frame.points) addPointToStrokeById(frame.strokeId, pt);
+        return true;
+    }
+
+    StrokeShape* stroke = static_cast<StrokeShape*>(store.at(slot));
+    if (!stroke->transform.isIdentity()) bakeTransform(slot);
+    bool record = recording();
+    if (record) recordPoints(slot, stroke->range.length);
+
+    AABB box = slotBounds[slot];
+    float pad = stroke->thickness * 0.5f;
+    for (const Point& pt : frame.points) {
+        pointArena.append(stroke->range, pt);
+        stroke->bounds.expand(pt.x, pt.y);
+        box.expand(pt.x, pt.y, pad);
+    }
+    if (pointArena.wantsCompaction()) compactArena();
+    if (box != slotBounds[slot]) setBounds(slot, box);
+    shapeChanged(slot, false);
+    if (record) trimHistory();
+    return true;
+}
+
+size_t DrawingEngine::applyPointFrames(const uint8_t* data, size_t size) {
+    thread_local PointFrame frame;
+    size_t applied = 0;
+    size_t offset = 0;
+    rejectedStrokes.clear();
+    while (offset < size) {
+        size_t used = PointFrameCodec::decode(data + offset, size - offset, frame);
+        if (used == 0) break;
+        offset += used;
+        if (applyPointFrame(frame)) applied++;
+    }
+    return applied;
+}
+
+bool DrawingEngine::removeShapeById(ShapeId id) {
+    int64_t slot = idToSlot.find(id);
+    if (slot < 0) return false;
+
+    eraseSlot(slot);
+    return true;
+}
+
+bool DrawingEngine::moveShapeById(ShapeId id, float dx, float dy) {
+    int64_t slot = idToSlot.find(id);
+    if (slot < 0) return false;
+
+    bool record = recording();
+    if (record) {
+        bool merged;
+        HistoryOp& op = recordOp(HistoryOp::Move, id, merged);
+        op.dx += dx;
+        op.dy += dy;
+    }
+    composeTransform(slot, Affine::translation(dx, dy));
+    if (record) trimHistory();
+    return true;
+}
+
+bool DrawingEngine::transformShapeById(ShapeId id, const Affine& transform) {
+    int64_t slot = idToSlot.find(id);
+    if (slot < 0) return false;
+
+    bool record = recording();
+    if (record) {
+        bool merged;
+        HistoryOp& op = recordOp(HistoryOp::Transform, id, merged);
+        op.transform = op.transform.then(transform);
+    }
+    composeTransform(slot, transform);
+    if (record) trimHistory();
+    return true;
+}
+
+bool DrawingEngine::scaleShapeById(ShapeId id, float sx, float sy, float cx, float cy) {
+    return transformShapeById(id, Affine::scaling(sx, sy, cx, cy));
+}
+
+bool DrawingEngine::rotateShapeById(ShapeId id, float radians, float cx, float cy) {
+    return transformShapeById(id, Affine::rotation(radians, cx, cy));
+}
+
+Affine DrawingEngine::getShapeTransform(ShapeId id) const {
+    int64_t slot = idToSlot.find(id);
+    return slot >= 0 ? store.at(slot)->transform : Affine();
+}
+
+size_t DrawingEngine::bakeTransforms(bool idleOnly) {
+    std::vector<ShapeId> ready;
+    for (auto& entry : transformed) {
+        if (idleOnly && entry.second.touched) {
+            entry.second.touched = false;  // idle if untouched until next time
+            continue;
+        }
+        ready.push_back(entry.first);
+    }
+
+    size_t baked = 0;
+    for (ShapeId id : ready) {
+        int64_t slot = idToSlot.find(id);  // parked shapes wait
+        if (slot >= 0 && bakeTransform(slot)) baked++;
+    }
+    return baked;
+}
+
+bool DrawingEngine::simplifyStrokeById(ShapeId id, float epsilon) {
+    int64_t slot = idToSlot.find(id);
+    if (slot < 0 || store.ref(slot).type != ShapeType::Stroke) return false;
+
+    if (!store.at(slot)->transform.isIdentity()) bakeTransform(slot);
+    bool record = recording();
+    if (record) recordPoints(slot, 0);
+    static_cast<StrokeShape*>(store.at(slot))->simplify(epsilon);
+    setBounds(slot, computeBounds(*store.at(slot)));
+    shapeChanged(slot, true);
+    restartInking(slot);
+    if (record) trimHistory();
+    return true;
+}
+
+bool DrawingEngine::recolorShapeById(ShapeId id, const Color& color) {
+    int64_t slot = idToSlot.find(id);
+    if (slot < 0) return false;
+
+    bool record = recording();
+    if (record) {
+        bool merged;
+        HistoryOp& op = recordOp(HistoryOp::Recolor, id, merged);
+        if (!merged) op.color = store.at(slot)->color;
+    }
+    store.at(slot)->color = color;
+    shapeChanged(slot, true);
+    if (record) trimHistory();
+    return true;
+}
+
+bool DrawingEngine::setThicknessById(ShapeId id, float thickness) {
+    int64_t slot = idToSlot.find(id);
+    if (slot < 0) return false;
+
+    bool record = recording();
+    if (record) {
+        bool merged;
+        HistoryOp& op = recordOp(HistoryOp::Thickness, id, merged);
+        if (!merged) op.thickness = store.at(slot)->thickness;
+    }
+    store.at(slot)->thickness = thickness;
+    setBounds(slot, computeBounds(*store.at(slot)));
+    shapeChanged(slot, true);
+    if (record) trimHistory();
+    return true;
+}
+
+size_t DrawingEngine::selectByRect(const AABB& rect, bool additive) {
+    if (!additive) selection.clear();
+    for (ShapeId id : grid.candidates(rect)) {
+        int64_t slot = idToSlot.find(id);
+        if (slot >= 0 && slotBounds[slot].intersects(rect) && shapeTouchesRect(*store.at(slot), rect)) {
+            selection.set(static_cast<uint32_t>(slot));
+        }
+    }
+    return selection.count();
+}
+
+size_t DrawingEngine::selectByLasso(const std::vector<Point>& polygon, bool additive) {
+    if (!additive) selection.clear();
+    if (polygon.size() < 3) return selection.count();
+
+    AABB box;
+    for (const Point& p : polygon) box.expand(p.x, p.y);
+    for (ShapeId id : grid.candidates(box)) {
+        int64_t slot = idToSlot.find(id);
+        if (slot >= 0 && slotBounds[slot].intersects(box) && shapeInPolygon(*store.at(slot), polygon)) {
+            selection.set(static_cast<uint32_t>(slot));
+        }
+    }
+    return selection.count();
+}
+
+size_t DrawingEngine::selectIds(const std::vector<ShapeId>& ids, bool additive) {
+    if (!additive) selection.clear();
+    for (ShapeId id : ids) {
+        int64_t slot = idToSlot.find(id);
+        if (slot >= 0) selection.set(static_cast<uint32_t>(slot));
+    }
+    return selection.count();
+}
+
+void DrawingEngine::clearSelection() {
+    selection.clear();
+}
+
+std::vector<ShapeId> DrawingEngine::getSelection() const {
+    std::vector<ShapeId> ids;
+    ids.reserve(selection.count());
+    selection.forEach([&](uint32_t slot) { ids.push_back(store.at(slot)->id); });
+    return ids;
+}
+
+size_t DrawingEngine::moveSelection(float dx, float dy) {
+    if (selection.empty()) return 0;
+
+    bool record = recording();
+    if (record) {
+        // One op for the whole selection; a drag keeps adding to it
+        std::vector<ShapeId> ids = getSelection();
+        bool merged;
+        HistoryOp& op = recordOp(HistoryOp::Move, 0, merged, &ids);
+        op.dx += dx;
+        op.dy += dy;
+    }
+    Affine step = Affine::translation(dx, dy);
+    selection.forEach([&](uint32_t slot) { composeTransform(slot, step); });
+    if (record) trimHistory();
+    return selection.count();
+}
+
+size_t DrawingEngine::transformSelection(const Affine& transform) {
+    if (selection.empty()) return 0;
+
+    bool record = recording();
+    if (record) {
+        std::vector<ShapeId> ids = getSelection();
+        bool merged;
+        HistoryOp& op = recordOp(HistoryOp::Transform, 0, merged, &ids);
+        op.transform = op.transform.then(transform);
+    }
+    selection.forEach([&](uint32_t slot) { composeTransform(slot, transform); });
+    if (record) trimHistory();
+    return selection.count();
+}
+
+size_t DrawingEngine::recolorSelection(const Color& color) {
+    if (selection.empty()) return 0;
+
+    // Each shape keeps its own old colour, all in one step
+    bool record = recording();
+    if (record) beginHistoryGroup();
+    selection.forEach([&](uint32_t slot) {
+        if (record) {
+            bool merged;
+            HistoryOp& op = recordOp(HistoryOp::Recolor, store.at(slot)->id, merged);
+            if (!merged) op.color = store.at(slot)->color;
+        }
+        store.at(slot)->color = color;
+        shapeChanged(slot, true);
+    });
+    if (record) {
+        endHistoryGroup();
+        trimHistory();
+    }
+    return selection.count();
+}
+
+size_t DrawingEngine::deleteSelection() {
+    if (selection.empty()) return 0;
+
+    std::vector<uint32_t> slots;
+    slots.reserve(selection.count());
+    selection.forEach([&](uint32_t slot) { slots.push_back(slot); });
+
+    // Slot numbers must hold until the last erase; compact once afterwards
+    bool record = recording();
+    if (record) beginHistoryGroup();
+    for (uint32_t slot : slots) eraseSlot(slot, false);
+    if (record) endHistoryGroup();
+    selection.clear();
+    if (record) {
+        trimHistory();
+    } else {
+        compactIfSparse();
+    }
+    return slots.size();
+}
+
+void DrawingEngine::initCommandRing(uint32_t capacityWords) {
+    commandRing.resize(capacityWords);
+    refreshViewGeneration();
+}
+
+CommandRing& DrawingEngine::getCommandRing() {
+    return commandRing;
+}
+
+size_t DrawingEngine::applyBatch() {
+    uint32_t capacity = commandRing.capacity();
+    uint32_t read = commandRing.readIndex();
+    uint32_t write = commandRing.writeIndex();
+    if (read >= capacity || write >= capacity) {
+        commandRing.setReadIndex(write < capacity ? write : 0);
+        commandRing.setWriteIndex(write < capacity ? write : 0);
+        return 0;
+    }
+
+    const uint32_t* records = commandRing.records();
+    size_t applied = 0;
+    rejectedStrokes.clear();
+    while (read != write) {
+        uint32_t length = records[read] >> 8;
+        uint32_t available = read < write ? write - read : capacity - read;
+        if (length == 0 || length > available) {
+            read = write;  // corrupt: nothing after this can be trusted
+            break;
+        }
+        if (CommandOp(records[read] & 0xff) != CommandOp::Pad && applyCommand(records + read, length)) applied++;
+        read += length;
+        if (read == capacity) read = 0;
+    }
+    commandRing.setReadIndex(read);
+    commandRing.setRejectedCount(uint32_t(rejectedStrokes.size()));
+    return applied;
+}
+
+size_t DrawingEngine::applyCommands(const uint32_t* words, size_t count) {
+    size_t applied = 0;
+    size_t offset = 0;
+    rejectedStrokes.clear();
+    while (offset < count) {
+        uint32_t length = words[offset] >> 8;
+        if (length == 0 || length > count - offset) break;
+        if (applyCommand(words + offset, length)) applied++;
+        offset += length;
+    }
+    return applied;
+}
+
+bool DrawingEngine::applyCommand(const uint32_t* record, uint32_t length) {
+    auto f = [record](int i) {
+        float v;
+        std::memcpy(&v, record + i, sizeof(v));
+        return v;
+    };
+    if (length < 3) return false;
+    ShapeId id = ShapeId(record[1]) | (ShapeId(record[2]) << 32);
+    CommandOp op = CommandOp(record[0] & 0xff);
+
+    // The producer addresses the stroke by the id it asked for; records for
+    // a stroke that was turned down must not reach whatever holds that id
+    if (op != CommandOp::NewStroke && !rejectedStrokes.empty() &&
+        std::find(rejectedStrokes.begin(), rejectedStrokes.end(), id) != rejectedStrokes.end()) {
+        return false;
+    }
+
+    switch (op) {
+        case CommandOp::NewStroke: {
+            if (length < 8) return false;
+            if (id == 0 || hasShape(id) || parked.count(id)) {
+                rejectedStrokes.push_back(id);
+                return false;
             }
-            strokeCount++;
+            StrokeShape stroke(Color(f(3), f(4), f(5), f(6)), f(7));
+            stroke.id = id;
+            return addStroke(stroke) != 0;
         }
+        case CommandOp::AddPoint:
+            return length >= 5 && addPointToStrokeById(id, Point(f(3), f(4)));
+        case CommandOp::Move:
+            return length >= 5 && moveShapeById(id, f(3), f(4));
+        case CommandOp::Delete:
+            return removeShapeById(id);
+        case CommandOp::Recolor:
+            return length >= 7 && recolorShapeById(id, Color(f(3), f(4), f(5), f(6)));
+        case CommandOp::Simplify:
+            return length >= 4 && simplifyStrokeById(id, f(3));
+        default:
+            return false;
     }
 }
 
-void DrawingEngine::clear() {
-    shapes.clear();
+bool DrawingEngine::beginStrokeSimplification(ShapeId id, float epsilon) {
+    int64_t slot = idToSlot.find(id);
+    if (slot < 0 || store.ref(slot).type != ShapeType::Stroke) return false;
+
+    inking.erase(id);
+    inking.emplace(id, StreamingSimplifier(epsilon));
+    restartInking(slot);
+    return true;
+}
+
+bool DrawingEngine::endStrokeSimplification(ShapeId id) {
+    return inking.erase(id) > 0;
 }
 
-const std::vector<std::unique_ptr<Shape>>& DrawingEngine::getShapes() const {
-    return shapes;
+void DrawingEngine::setHistoryBudget(size_t bytes) {
+    history.budget = bytes;
+    if (bytes == 0) {
+        clearHistory();
+    } else {
+        trimHistory();
+    }
+}
+
+size_t DrawingEngine::getHistoryBytes() const {
+    return history.bytes;
+}
+
+bool DrawingEngine::undo() {
+    history.groupDepth = 0;
+    history.groupOpen = false;
+    if (history.undo.empty()) return false;
+
+    HistoryStep step = std::move(history.undo.back());
+    history.undo.pop_back();
+    history.paused = true;
+    for (auto op = step.ops.rbegin(); op != step.ops.rend(); ++op) applyHistoryOp(*op, true);
+    history.paused = false;
+
+    // Whatever comes next starts a fresh step
+    step.sealed = true;
+    if (!history.undo.empty()) history.undo.back().sealed = true;
+    history.redo.push_back(std::move(step));
+    trimHistory();
+    return true;
+}
+
+bool DrawingEngine::redo() {
+    history.groupDepth = 0;
+    history.groupOpen = false;
+    if (history.redo.empty()) return false;
+
+    HistoryStep step = std::move(history.redo.back());
+    history.redo.pop_back();
+    history.paused = true;
+    for (HistoryOp& op : step.ops) applyHistoryOp(op, false);
+    history.paused = false;
+
+    history.undo.push_back(std::move(step));
+    trimHistory();
+    return true;
+}
+
+bool DrawingEngine::canUndo() const {
+    return !history.undo.empty();
+}
+
+bool DrawingEngine::canRedo() const {
+    return !history.redo.empty();
+}
+
+void DrawingEngine::beginHistoryGroup() {
+    if (history.groupDepth++ == 0) history.groupOpen = false;
+}
+
+void DrawingEngine::endHistoryGroup() {
+    if (history.groupDepth == 0) return;
+    if (--history.groupDepth == 0) {
+        if (history.groupOpen) history.undo.back().sealed = true;
+        history.groupOpen = false;
+    }
+}
+
+void DrawingEngine::clearHistory() {
+    for (HistoryStep& step : history.undo) dropHistoryStep(step, true);
+    for (HistoryStep& step : history.redo) dropHistoryStep(step, false);
+    history.undo.clear();
+    history.redo.clear();
+    history.groupDepth = 0;
+    history.groupOpen = false;
+    trimHistory();
+}
+
+ShapeId DrawingEngine::getStrokeId(int strokeIndex) const {
+    int64_t slot = strokeSlot(strokeIndex);
+    return slot >= 0 ? store.at(slot)->id : 0;
+}
+
+std::vector<ShapeId> DrawingEngine::getShapeIds() const {
+    std::vector<ShapeId> ids;
+    ids.reserve(idToSlot.size());
+    for (size_t slot = 0; slot < store.size(); slot++) {
+        if (store.occupied(slot)) ids.push_back(store.at(slot)->id);
+    }
+    return ids;
+}
+
+std::vector<ShapeId> DrawingEngine::queryRect(const AABB& rect) const {
+    std::vector<std::pair<uint32_t, ShapeId>> hits;
+    for (ShapeId id : grid.candidates(rect)) {
+        int64_t slot = idToSlot.find(id);
+        if (slot >= 0 && slotBounds[slot].intersects(rect)) hits.emplace_back(slot, id);
+    }
+    std::sort(hits.begin(), hits.end());
+
+    std::vector<ShapeId> ids;
+    ids.reserve(hits.size());
+    for (const auto& hit : hits) ids.push_back(hit.second);
+    return ids;
+}
+
+std::vector<ShapeId> DrawingEngine::hitTest(float x, float y, float radius) const {
+    AABB probe(x - radius, y - radius, x + radius, y + radius);
+    std::vector<std::pair<uint32_t, ShapeId>> hits;
+    for (ShapeId id : grid.candidates(probe)) {
+        int64_t slot = idToSlot.find(id);
+        if (slot >= 0 && slotBounds[slot].intersects(probe) && shapeHit(*store.at(slot), x, y, radius)) {
+            hits.emplace_back(slot, id);
+        }
+    }
+    // Topmost (last drawn) first
+    std::sort(hits.rbegin(), hits.rend());
+
+    std::vector<ShapeId> ids;
+    ids.reserve(hits.size());
+    for (const auto& hit : hits) ids.push_back(hit.second);
+    return ids;
+}
+
+AABB DrawingEngine::getShapeBounds(ShapeId id) const {
+    int64_t slot = idToSlot.find(id);
+    return slot >= 0 ? slotBounds[slot] : AABB();
+}
+
+AABB DrawingEngine::getBoardBounds() const {
+    return slotBounds.total();
+}
+
+std::vector<const Shape*> DrawingEngine::getShapes() const {
+    std::vector<const Shape*> live;
+    live.reserve(idToSlot.size());
+    for (size_t slot = 0; slot < store.size(); slot++) {
+        if (store.occupied(slot)) live.push_back(store.at(slot));
+    }
+    return live;
 }
 
 std::vector<StrokeShape> DrawingEngine::getStrokes() const {
     std::vector<StrokeShape> strokes;
-    for (const auto& shape : shapes) {
-        if (shape->type == ShapeType::Stroke) {
-            const StrokeShape* strokeShape = dynamic_cast<const StrokeShape*>(shape.get());
-            if (strokeShape) {
-                strokes.push_back(*strokeShape);
+    for (size_t slot = 0; slot < store.size(); slot++) {
+        const Shape* shape = store.at(slot);
+        if (shape && shape->type == ShapeType::Stroke) {
+            // Copies are detached, so hand them out with the transform applied
+            strokes.push_back(*static_cast<const StrokeShape*>(shape));
+            StrokeShape& copy = strokes.back();
+            if (!copy.transform.isIdentity()) {
+                for (Point& point : copy.points) point = copy.transform.apply(point);
+                copy.transform = Affine();
             }
         }
     }
@@ -113,45 +790,1111 @@ std::vector<StrokeShape> DrawingEngine::getStrokes() const {
 
 std::vector<float> DrawingEngine::getVertexBufferData() const {
     std::vector<float> data;
-    
-    for (const auto& shape : shapes) {
-        if (shape->type == ShapeType::Stroke) {
-            const StrokeShape* strokeShape = dynamic_cast<const StrokeShape*>(shape.get());
-            if (strokeShape) {
+    appendVertexData(data);
+    return data;
+}
+
+const std::vector<float>& DrawingEngine::getVertexBufferView() {
+    // Rebuilt in place, so the storage is reused until the board outgrows it
+    if (packedVersion != contentVersion) {
+        packedVertices.clear();
+        appendVertexData(packedVertices);
+        packedVersion = contentVersion;
+    }
+    refreshViewGeneration();
+    return packedVertices;
+}
+
+std::vector<float> DrawingEngine::getVertexBufferDataForViewport(const AABB& viewport, float zoom) {
+    std::vector<float> data;
+    appendViewportVertexData(data, viewport, zoom);
+    return data;
+}
+
+const std::vector<float>& DrawingEngine::getVertexBufferViewForViewport(const AABB& viewport, float zoom) {
+    viewportVertices.clear();
+    appendViewportVertexData(viewportVertices, viewport, zoom);
+    refreshViewGeneration();
+    return viewportVertices;
+}
+
+uint32_t DrawingEngine::getViewGeneration() const {
+    return viewGeneration;
+}
+
+uint64_t DrawingEngine::getContentVersion() const {
+    return contentVersion;
+}
+
+void DrawingEngine::appendVertexData(std::vector<float>& data) const {
+    data.reserve(data.size() + pointArena.livePoints() * GpuBuffers::FloatsPerVertex);
+
+    thread_local std::vector<Point> outline;
+    for (size_t slot = 0; slot < store.size(); slot++) {
+        if (!store.occupied(slot)) continue;
+        store.visit(slot, [&](const auto& shape) {
+            if constexpr (isStrokeType<decltype(shape)>) {
                 // For each stroke, create vertices for WebGPU
                 // Format: [x, y, r, g, b, a, thickness] for each point
-                for (const auto& point : strokeShape->points) {
-                    data.push_back(point.x);
-                    data.push_back(point.y);
-                    data.push_back(strokeShape->color.r);
-                    data.push_back(strokeShape->color.g);
-                    data.push_back(strokeShape->color.b);
-                    data.push_back(strokeShape->color.a);
-                    data.push_back(strokeShape->thickness);
+                const float* xs = pointArena.xData(shape.range);
+                const float* ys = pointArena.yData(shape.range);
+                const Affine& transform = shape.transform;
+                bool identity = transform.isIdentity();
+                size_t at = data.size();
+                data.resize(at + size_t(shape.range.length) * GpuBuffers::FloatsPerVertex);
+                float* vertex = data.data() + at;
+                for (uint32_t i = 0; i < shape.range.length; i++, vertex += GpuBuffers::FloatsPerVertex) {
+                    Point point = identity ? Point(xs[i], ys[i]) : transform.apply(Point(xs[i], ys[i]));
+                    writeVertex(vertex, point, shape);
                 }
+            } else {
+                outline.clear();
+                appendOutline(shape, OutlineTolerance, outline);
+                for (const Point& point : outline) pushVertex(data, point, shape);
+            }
+        });
+    }
+}
+
+void DrawingEngine::setTessellationStyle(const TessellationStyle& style) {
+    tessellationStyle = style;
+    meshCache.clear();
+    meshRebuild = true;
+}
+
+const TessellationStyle& DrawingEngine::getTessellationStyle() const {
+    return tessellationStyle;
+}
+
+const StrokeMesh& DrawingEngine::getStrokeMesh(ShapeId id) {
+    static const StrokeMesh empty;
+    int64_t slot = idToSlot.find(id);
+    if (slot < 0) return empty;
+    return shapeMesh(*store.at(slot));
+}
+
+const StrokeMesh& DrawingEngine::getTessellation() {
+    // Only shapes that changed since the last call are re-tessellated, and
+    // only their part of the board mesh is rewritten
+    if (meshRebuild) {
+        meshDirty.clear();
+        meshRanges.clear();
+        boardMesh.clear();
+        packBoardMesh(0);
+        meshRebuild = false;
+    } else if (!meshDirty.empty()) {
+        std::sort(meshDirty.begin(), meshDirty.end());
+        meshDirty.erase(std::unique(meshDirty.begin(), meshDirty.end()), meshDirty.end());
+        for (uint32_t slot : meshDirty) {
+            if (slot >= meshRanges.size()) {
+                packBoardMesh(slot);  // new shapes on top
+                break;
+            }
+            static const StrokeMesh empty;
+            const StrokeMesh& mesh = store.occupied(slot) ? shapeMesh(*store.at(slot)) : empty;
+            MeshRange& range = meshRanges[slot];
+            if (mesh.vertexCount() != range.vertexCount || mesh.indices.size() != range.indexCount) {
+                packBoardMesh(slot);
+                break;
             }
+            std::copy(mesh.vertices.begin(), mesh.vertices.end(),
+                      boardMesh.vertices.begin() + size_t(range.firstVertex) * StrokeMesh::FloatsPerVertex);
+            uint32_t* indices = boardMesh.indices.data() + range.firstIndex;
+            for (size_t k = 0; k < mesh.indices.size(); k++) indices[k] = range.firstVertex + mesh.indices[k];
+        }
+        meshDirty.clear();
+    }
+    refreshViewGeneration();
+    return boardMesh;
+}
+
+// Drops the board mesh from fromSlot up and appends those slots' meshes again
+void DrawingEngine::packBoardMesh(size_t fromSlot) {
+    if (fromSlot < meshRanges.size()) {
+        boardMesh.vertices.resize(size_t(meshRanges[fromSlot].firstVertex) * StrokeMesh::FloatsPerVertex);
+        boardMesh.indices.resize(meshRanges[fromSlot].firstIndex);
+    }
+    meshRanges.resize(store.size());
+    for (size_t slot = fromSlot; slot < store.size(); slot++) {
+        MeshRange& range = meshRanges[slot];
+        range.firstVertex = boardMesh.vertexCount();
+        range.firstIndex = static_cast<uint32_t>(boardMesh.indices.size());
+        range.vertexCount = 0;
+        range.indexCount = 0;
+        if (!store.occupied(slot)) continue;
+        const StrokeMesh& mesh = shapeMesh(*store.at(slot));
+        boardMesh.append(mesh);
+        range.vertexCount = mesh.vertexCount();
+        range.indexCount = static_cast<uint32_t>(mesh.indices.size());
+    }
+}
+
+// Queues the slot for the next getTessellation(); past one entry per slot
+// the whole mesh is cheaper to re-pack than to patch
+void DrawingEngine::meshChanged(uint32_t slot) {
+    if (meshRebuild || (!meshDirty.empty() && meshDirty.back() == slot)) return;
+    meshDirty.push_back(slot);
+    if (meshDirty.size() > store.size()) {
+        std::sort(meshDirty.begin(), meshDirty.end());
+        meshDirty.erase(std::unique(meshDirty.begin(), meshDirty.end()), meshDirty.end());
+        if (meshDirty.size() * 2 > store.size()) {
+            meshDirty.clear();
+            meshRebuild = true;
         }
-        // Add other shape types here as needed
-        // else if (shape->type == ShapeType::Rectangle) { ... }
     }
-    
-    return data;
 }
 
+std::vector<uint8_t> DrawingEngine::saveSnapshot(float quantum) const {
+    if (!(quantum > 0.0f)) quantum = Snapshot::DefaultQuantum;
 
+    std::vector<Snapshot::ShapeRecord> records;
+    std::vector<uint8_t> pointStream;
+    records.reserve(idToSlot.size());
+    pointStream.reserve(pointArena.livePoints() * 2);
+    uint32_t pointCount = 0;
+
+    for (size_t slot = 0; slot < store.size(); slot++) {
+        const Shape* shape = store.at(slot);
+        if (!shape) continue;
+        Snapshot::ShapeRecord record = {};
+        record.id = shape->id;
+        record.rgba = Snapshot::packColor(shape->color);
+        record.thickness = shape->thickness;
+        Snapshot::packTransform(Affine(), record.transform);
 
-void DrawingEngine::simplifyStroke(int index, float epsilon) {
-    int strokeCount = 0;
-    for (auto& shape : shapes) {
         if (shape->type == ShapeType::Stroke) {
-            if (strokeCount == index) {
-                StrokeShape* strokeShape = dynamic_cast<StrokeShape*>(shape.get());
-                if (strokeShape) {
-                    strokeShape->simplify(epsilon);
+            const StrokeShape& stroke = *static_cast<const StrokeShape*>(shape);
+            record.kind = Snapshot::KindStroke;
+            record.pointCount = stroke.range.length;
+            record.pointOffset = pointStream.size();
+
+            // Transforms are baked into the saved points
+            const float* xs = pointArena.xData(stroke.range);
+            const float* ys = pointArena.yData(stroke.range);
+            bool identity = stroke.transform.isIdentity();
+            int64_t lastX = 0, lastY = 0;
+            for (uint32_t i = 0; i < stroke.range.length; i++) {
+                Point point = identity ? Point(xs[i], ys[i]) : stroke.transform.apply(Point(xs[i], ys[i]));
+                int64_t qx = Snapshot::quantize(point.x, quantum);
+                int64_t qy = Snapshot::quantize(point.y, quantum);
+                Varint::writeSigned(pointStream, qx - lastX);
+                Varint::writeSigned(pointStream, qy - lastY);
+                lastX = qx;
+                lastY = qy;
+            }
+            pointCount += stroke.range.length;
+        } else if (shape->type == ShapeType::Rectangle) {
+            const RectangleShape& rect = *static_cast<const RectangleShape*>(shape);
+            record.kind = Snapshot::KindRectangle;
+            record.geometry[0] = rect.topLeft.x;
+            record.geometry[1] = rect.topLeft.y;
+            record.geometry[2] = rect.bottomRight.x;
+            record.geometry[3] = rect.bottomRight.y;
+            Snapshot::packTransform(rect.transform, record.transform);
+        } else if (shape->type == ShapeType::Ellipse) {
+            const EllipseShape& ellipse = *static_cast<const EllipseShape*>(shape);
+            record.kind = Snapshot::KindEllipse;
+            record.geometry[0] = ellipse.center.x;
+            record.geometry[1] = ellipse.center.y;
+            record.geometry[2] = ellipse.radiusX;
+            record.geometry[3] = ellipse.radiusY;
+            Snapshot::packTransform(ellipse.transform, record.transform);
+        } else {
+            continue;  // no snapshot encoding yet
+        }
+        records.push_back(record);
+    }
+
+    Snapshot::Header header = {};
+    std::memcpy(header.magic, Snapshot::Magic, sizeof(header.magic));
+    header.version = Snapshot::Version;
+    header.headerSize = sizeof(Snapshot::Header);
+    header.shapeCount = static_cast<uint32_t>(records.size());
+    header.pointCount = pointCount;
+    header.nextId = nextId;
+    header.quantum = quantum;
+    header.pointBytes = static_cast<uint32_t>(pointStream.size());
+
+    std::vector<uint8_t> out(sizeof(header) + records.size() * sizeof(Snapshot::ShapeRecord) + pointStream.size());
+    uint8_t* write = out.data();
+    std::memcpy(write, &header, sizeof(header));
+    write += sizeof(header);
+    if (!records.empty()) std::memcpy(write, records.data(), records.size() * sizeof(Snapshot::ShapeRecord));
+    write += records.size() * sizeof(Snapshot::ShapeRecord);
+    if (!pointStream.empty()) std::memcpy(write, pointStream.data(), pointStream.size());
+    return out;
+}
+
+bool DrawingEngine::loadSnapshot(const uint8_t* data, size_t size) {
+    Snapshot::Header header;
+    if (!data || size < sizeof(header)) return false;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, Snapshot::Magic, sizeof(header.magic)) != 0) return false;
+    if (header.version < 1 || header.version > Snapshot::Version || header.headerSize < sizeof(header)) return false;
+    if (!(header.quantum > 0.0f) || !std::isfinite(header.quantum)) return false;
+
+    size_t recordSize = header.version == 1 ? Snapshot::RecordSizeV1 : sizeof(Snapshot::ShapeRecord);
+    uint64_t tableBytes = uint64_t(header.shapeCount) * recordSize;
+    if (uint64_t(header.headerSize) + tableBytes + header.pointBytes > size) return false;
+    const uint8_t* table = data + header.headerSize;
+    const uint8_t* stream = table + tableBytes;
+    const uint8_t* streamEnd = stream + header.pointBytes;
+
+    // Version 1 records lack the transform and read as untransformed
+    auto recordAt = [&](uint32_t i) {
+        Snapshot::ShapeRecord record;
+        Snapshot::packTransform(Affine(), record.transform);
+        std::memcpy(&record, table + size_t(i) * recordSize, recordSize);
+        return record;
+    };
+
+    // Validate everything first so a bad snapshot leaves the board alone
+    uint64_t totalPoints = 0;
+    for (uint32_t i = 0; i < header.shapeCount; i++) {
+        Snapshot::ShapeRecord record = recordAt(i);
+        for (float v : record.transform) {
+            if (!std::isfinite(v)) return false;
+        }
+        if (record.kind == Snapshot::KindRectangle || record.kind == Snapshot::KindEllipse) continue;
+        if (record.kind != Snapshot::KindStroke || record.pointOffset > header.pointBytes) return false;
+
+        const uint8_t* p = stream + record.pointOffset;
+        uint64_t value;
+        for (uint64_t k = 0; k < uint64_t(record.pointCount) * 2; k++) {
+            if (!Varint::read(p, streamEnd, value)) return false;
+        }
+        totalPoints += record.pointCount;
+    }
+    if (totalPoints > UINT32_MAX) return false;
+
+    clear();
+    history.paused = true;  // a load is not an undoable edit
+    store.reserve(header.shapeCount);
+    gpu.slots.reserve(header.shapeCount);
+    gpu.drawCommands.reserve(size_t(header.shapeCount) * GpuBuffers::WordsPerDrawCommand);
+    slotBounds.reserve(header.shapeCount);
+    pointArena.reserve(totalPoints);
+
+    for (uint32_t i = 0; i < header.shapeCount; i++) {
+        Snapshot::ShapeRecord record = recordAt(i);
+        Color color = Snapshot::unpackColor(record.rgba);
+
+        if (record.kind == Snapshot::KindStroke) {
+            // Decode straight into the arena; no intermediate point vector
+            auto stroke = std::make_unique<StrokeShape>(color, record.thickness);
+            stroke->id = record.id;
+            stroke->range = pointArena.allocateLive(record.pointCount);
+            stroke->arena = &pointArena;
+            float* xs = pointArena.xData(stroke->range);
+            float* ys = pointArena.yData(stroke->range);
+
+            const uint8_t* p = stream + record.pointOffset;
+            int64_t x = 0, y = 0, dx, dy;
+            for (uint32_t k = 0; k < record.pointCount; k++) {
+                if (!Varint::readSigned(p, streamEnd, dx) || !Varint::readSigned(p, streamEnd, dy)) {
+                    // The validation pass rules this out; still never keep a half-decoded board
+                    clear();
+                    history.paused = false;
+                    return false;
                 }
-                return;
+                x += dx;
+                y += dy;
+                xs[k] = Snapshot::dequantize(x, header.quantum);
+                ys[k] = Snapshot::dequantize(y, header.quantum);
             }
+            addShape(std::move(stroke));
+        } else if (record.kind == Snapshot::KindEllipse) {
+            Point center(record.geometry[0], record.geometry[1]);
+            auto ellipse = std::make_unique<EllipseShape>(center, record.geometry[2], record.geometry[3], color, record.thickness);
+            ellipse->id = record.id;
+            ellipse->transform = Snapshot::unpackTransform(record.transform);
+            addShape(std::move(ellipse));
+        } else {
+            Point topLeft(record.geometry[0], record.geometry[1]);
+            Point bottomRight(record.geometry[2], record.geometry[3]);
+            auto rect = std::make_unique<RectangleShape>(topLeft, bottomRight, color, record.thickness);
+            rect->id = record.id;
+            rect->transform = Snapshot::unpackTransform(record.transform);
+            addShape(std::move(rect));
+        }
+    }
+    history.paused = false;
+    nextId = std::max(nextId, header.nextId);
+    return true;
+}
+
+bool DrawingEngine::saveSnapshotFile(const std::string& path, float quantum) const {
+    std::vector<uint8_t> bytes = saveSnapshot(quantum);
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) return false;
+    bool ok = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    return fclose(file) == 0 && ok;
+}
+
+bool DrawingEngine::loadSnapshotFile(const std::string& path) {
+#ifndef __EMSCRIPTEN__
+    // Map the file so the shape table is read in place, not copied first
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) return false;
+    bool ok = loadSnapshot(static_cast<const uint8_t*>(mapped), size);
+    munmap(mapped, size);
+    return ok;
+#else
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+    std::vector<uint8_t> bytes;
+    uint8_t buffer[65536];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) bytes.insert(bytes.end(), buffer, buffer + n);
+    fclose(file);
+    return loadSnapshot(bytes.data(), bytes.size());
+#endif
+}
+
+void DrawingEngine::simplifyStroke(int index, float epsilon) {
+    int64_t slot = strokeSlot(index);
+    if (slot >= 0) {
+        simplifyStrokeById(store.at(slot)->id, epsilon);
+    }
+}
+
+GpuBufferUpdate DrawingEngine::takeGpuBufferUpdate() {
+    syncGpuBuffers();
+    refreshViewGeneration();
+    return gpu.takeUpdate();
+}
+
+const std::vector<float>& DrawingEngine::getGpuVertices() const {
+    return gpu.vertices;
+}
+
+const std::vector<uint32_t>& DrawingEngine::getGpuDrawCommands() const {
+    return gpu.drawCommands;
+}
+
+int64_t DrawingEngine::strokeSlot(int strokeIndex) const {
+    if (strokeIndex < 0) return -1;
+
+    int strokeCount = 0;
+    for (size_t slot = 0; slot < store.size(); slot++) {
+        if (store.occupied(slot) && store.ref(slot).type == ShapeType::Stroke) {
+            if (strokeCount == strokeIndex) return slot;
             strokeCount++;
         }
     }
+    return -1;
+}
+
+int64_t DrawingEngine::shapeSlot(int index) const {
+    if (index < 0 || index >= static_cast<int>(idToSlot.size())) return -1;
+
+    int shapeCount = 0;
+    for (size_t slot = 0; slot < store.size(); slot++) {
+        if (store.occupied(slot)) {
+            if (shapeCount == index) return slot;
+            shapeCount++;
+        }
+    }
+    return -1;
+}
+
+void DrawingEngine::attachStroke(StrokeShape* stroke) {
+    if (stroke->arena == &pointArena) return;
+
+    stroke->range = pointArena.store(stroke->points);
+    stroke->arena = &pointArena;
+    stroke->points.clear();
+    stroke->points.shrink_to_fit();
+}
+
+// With settle false the caller compacts (or trims history) once it is done
+// with slot numbers
+void DrawingEngine::eraseSlot(size_t slot, bool settle) {
+    if (recording()) {
+        // Undoable: keep the shape and its points until history lets go
+        bool merged;
+        recordOp(HistoryOp::Erase, store.at(slot)->id, merged);
+        parkSlot(slot);
+        if (settle) trimHistory();
+        return;
+    }
+
+    if (store.ref(slot).type == ShapeType::Stroke) {
+        pointArena.release(static_cast<StrokeShape*>(store.at(slot))->range);
+    }
+    if (!transformed.empty()) transformed.erase(store.at(slot)->id);
+    detachSlot(slot);
+    store.release(store.detach(slot));
+    erasedSlots++;
+    if (settle) compactIfSparse();
+}
+
+// Amortized: each compaction pays for at least as many erases
+void DrawingEngine::compactIfSparse() {
+    if (erasedSlots > 32 && erasedSlots > idToSlot.size()) {
+        compactSlots();
+    }
+    if (pointArena.wantsCompaction()) {
+        compactArena();
+    }
+}
+
+// Removes the shape from every index, leaving its slot empty
+void DrawingEngine::detachSlot(size_t slot) {
+    ShapeId id = store.at(slot)->id;
+    gpu.releaseSlot(slot);
+    if (!lodCache.empty()) lodCache.erase(id);
+    if (!inking.empty()) inking.erase(id);
+    if (!meshCache.empty()) meshCache.erase(id);
+    meshChanged(static_cast<uint32_t>(slot));
+    grid.remove(id, slotBounds[slot]);
+    slotBounds.set(slot, AABB());
+    selection.reset(static_cast<uint32_t>(slot));
+    contentVersion++;
+    idToSlot.erase(id);
+}
+
+void DrawingEngine::compactSlots() {
+    // Parked shapes are coming back to their slot; keep those in order too
+    std::vector<ShapeId> parkedAt;
+    if (!parked.empty()) {
+        parkedAt.assign(store.size(), 0);
+        for (const auto& entry : parked) parkedAt[entry.second.slot] = entry.first;
+    }
+
+    // Empty slots hold no triangles, so the board mesh stays as it is and
+    // only its ranges move, unless it is behind the slots anyway
+    bool keepMesh = !meshRebuild && meshDirty.empty() && meshRanges.size() == store.size();
+
+    SlotBitset moved;
+    size_t write = 0;
+    for (size_t read = 0; read < store.size(); read++) {
+        ShapeId parkedId = parkedAt.empty() ? 0 : parkedAt[read];
+        if (!store.occupied(read) && !parkedId) continue;
+        if (selection.test(static_cast<uint32_t>(read))) moved.set(static_cast<uint32_t>(write));
+        if (write != read) {
+            store.moveSlot(read, write);
+            gpu.slots[write] = gpu.slots[read];
+            slotBounds.moveLeaf(read, write);
+            if (keepMesh) meshRanges[write] = meshRanges[read];
+            if (parkedId) {
+                parked.find(parkedId)->second.slot = static_cast<uint32_t>(write);
+            } else {
+                idToSlot.assign(store.at(write)->id, static_cast<uint32_t>(write));
+            }
+        }
+        write++;
+    }
+    store.truncate(write);
+    slotBounds.truncate(write);
+    if (keepMesh) {
+        meshRanges.resize(write);
+    } else {
+        meshDirty.clear();
+        meshRebuild = true;
+    }
+    selection = std::move(moved);
+    erasedSlots = 0;
+
+    // Slot numbers changed: rebuild the pending list and every draw command
+    gpu.truncateSlots(write);
+    gpu.pending.clear();
+    for (uint32_t slot = 0; slot < write; slot++) {
+        GpuSlot& record = gpu.slots[slot];
+        if (record.queued) gpu.pending.push_back(slot);
+        gpu.setDrawCommand(slot, record.syncedVertices, record.vertexOffset);
+    }
+}
+
+void DrawingEngine::compactArena() {
+    pointArena.compact([this](auto visit) {
+        // Parked strokes stay in the pool, so this covers them too; freed
+        // entries have empty ranges and pack to nothing
+        for (auto& stroke : store.strokePool()) visit(stroke.range);
+    });
+}
+
+void DrawingEngine::syncGpuBuffers() {
+    if (gpu.wantsCompaction()) {
+        // Too many abandoned spans: lay every shape out again from scratch
+        gpu.resetLayout();
+        gpu.pending.clear();
+        for (uint32_t slot = 0; slot < store.size(); slot++) {
+            gpu.slots[slot].queued = false;
+            if (store.occupied(slot)) gpu.queue(slot, true);
+        }
+    }
+
+    thread_local std::vector<Point> outline;
+    for (uint32_t slot : gpu.pending) {
+        GpuSlot& record = gpu.slots[slot];
+        record.queued = false;
+        if (!store.occupied(slot)) {
+            record.rewrite = false;
+            continue;
+        }
+
+        // Outlines only ever change whole, so they are always rewritten
+        uint32_t from = 0, count = 0;
+        store.visit(slot, [&](const auto& shape) {
+            if constexpr (isStrokeType<decltype(shape)>) {
+                count = shape.range.length;
+                bool moved = gpu.reserve(slot, count);
+                from = (record.rewrite || moved) ? 0 : record.syncedVertices;
+                writeStrokeVertices(shape, record, from, count);
+            } else {
+                outline.clear();
+                appendOutline(shape, OutlineTolerance, outline);
+                count = static_cast<uint32_t>(outline.size());
+                gpu.reserve(slot, count);
+                for (uint32_t i = 0; i < count; i++) writeVertex(gpu.vertexAt(record, i), outline[i], shape);
+            }
+        });
+        gpu.markVertices(record, from, count);
+        gpu.liveVertices = gpu.liveVertices + count - record.syncedVertices;
+        record.syncedVertices = count;
+        record.rewrite = false;
+        gpu.setDrawCommand(slot, count, record.vertexOffset);
+    }
+    gpu.pending.clear();
+}
+
+void DrawingEngine::writeStrokeVertices(const StrokeShape& stroke, const GpuSlot& record, uint32_t from, uint32_t to) {
+    const float* xs = pointArena.xData(stroke.range);
+    const float* ys = pointArena.yData(stroke.range);
+    bool identity = stroke.transform.isIdentity();
+    for (uint32_t i = from; i < to; i++) {
+        Point point = identity ? Point(xs[i], ys[i]) : stroke.transform.apply(Point(xs[i], ys[i]));
+        writeVertex(gpu.vertexAt(record, i), point, stroke);
+    }
+}
+
+void DrawingEngine::shapeChanged(uint32_t slot, bool rewrite) {
+    gpu.queue(slot, rewrite);
+    contentVersion++;
+    if (!lodCache.empty()) lodCache.erase(store.at(slot)->id);
+    if (!meshCache.empty()) meshCache.erase(store.at(slot)->id);
+    meshChanged(slot);
+}
+
+// The simplifier's window no longer matches the stroke; carry on from its end
+void DrawingEngine::restartInking(uint32_t slot) {
+    if (inking.empty()) return;
+    auto it = inking.find(store.at(slot)->id);
+    if (it == inking.end()) return;
+
+    const StrokeShape& stroke = *static_cast<const StrokeShape*>(store.at(slot));
+    if (stroke.range.length > 0) {
+        it->second.restart(stroke.transform.apply(stroke.pointAt(stroke.range.length - 1)));
+    } else {
+        it->second.reset();
+    }
+}
+
+void DrawingEngine::parkSlot(size_t slot) {
+    ShapeId id = store.at(slot)->id;
+    AABB bounds = slotBounds[slot];
+    detachSlot(slot);
+    size_t bytes = parkedBytes(*store.at(slot));
+    history.bytes += bytes;
+    parked.emplace(id, ParkedShape{store.detach(slot), static_cast<uint32_t>(slot), bounds, bytes});
+}
+
+bool DrawingEngine::unpark(ShapeId id) {
+    auto it = parked.find(id);
+    if (it == parked.end()) return false;
+
+    uint32_t slot = it->second.slot;
+    history.bytes -= it->second.bytes;
+    store.attach(slot, it->second.ref);
+    idToSlot.assign(id, slot);
+    setBounds(slot, it->second.bounds);
+    parked.erase(it);
+    shapeChanged(slot, true);
+    return true;
+}
+
+// Turns a parked shape into an ordinary erased slot. Compaction waits for
+// trimHistory(), since callers may still be holding slot numbers.
+void DrawingEngine::releaseParked(ShapeId id) {
+    auto it = parked.find(id);
+    if (it == parked.end()) return;
+
+    ShapeRef ref = it->second.ref;
+    history.bytes -= it->second.bytes;
+    if (ref.type == ShapeType::Stroke) pointArena.release(static_cast<StrokeShape&>(store.get(ref)).range);
+    store.release(ref);
+    if (!transformed.empty()) transformed.erase(id);
+    parked.erase(it);
+    erasedSlots++;
+}
+
+// Composes transform after the shape's own in O(1): bounds come from the
+// shape's own untransformed box, not the points
+void DrawingEngine::composeTransform(uint32_t slot, const Affine& transform) {
+    Shape& shape = *store.at(slot);
+    float pad = shape.thickness * 0.5f;
+    transformed[shape.id].touched = true;
+    shape.transform = shape.transform.then(transform);
+
+    setBounds(slot, inflate(shape.transform.applyBox(geometryBounds(shape)), pad));
+    shapeChanged(slot, true);
+    restartInking(slot);
+}
+
+// Folds the shape's transform into its geometry. Rotated or sheared
+// rectangles and ellipses cannot be expressed by corners or radii and keep
+// theirs.
+bool DrawingEngine::bakeTransform(uint32_t slot) {
+    Shape& shape = *store.at(slot);
+    const Affine& t = shape.transform;
+    if (t.isIdentity()) {
+        transformed.erase(shape.id);
+        return false;
+    }
+
+    if (shape.type == ShapeType::Stroke) {
+        StrokeShape& stroke = static_cast<StrokeShape&>(shape);
+        float* xs = pointArena.xData(stroke.range);
+        float* ys = pointArena.yData(stroke.range);
+        stroke.bounds = AABB();
+        for (uint32_t i = 0; i < stroke.range.length; i++) {
+            Point point = t.apply(Point(xs[i], ys[i]));
+            xs[i] = point.x;
+            ys[i] = point.y;
+            stroke.bounds.expand(point.x, point.y);
+        }
+    } else if (shape.type == ShapeType::Rectangle && t.axisAligned()) {
+        RectangleShape& rect = static_cast<RectangleShape&>(shape);
+        Point p = t.apply(rect.topLeft), q = t.apply(rect.bottomRight);
+        rect.topLeft = Point(std::min(p.x, q.x), std::min(p.y, q.y));
+        rect.bottomRight = Point(std::max(p.x, q.x), std::max(p.y, q.y));
+    } else if (shape.type == ShapeType::Ellipse && t.axisAligned()) {
+        EllipseShape& ellipse = static_cast<EllipseShape&>(shape);
+        ellipse.center = t.apply(ellipse.center);
+        ellipse.radiusX *= std::fabs(t.a);
+        ellipse.radiusY *= std::fabs(t.d);
+    } else {
+        return false;
+    }
+
+    shape.transform = Affine();
+    transformed.erase(shape.id);
+    setBounds(slot, computeBounds(shape));
+    shapeChanged(slot, true);
+    restartInking(slot);
+    return true;
+}
+
+// Exchanges the stroke's points from op.prefix on with op.tail. Bounds only
+// grow here, like inking's replaced points; they stay a valid cover.
+void DrawingEngine::swapPoints(uint32_t slot, HistoryOp& op) {
+    // Saved points are untransformed world positions
+    if (!store.at(slot)->transform.isIdentity()) bakeTransform(slot);
+    StrokeShape& stroke = *static_cast<StrokeShape*>(store.at(slot));
+    size_t before = op.bytes();
+    uint32_t prefix = std::min(op.prefix, stroke.range.length);
+
+    std::vector<Point> current;
+    current.reserve(stroke.range.length - prefix);
+    for (uint32_t i = prefix; i < stroke.range.length; i++) current.push_back(pointArena.get(stroke.range, i));
+    pointArena.truncate(stroke.range, prefix);
+
+    AABB box = slotBounds[slot];
+    float pad = stroke.thickness * 0.5f;
+    for (const Point& pt : op.tail) {
+        pointArena.append(stroke.range, pt);
+        stroke.bounds.expand(pt.x, pt.y);
+        box.expand(pt.x, pt.y, pad);
+    }
+    op.tail.swap(current);
+    history.bytes = history.bytes + op.bytes() - before;
+
+    if (box != slotBounds[slot]) setBounds(slot, box);
+    gpu.rewind(slot, prefix);
+    shapeChanged(slot, false);
+    restartInking(slot);
+}
+
+bool DrawingEngine::recording() const {
+    return history.budget > 0 && !history.paused;
+}
+
+// The op a new change should be written into: the last op of the open step
+// when it is the same change to the same shape (merged = true), otherwise a
+// new op, in the open group's step or a step of its own.
+HistoryOp& DrawingEngine::recordOp(HistoryOp::Kind kind, ShapeId id, bool& merged, const std::vector<ShapeId>* ids) {
+    // A new change makes the redo side unreachable
+    while (!history.redo.empty()) {
+        dropHistoryStep(history.redo.back(), false);
+        history.redo.pop_back();
+    }
+
+    HistoryStep* step = nullptr;
+    if (!history.undo.empty() && !history.undo.back().sealed && (history.groupDepth == 0 || history.groupOpen)) {
+        step = &history.undo.back();
+    }
+    merged = false;
+    if (step) {
+        HistoryOp& last = step->ops.back();
+        bool repeatable = kind != HistoryOp::Add && kind != HistoryOp::Erase;
+        bool sameIds = ids ? last.ids == *ids : last.ids.empty();
+        if (repeatable && last.kind == kind && last.id == id && sameIds) {
+            merged = true;
+            return last;
+        }
+        if (history.groupDepth == 0) step = nullptr;
+    }
+    if (!step) {
+        history.undo.emplace_back();
+        step = &history.undo.back();
+        history.groupOpen = history.groupDepth > 0;
+    }
+    step->ops.emplace_back(kind, id);
+    if (ids) step->ops.back().ids = *ids;
+    history.bytes += step->ops.back().bytes();
+    return step->ops.back();
+}
+
+// Saves what a change to a stroke's points from firstChanged on overwrites
+void DrawingEngine::recordPoints(uint32_t slot, uint32_t firstChanged) {
+    const StrokeShape& stroke = *static_cast<const StrokeShape*>(store.at(slot));
+
+    // A stroke added in the open step is undone whole; its points need no copy
+    if (!history.undo.empty() && !history.undo.back().sealed && (history.groupDepth == 0 || history.groupOpen)) {
+        const HistoryOp& last = history.undo.back().ops.back();
+        if (last.kind == HistoryOp::Add && last.id == stroke.id) return;
+    }
+
+    bool merged;
+    HistoryOp& op = recordOp(HistoryOp::Points, stroke.id, merged);
+    size_t before = op.bytes();
+    if (!merged) {
+        op.prefix = firstChanged;
+        for (uint32_t i = firstChanged; i < stroke.range.length; i++) op.tail.push_back(pointArena.get(stroke.range, i));
+    } else if (firstChanged < op.prefix) {
+        // Points from before the step start are changing too; keep them
+        std::vector<Point> older;
+        older.reserve(op.prefix - firstChanged + op.tail.size());
+        for (uint32_t i = firstChanged; i < op.prefix; i++) older.push_back(pointArena.get(stroke.range, i));
+        older.insert(older.end(), op.tail.begin(), op.tail.end());
+        op.tail.swap(older);
+        op.prefix = firstChanged;
+    }
+    history.bytes = history.bytes + op.bytes() - before;
+}
+
+void DrawingEngine::applyHistoryOp(HistoryOp& op, bool undoing) {
+    int64_t slot = idToSlot.find(op.id);
+    switch (op.kind) {
+        case HistoryOp::Add:
+        case HistoryOp::Erase:
+            // Undoing an add and redoing an erase both hide the shape again
+            if ((op.kind == HistoryOp::Add) == undoing) {
+                if (slot >= 0) parkSlot(slot);
+            } else {
+                unpark(op.id);
+            }
+            break;
+        case HistoryOp::Move:
+        case HistoryOp::Transform: {
+            Affine change = op.kind == HistoryOp::Move
+                ? Affine::translation(undoing ? -op.dx : op.dx, undoing ? -op.dy : op.dy)
+                : (undoing ? op.transform.inverse() : op.transform);
+            if (slot >= 0) composeTransform(slot, change);
+            for (ShapeId id : op.ids) {
+                int64_t member = idToSlot.find(id);
+                if (member >= 0) composeTransform(member, change);
+            }
+            break;
+        }
+        case HistoryOp::Recolor:
+            if (slot >= 0) {
+                std::swap(store.at(slot)->color, op.color);
+                shapeChanged(slot, true);
+            }
+            break;
+        case HistoryOp::Thickness:
+            if (slot >= 0) {
+                std::swap(store.at(slot)->thickness, op.thickness);
+                setBounds(slot, computeBounds(*store.at(slot)));
+                shapeChanged(slot, true);
+            }
+            break;
+        case HistoryOp::Points:
+            if (slot >= 0 && store.ref(slot).type == ShapeType::Stroke) swapPoints(slot, op);
+            break;
+    }
+}
+
+// Forgets a step. Shapes only it could bring back (erased ones on the undo
+// side, undone adds on the redo side) are released for good.
+void DrawingEngine::dropHistoryStep(HistoryStep& step, bool undoSide) {
+    HistoryOp::Kind restores = undoSide ? HistoryOp::Erase : HistoryOp::Add;
+    for (const HistoryOp& op : step.ops) {
+        history.bytes -= op.bytes();
+        if (op.kind == restores) releaseParked(op.id);
+    }
+    step.ops.clear();
+}
+
+// Evicts the oldest steps until history fits its budget, then reclaims the
+// slots and points that released parked shapes left behind
+void DrawingEngine::trimHistory() {
+    while (history.bytes > history.budget && history.undo.size() > 1) {
+        dropHistoryStep(history.undo.front(), true);
+        history.undo.pop_front();
+    }
+    while (history.bytes > history.budget && !history.redo.empty()) {
+        dropHistoryStep(history.redo.front(), false);
+        history.redo.pop_front();
+    }
+    compactIfSparse();
+}
+
+void DrawingEngine::refreshViewGeneration() {
+    std::array<uintptr_t, 14> views = {
+        reinterpret_cast<uintptr_t>(packedVertices.data()), packedVertices.size(),
+        reinterpret_cast<uintptr_t>(viewportVertices.data()), viewportVertices.size(),
+        reinterpret_cast<uintptr_t>(gpu.vertices.data()), gpu.vertices.size(),
+        reinterpret_cast<uintptr_t>(gpu.drawCommands.data()), gpu.drawCommands.size(),
+        reinterpret_cast<uintptr_t>(boardMesh.vertices.data()), boardMesh.vertices.size(),
+        reinterpret_cast<uintptr_t>(boardMesh.indices.data()), boardMesh.indices.size(),
+        reinterpret_cast<uintptr_t>(commandRing.words.data()), commandRing.words.size()
+    };
+    if (views != exportedViews) {
+        exportedViews = views;
+        viewGeneration++;
+    }
+}
+
+AABB DrawingEngine::computeBounds(const Shape& shape) const {
+    float pad = shape.thickness * 0.5f;
+    const Affine& t = shape.transform;
+    return ShapeStore::visitShape(shape, [&](const auto& typed) {
+        using Typed = std::decay_t<decltype(typed)>;
+        if constexpr (isStrokeType<Typed>) {
+            if (t.isIdentity()) return inflate(typed.bounds, pad);
+            // Transformed points, not the transformed box, for a tight fit
+            AABB box;
+            const float* xs = pointArena.xData(typed.range);
+            const float* ys = pointArena.yData(typed.range);
+            for (uint32_t i = 0; i < typed.range.length; i++) {
+                Point point = t.apply(Point(xs[i], ys[i]));
+                box.expand(point.x, point.y, pad);
+            }
+            return box;
+        } else if constexpr (std::is_same<Typed, EllipseShape>::value) {
+            // Exact extents of the transformed ellipse, not of its transformed box
+            Point center = t.apply(typed.center);
+            float halfWidth = std::hypot(t.a * typed.radiusX, t.c * typed.radiusY) + pad;
+            float halfHeight = std::hypot(t.b * typed.radiusX, t.d * typed.radiusY) + pad;
+            return AABB(center.x - halfWidth, center.y - halfHeight, center.x + halfWidth, center.y + halfHeight);
+        } else {
+            return inflate(t.applyBox(typed.getBounds()), pad);
+        }
+    });
+}
+
+// Untransformed geometry, without thickness padding
+AABB DrawingEngine::geometryBounds(const Shape& shape) const {
+    return ShapeStore::visitShape(shape, [](const auto& typed) -> AABB { return typed.getBounds(); });
+}
+
+void DrawingEngine::setBounds(uint32_t slot, const AABB& box) {
+    grid.update(store.at(slot)->id, slotBounds[slot], box);
+    slotBounds.set(slot, box);
+}
+
+bool DrawingEngine::shapeHit(const Shape& shape, float x, float y, float radius) const {
+    Point probe(x, y);
+    float reach = radius + shape.thickness * 0.5f;
+    return anyEdge(shape, [&](const Point& a, const Point& b) {
+        return RDP::pointToLineDistance(probe, a, b) <= reach;
+    });
+}
+
+// Whether the shape's outline, widened by half its thickness, reaches into rect
+bool DrawingEngine::shapeTouchesRect(const Shape& shape, const AABB& rect) const {
+    float pad = shape.thickness * 0.5f;
+    AABB box(rect.minX - pad, rect.minY - pad, rect.maxX + pad, rect.maxY + pad);
+
+    // Liang-Barsky: clip the segment a-b against box
+    auto segmentTouches = [&box](const Point& a, const Point& b) {
+        float t0 = 0.0f, t1 = 1.0f;
+        float dx = b.x - a.x, dy = b.y - a.y;
+        float p[4] = {-dx, dx, -dy, dy};
+        float q[4] = {a.x - box.minX, box.maxX - a.x, a.y - box.minY, box.maxY - a.y};
+        for (int i = 0; i < 4; i++) {
+            if (p[i] == 0.0f) {
+                if (q[i] < 0.0f) return false;
+                continue;
+            }
+            float r = q[i] / p[i];
+            if (p[i] < 0.0f) {
+                if (r > t1) return false;
+                t0 = std::max(t0, r);
+            } else {
+                if (r < t0) return false;
+                t1 = std::min(t1, r);
+            }
+        }
+        return true;
+    };
+    return anyEdge(shape, segmentTouches);
+}
+
+// Whether any of the shape's vertices lies inside polygon (even-odd rule)
+bool DrawingEngine::shapeInPolygon(const Shape& shape, const std::vector<Point>& polygon) const {
+    auto inside = [&polygon](const Point& p) {
+        bool in = false;
+        for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+            const Point& a = polygon[i];
+            const Point& b = polygon[j];
+            if ((a.y > p.y) != (b.y > p.y) && p.x < (b.x - a.x) * (p.y - a.y) / (b.y - a.y) + a.x) in = !in;
+        }
+        return in;
+    };
+
+    return ShapeStore::visitShape(shape, [&](const auto& typed) {
+        if constexpr (isStrokeType<decltype(typed)>) {
+            for (uint32_t i = 0; i < typed.range.length; i++) {
+                if (inside(typed.transform.apply(typed.pointAt(i)))) return true;
+            }
+        } else {
+            thread_local std::vector<Point> outline;
+            outline.clear();
+            appendOutline(typed, OutlineTolerance, outline);
+            for (const Point& point : outline) {
+                if (inside(point)) return true;
+            }
+        }
+        return false;
+    });
+}
+
+void DrawingEngine::appendViewportVertexData(std::vector<float>& data, const AABB& viewport, float zoom) {
+    // Deviations under half a pixel are invisible; below a quarter of a world
+    // unit there is nothing worth decimating, so emit raw points
+    const float pixelTolerance = 0.5f;
+    float tolerance = zoom > 0.0f ? pixelTolerance / zoom : INFINITY;
+    bool raw = tolerance < 0.25f;
+    int level = raw ? 0 : static_cast<int>(std::floor(std::log2(std::min(tolerance, 1e30f))));
+
+    thread_local std::vector<Point> outline;
+    for (ShapeId id : queryRect(viewport)) {
+        const Shape* shape = store.at(idToSlot.find(id));
+        if (shape->type != ShapeType::Stroke) {
+            // Ellipses get as many segments as the zoom makes visible
+            outline.clear();
+            appendOutline(*shape, tolerance, outline);
+            for (const Point& point : outline) pushVertex(data, point, *shape);
+            continue;
+        }
+
+        const StrokeShape& stroke = *static_cast<const StrokeShape*>(shape);
+        const Affine& transform = stroke.transform;
+        bool identity = transform.isIdentity();
+        bool strokeRaw = raw;
+        int strokeLevel = level;
+        if (!identity) {
+            // Decimate the untransformed points finely enough for the scale
+            float local = tolerance / std::max(transform.maxScale(), 1e-30f);
+            strokeRaw = local < 0.25f;
+            strokeLevel = strokeRaw ? 0 : static_cast<int>(std::floor(std::log2(std::min(local, 1e30f))));
+        }
+        auto emit = [&](float x, float y) {
+            if (!identity) {
+                Point point = transform.apply(Point(x, y));
+                x = point.x;
+                y = point.y;
+            }
+            data.push_back(x);
+            data.push_back(y);
+            data.push_back(stroke.color.r);
+            data.push_back(stroke.color.g);
+            data.push_back(stroke.color.b);
+            data.push_back(stroke.color.a);
+            data.push_back(stroke.thickness);
+        };
+
+        if (strokeRaw || stroke.range.length <= 2) {
+            const float* xs = pointArena.xData(stroke.range);
+            const float* ys = pointArena.yData(stroke.range);
+            for (uint32_t i = 0; i < stroke.range.length; i++) emit(xs[i], ys[i]);
+        } else {
+            for (const Point& point : lodPoints(stroke, strokeLevel)) emit(point.x, point.y);
+        }
+    }
+}
+
+const std::vector<Point>& DrawingEngine::lodPoints(const StrokeShape& stroke, int level) {
+    std::vector<LodLevel>& levels = lodCache[stroke.id];
+    for (const auto& cached : levels) {
+        if (cached.level == level) return cached.points;
+    }
+    levels.push_back({level, RDP::simplify(stroke.getPoints(), std::ldexp(1.0f, level))});
+    return levels.back().points;
+}
+
+const StrokeMesh& DrawingEngine::shapeMesh(const Shape& shape) {
+    auto it = meshCache.find(shape.id);
+    if (it != meshCache.end()) return it->second;
+
+    if (shape.type != ShapeType::Stroke) {
+        // Closed: start and end mid-edge with butt caps, so the two ends
+        // meet flush on a straight line and need no join
+        thread_local std::vector<Point> outline;
+        thread_local std::vector<float> loopX, loopY;
+        outline.clear();
+        appendOutline(shape, OutlineTolerance, outline);
+        loopX.clear();
+        loopY.clear();
+        Point seam((outline[0].x + outline[1].x) * 0.5f, (outline[0].y + outline[1].y) * 0.5f);
+        loopX.push_back(seam.x);
+        loopY.push_back(seam.y);
+        for (size_t i = 1; i < outline.size(); i++) {
+            loopX.push_back(outline[i].x);
+            loopY.push_back(outline[i].y);
+        }
+        loopX.push_back(seam.x);
+        loopY.push_back(seam.y);
+
+        TessellationStyle closed = tessellationStyle;
+        closed.cap = CapStyle::Butt;
+        StrokeMesh& mesh = meshCache[shape.id];
+        Tessellator::tessellate(loopX.data(), loopY.data(), loopX.size(), shape.color, shape.thickness, closed, mesh);
+        return mesh;
+    }
+
+    const StrokeShape& stroke = static_cast<const StrokeShape&>(shape);
+
+    const float* xs = pointArena.xData(stroke.range);
+    const float* ys = pointArena.yData(stroke.range);
+    if (!stroke.transform.isIdentity()) {
+        // Joins depend on the final shape, so tessellate transformed points
+        thread_local std::vector<float> worldX, worldY;
+        worldX.resize(stroke.range.length);
+        worldY.resize(stroke.range.length);
+        for (uint32_t i = 0; i < stroke.range.length; i++) {
+            Point point = stroke.transform.apply(Point(xs[i], ys[i]));
+            worldX[i] = point.x;
+            worldY[i] = point.y;
+        }
+        xs = worldX.data();
+        ys = worldY.data();
+    }
+
+    StrokeMesh& mesh = meshCache[stroke.id];
+    Tessellator::tessellate(xs, ys, stroke.range.length, stroke.color, stroke.thickness, tessellationStyle, mesh);
+    return mesh;
 }
\ No newline at end of file
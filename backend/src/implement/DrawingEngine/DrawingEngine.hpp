@@ -1,36 +1,294 @@
 #pragma once
 #include "../shape.hpp"
 #include "../stroke_shape.hpp"
+#include "../point_arena.hpp"
+#include "../rectangle_shape.hpp"
+#include "../ellipse_shape.hpp"
+#include "../streaming_simplifier.hpp"
+#include "../stroke_tessellator.hpp"
+#include "../point_frame.hpp"
+#include "ShapeIndex.hpp"
+#include "GpuBuffers.hpp"
+#include "SpatialGrid.hpp"
+#include "Snapshot.hpp"
+#include "CommandBuffer.hpp"
+#include "History.hpp"
+#include "Selection.hpp"
+#include "BoundsTree.hpp"
+#include "ShapeStore.hpp"
+#include <array>
+#include <string>
+#include <unordered_map>
 #include <vector>
 #include <memory>
 
 class DrawingEngine {
     public:
         DrawingEngine();
-        
+        // Strokes point into this engine's arena, so it must stay put
+        DrawingEngine(const DrawingEngine&) = delete;
+        DrawingEngine& operator=(const DrawingEngine&) = delete;
+
         // Shape management (replaces stroke management)
-        void addShape(std::unique_ptr<Shape> shape);
-        void addStroke(const StrokeShape& stroke);  // Backward compatibility
+        ShapeId addShape(std::unique_ptr<Shape> shape);
+        ShapeId addStroke(const StrokeShape& stroke);  // Backward compatibility
         void addPointToStroke(int strokeIndex, const Point& pt);  // Keep for backward compatibility
         void removeShape(int index);
         void removeStroke(int index);  // Backward compatibility
         void moveShape(int index, float dx, float dy);
         void moveStroke(int index, float dx, float dy);  // Backward compatibility
         void clear();
-        
-        // Access shapes
-        const std::vector<std::unique_ptr<Shape>>& getShapes() const;
-        
+
+        // Stable-ID API: O(1) lookups that survive erasing other shapes.
+        // Mutators return false when the id is unknown (e.g. already erased).
+        bool hasShape(ShapeId id) const;
+        bool addPointToStrokeById(ShapeId id, const Point& pt);
+        bool removeShapeById(ShapeId id);
+        bool moveShapeById(ShapeId id, float dx, float dy);
+        bool simplifyStrokeById(ShapeId id, float epsilon = 1.0f);
+        bool recolorShapeById(ShapeId id, const Color& color);
+        bool setThicknessById(ShapeId id, float thickness);
+
+        // Lazy transforms: moves and these compose into the shape's Affine in
+        // O(1), whatever its size; output, bounds and hit tests see the
+        // transformed shape. Edits to a stroke's points fold the transform
+        // into them first. bakeTransforms() folds the rest: with idleOnly,
+        // only shapes not transformed since the previous call. Rotated or
+        // sheared rectangles and ellipses keep their transform. Returns how
+        // many it baked.
+        bool transformShapeById(ShapeId id, const Affine& transform);
+        bool scaleShapeById(ShapeId id, float sx, float sy, float cx, float cy);
+        bool rotateShapeById(ShapeId id, float radians, float cx, float cy);
+        Affine getShapeTransform(ShapeId id) const;  // identity if unknown
+        size_t bakeTransforms(bool idleOnly = true);
+        // Batched mutations (see CommandBuffer.hpp). initCommandRing() sizes
+        // the shared ring; producers append records and one applyBatch()
+        // applies everything pending, returning how many records took
+        // effect. A malformed record drops the rest of the batch.
+        // applyCommands() does the same for a plain array of records.
+        // getRejectedStrokes() lists the NewStroke ids the last batch turned
+        // down (0 or already taken).
+        void initCommandRing(uint32_t capacityWords);
+        CommandRing& getCommandRing();
+        size_t applyBatch();
+        size_t applyCommands(const uint32_t* words, size_t count);
+        const std::vector<ShapeId>& getRejectedStrokes() const { return rejectedStrokes; }
+
+        // Selection: the set of shapes the bulk edits below act on, each in
+        // one pass over the selection. selectByRect() picks shapes whose
+        // outline touches rect; selectByLasso() those with a vertex inside
+        // the polygon (even-odd). Without additive they replace the current
+        // selection. All return the selection size. Bulk edits return how
+        // many shapes they changed and undo as one step; deleteSelection()
+        // compacts once at the end and leaves the selection empty.
+        size_t selectByRect(const AABB& rect, bool additive = false);
+        size_t selectByLasso(const std::vector<Point>& polygon, bool additive = false);
+        size_t selectIds(const std::vector<ShapeId>& ids, bool additive = false);
+        void clearSelection();
+        std::vector<ShapeId> getSelection() const;  // draw order
+        size_t moveSelection(float dx, float dy);
+        size_t transformSelection(const Affine& transform);
+        size_t recolorSelection(const Color& color);
+        size_t deleteSelection();
+
+        // Undo/redo (see History.hpp). Off until setHistoryBudget() gives it
+        // a byte budget; the oldest steps are evicted to stay under it (the
+        // newest step is always kept). Each undo()/redo() costs the size of
+        // the change it reverts, not of the board. Mutations between
+        // beginHistoryGroup() and endHistoryGroup() undo as one step;
+        // outside a group, repeats of the same change to one shape (points
+        // added while inking, consecutive moves or recolors) merge into one.
+        // clear() and loadSnapshot() are not undoable and drop the history.
+        void setHistoryBudget(size_t bytes);
+        size_t getHistoryBytes() const;
+        bool undo();
+        bool redo();
+        bool canUndo() const;
+        bool canRedo() const;
+        void beginHistoryGroup();
+        void endHistoryGroup();
+        void clearHistory();
+
+        // Live point streaming (see point_frame.hpp): appends a whole frame to
+        // its stroke in one call. applyPointFrames() decodes and applies every
+        // frame in a packet and returns how many it applied, stopping at the
+        // first malformed one.
+        bool applyPointFrame(const PointFrame& frame);
+        size_t applyPointFrames(const uint8_t* data, size_t size);
+
+        // Online simplification while a stroke is being inked: between begin
+        // and end, addPointToStrokeById() keeps the stroke within epsilon of
+        // the raw samples instead of storing every one (see StreamingSimplifier)
+        bool beginStrokeSimplification(ShapeId id, float epsilon = 1.0f);
+        bool endStrokeSimplification(ShapeId id);
+
+        ShapeId getStrokeId(int strokeIndex) const;  // 0 if out of range
+        std::vector<ShapeId> getShapeIds() const;     // draw order
+
+        // Spatial queries backed by a uniform grid over shape bounds.
+        // Bounds include half the stroke thickness. Both bounds getters are
+        // O(1); the board's is the union of every live shape's, kept current
+        // in O(log n) per change, erasures included.
+        std::vector<ShapeId> queryRect(const AABB& rect) const;          // draw order
+        std::vector<ShapeId> hitTest(float x, float y, float radius) const;  // topmost first
+        AABB getShapeBounds(ShapeId id) const;  // empty box if unknown
+        AABB getBoardBounds() const;  // every shape's bounds; empty box if none
+
+        // Access shapes (live shapes in draw order; valid until the next add)
+        std::vector<const Shape*> getShapes() const;
+
         // Backward compatibility - get strokes only
         std::vector<StrokeShape> getStrokes() const;
-        
-        // WebGPU vertex data
+
+        // WebGPU vertex data, every shape in draw order: strokes as their
+        // points, rectangles and ellipses as their closed outline (the first
+        // vertex repeated last). Ellipse outlines deviate from the curve by
+        // at most a quarter of a world unit here and in the GPU buffers; the
+        // viewport variant sizes them for the zoom instead.
         std::vector<float> getVertexBufferData() const;
 
+        // Zero-copy export of the same data. The reference points into engine
+        // storage and is valid until the next mutating call; typed-memory
+        // views built from it (or from getGpuVertices/getGpuDrawCommands)
+        // must be re-created whenever getViewGeneration() changes, since that
+        // means one of the exported buffers moved or changed length.
+        const std::vector<float>& getVertexBufferView();
+        uint32_t getViewGeneration() const;
+        uint64_t getContentVersion() const;  // bumps on every mutation
+
+        // Level-of-detail output for a viewport: only shapes intersecting
+        // viewport, each stroke decimated with RDP to about half a screen
+        // pixel at the given zoom (screen pixels per world unit). Decimated
+        // strokes are cached per power-of-two tolerance level until the
+        // stroke changes. The view variant follows getVertexBufferView's rules.
+        std::vector<float> getVertexBufferDataForViewport(const AABB& viewport, float zoom);
+        const std::vector<float>& getVertexBufferViewForViewport(const AABB& viewport, float zoom);
+
+        // Shapes expanded to triangles (joins and caps included; outlines
+        // closed), cached per shape until it changes. getTessellation() packs
+        // every shape in draw order into one mesh and afterwards rewrites only
+        // the changed shapes' part of it; both follow getVertexBufferView's
+        // rules.
+        void setTessellationStyle(const TessellationStyle& style);
+        const TessellationStyle& getTessellationStyle() const;
+        const StrokeMesh& getStrokeMesh(ShapeId id);  // empty mesh if unknown
+        const StrokeMesh& getTessellation();
+
+        // Versioned binary snapshot of the whole board (see Snapshot.hpp).
+        // Stroke points are quantized to `quantum` world units; colours to
+        // RGBA8. Loading replaces the board and keeps shape ids; on malformed
+        // input it returns false and leaves the board untouched. The file
+        // variants mmap the snapshot on native builds.
+        std::vector<uint8_t> saveSnapshot(float quantum = Snapshot::DefaultQuantum) const;
+        bool loadSnapshot(const uint8_t* data, size_t size);
+        bool saveSnapshotFile(const std::string& path, float quantum = Snapshot::DefaultQuantum) const;
+        bool loadSnapshotFile(const std::string& path);
+
         // simplify with RDP
         void simplifyStroke(int index, float epsilon = 1.0f);
-    
+
+        // Persistent GPU buffers, updated incrementally. Call
+        // takeGpuBufferUpdate() once per frame and upload only the returned
+        // byte ranges from getGpuVertices()/getGpuDrawCommands().
+        GpuBufferUpdate takeGpuBufferUpdate();
+        const std::vector<float>& getGpuVertices() const;
+        const std::vector<uint32_t>& getGpuDrawCommands() const;
+
     private:
-        std::vector<std::unique_ptr<Shape>> shapes;
-    };
-    
\ No newline at end of file
+        int64_t strokeSlot(int strokeIndex) const;  // legacy "Nth stroke" lookup
+        int64_t shapeSlot(int index) const;         // legacy "Nth shape" lookup
+        void attachStroke(StrokeShape* stroke);
+        void eraseSlot(size_t slot, bool settle = true);
+        void compactIfSparse();
+        void detachSlot(size_t slot);
+        void parkSlot(size_t slot);
+        bool unpark(ShapeId id);
+        void releaseParked(ShapeId id);
+        void composeTransform(uint32_t slot, const Affine& transform);
+        bool bakeTransform(uint32_t slot);
+        void swapPoints(uint32_t slot, HistoryOp& op);
+        bool recording() const;
+        HistoryOp& recordOp(HistoryOp::Kind kind, ShapeId id, bool& merged, const std::vector<ShapeId>* ids = nullptr);
+        void recordPoints(uint32_t slot, uint32_t firstChanged);
+        void applyHistoryOp(HistoryOp& op, bool undoing);
+        void dropHistoryStep(HistoryStep& step, bool undoSide);
+        void trimHistory();
+        void compactSlots();
+        void compactArena();
+        void shapeChanged(uint32_t slot, bool rewrite);
+        void meshChanged(uint32_t slot);
+        void packBoardMesh(size_t fromSlot);
+        void restartInking(uint32_t slot);
+        bool applyCommand(const uint32_t* record, uint32_t length);
+        AABB computeBounds(const Shape& shape) const;
+        AABB geometryBounds(const Shape& shape) const;
+        void setBounds(uint32_t slot, const AABB& box);
+        bool shapeHit(const Shape& shape, float x, float y, float radius) const;
+        bool shapeTouchesRect(const Shape& shape, const AABB& rect) const;
+        bool shapeInPolygon(const Shape& shape, const std::vector<Point>& polygon) const;
+        void appendVertexData(std::vector<float>& data) const;
+        void refreshViewGeneration();
+        void appendViewportVertexData(std::vector<float>& data, const AABB& viewport, float zoom);
+        const std::vector<Point>& lodPoints(const StrokeShape& stroke, int level);
+        const StrokeMesh& shapeMesh(const Shape& shape);
+        void syncGpuBuffers();
+        void writeStrokeVertices(const StrokeShape& stroke, const GpuSlot& record, uint32_t from, uint32_t to);
+
+        // Draw order. Erased shapes leave an empty slot behind so the slots
+        // of everything else stay valid; compactSlots() squeezes them out
+        // once they outnumber the live shapes.
+        ShapeStore store;
+        ShapeIndex idToSlot;
+        size_t erasedSlots = 0;
+        ShapeId nextId = 1;
+        PointArena pointArena;
+        GpuBuffers gpu;  // slot-aligned with shapes
+        BoundsTree slotBounds;  // slot-aligned with shapes; its total is the board's
+        SpatialGrid grid;
+        std::unordered_map<ShapeId, StreamingSimplifier> inking;  // strokes being simplified online
+        CommandRing commandRing;
+        std::vector<ShapeId> rejectedStrokes;  // by the current or last batch
+        History history;
+        std::unordered_map<ShapeId, ParkedShape> parked;  // erased, but history can restore them
+
+        // Shapes with a non-identity transform, and whether it changed
+        // since the last bakeTransforms()
+        struct TransformState {
+            bool touched;
+        };
+        std::unordered_map<ShapeId, TransformState> transformed;
+
+        SlotBitset selection;  // slot-aligned with shapes
+
+        // Mutation counter and the cached packed buffer behind getVertexBufferView()
+        uint64_t contentVersion = 0;
+        uint64_t packedVersion = ~0ULL;
+        std::vector<float> packedVertices;
+        std::vector<float> viewportVertices;
+        std::array<uintptr_t, 14> exportedViews = {};
+        uint32_t viewGeneration = 0;
+
+        // Decimated copies of strokes, keyed by tolerance level (2^level world units)
+        struct LodLevel {
+            int level;
+            std::vector<Point> points;
+        };
+        std::unordered_map<ShapeId, std::vector<LodLevel>> lodCache;
+
+        // Triangulated shapes and the packed board mesh built from them.
+        // Each slot's triangles sit at meshRanges[slot], in slot order, so a
+        // changed shape is rewritten in place while its counts hold; one
+        // that grows or shrinks re-packs the slots from there on.
+        struct MeshRange {
+            uint32_t firstVertex = 0;
+            uint32_t vertexCount = 0;
+            uint32_t firstIndex = 0;
+            uint32_t indexCount = 0;
+        };
+        TessellationStyle tessellationStyle;
+        std::unordered_map<ShapeId, StrokeMesh> meshCache;
+        StrokeMesh boardMesh;
+        std::vector<MeshRange> meshRanges;  // slot-aligned as of the last getTessellation()
+        std::vector<uint32_t> meshDirty;    // slots changed since then
+        bool meshRebuild = true;
+    };
\ No newline at end of file
@@ -0,0 +1,215 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Byte span of a GPU-side buffer that needs re-uploading (writeBuffer args)
+struct DirtyRange {
+    uint32_t offset;
+    uint32_t size;
+};
+
+// What changed in the persistent GPU buffers since the last update was taken
+struct GpuBufferUpdate {
+    std::vector<DirtyRange> vertexRanges;
+    std::vector<DirtyRange> drawCommandRanges;
+    uint32_t vertexByteLength = 0;
+    uint32_t drawCommandByteLength = 0;
+    bool fullUpload = false;  // layout was rebuilt; re-upload both buffers whole
+};
+
+// Collects dirty byte spans and merges them when taken
+class DirtyRangeList {
+    public:
+        void add(uint32_t begin, uint32_t end) {
+            if (begin >= end) return;
+            // Appends while inking land right after the previous span
+            if (!spans.empty() && begin >= spans.back().first && begin <= spans.back().second) {
+                spans.back().second = std::max(spans.back().second, end);
+                return;
+            }
+            spans.emplace_back(begin, end);
+        }
+
+        std::vector<DirtyRange> take() {
+            std::sort(spans.begin(), spans.end());
+            std::vector<DirtyRange> merged;
+            for (const auto& span : spans) {
+                // Small gaps are cheaper to re-upload than a separate writeBuffer call
+                if (!merged.empty() && span.first <= merged.back().offset + merged.back().size + MergeGap) {
+                    uint32_t end = std::max(merged.back().offset + merged.back().size, span.second);
+                    merged.back().size = end - merged.back().offset;
+                } else {
+                    merged.push_back({span.first, span.second - span.first});
+                }
+            }
+            spans.clear();
+            return merged;
+        }
+
+        void clear() { spans.clear(); }
+
+    private:
+        static constexpr uint32_t MergeGap = 256;
+        std::vector<std::pair<uint32_t, uint32_t>> spans;
+};
+
+// Per-slot bookkeeping for a shape's vertices in the persistent buffer
+struct GpuSlot {
+    uint32_t vertexOffset = 0;
+    uint32_t vertexCapacity = 0;
+    uint32_t syncedVertices = 0;  // vertices already written for this shape
+    bool rewrite = false;         // colour or geometry changed; write them all again
+    bool queued = false;          // waiting in the pending list
+};
+
+// Persistent, GPU-ready copies of the engine's geometry.
+//
+// vertices holds [x, y, r, g, b, a, thickness] per point, the same layout as
+// DrawingEngine::getVertexBufferData(), but each shape owns a span with spare
+// capacity so appending a point only touches one vertex. drawCommands holds
+// one WebGPU drawIndirect record [vertexCount, 1, firstVertex, 0] per engine
+// slot; erased slots draw nothing. Spans are moved and reclaimed the same way
+// as PointArena ranges.
+class GpuBuffers {
+    public:
+        static constexpr uint32_t FloatsPerVertex = 7;
+        static constexpr uint32_t WordsPerDrawCommand = 4;
+
+        std::vector<float> vertices;
+        std::vector<uint32_t> drawCommands;
+        std::vector<GpuSlot> slots;
+        std::vector<uint32_t> pending;  // slots with unsynced changes
+        DirtyRangeList vertexDirty;
+        DirtyRangeList drawCommandDirty;
+        size_t garbageVertices = 0;
+        size_t liveVertices = 0;
+        bool layoutReset = false;
+
+        void addSlot() {
+            slots.emplace_back();
+            drawCommands.insert(drawCommands.end(), WordsPerDrawCommand, 0);
+        }
+
+        void queue(uint32_t slot, bool rewrite) {
+            GpuSlot& record = slots[slot];
+            record.rewrite = record.rewrite || rewrite;
+            if (!record.queued) {
+                record.queued = true;
+                pending.push_back(slot);
+            }
+        }
+
+        // Vertices from `vertex` on changed in place; re-sync them next time
+        void rewind(uint32_t slot, uint32_t vertex) {
+            GpuSlot& record = slots[slot];
+            if (record.syncedVertices > vertex) {
+                liveVertices -= record.syncedVertices - vertex;
+                record.syncedVertices = vertex;
+            }
+            queue(slot, false);
+        }
+
+        void releaseSlot(uint32_t slot) {
+            GpuSlot& record = slots[slot];
+            garbageVertices += record.vertexCapacity;
+            liveVertices -= record.syncedVertices;
+            record = GpuSlot();
+            setDrawCommand(slot, 0, 0);
+        }
+
+        // Makes room for vertexCount vertices in slot's span, moving it if needed.
+        // Returns true when the span moved and every vertex must be rewritten.
+        bool reserve(uint32_t slot, uint32_t vertexCount) {
+            GpuSlot& record = slots[slot];
+            if (vertexCount <= record.vertexCapacity) return false;
+
+            uint32_t capacity = std::max<uint32_t>(std::max<uint32_t>(vertexCount, record.vertexCapacity * 2), 8);
+            size_t totalVertices = vertices.size() / FloatsPerVertex;
+            if (record.vertexCapacity > 0 && record.vertexOffset + record.vertexCapacity == totalVertices) {
+                // Last span in the buffer: extend in place
+                vertices.resize((record.vertexOffset + capacity) * FloatsPerVertex);
+                record.vertexCapacity = capacity;
+                return false;
+            }
+            garbageVertices += record.vertexCapacity;
+            record.vertexOffset = static_cast<uint32_t>(totalVertices);
+            record.vertexCapacity = capacity;
+            vertices.resize((totalVertices + capacity) * FloatsPerVertex);
+            return true;
+        }
+
+        float* vertexAt(const GpuSlot& record, uint32_t i) {
+            return vertices.data() + (size_t(record.vertexOffset) + i) * FloatsPerVertex;
+        }
+
+        void markVertices(const GpuSlot& record, uint32_t from, uint32_t to) {
+            const uint32_t stride = FloatsPerVertex * sizeof(float);
+            vertexDirty.add((record.vertexOffset + from) * stride, (record.vertexOffset + to) * stride);
+        }
+
+        void setDrawCommand(uint32_t slot, uint32_t vertexCount, uint32_t firstVertex) {
+            uint32_t* command = drawCommands.data() + size_t(slot) * WordsPerDrawCommand;
+            command[0] = vertexCount;
+            command[1] = vertexCount > 0 ? 1 : 0;
+            command[2] = firstVertex;
+            command[3] = 0;
+            const uint32_t stride = WordsPerDrawCommand * sizeof(uint32_t);
+            drawCommandDirty.add(slot * stride, (slot + 1) * stride);
+        }
+
+        bool wantsCompaction() const {
+            return garbageVertices > 4096 && garbageVertices > liveVertices;
+        }
+
+        // Drops every span; the caller re-queues all live slots for a rewrite
+        void resetLayout() {
+            vertices.clear();
+            garbageVertices = 0;
+            liveVertices = 0;
+            for (auto& record : slots) {
+                record.vertexOffset = 0;
+                record.vertexCapacity = 0;
+                record.syncedVertices = 0;
+            }
+            vertexDirty.clear();
+            drawCommandDirty.clear();
+            layoutReset = true;
+        }
+
+        // Keeps slots[0..count) after the engine compacted its slot table
+        void truncateSlots(size_t count) {
+            slots.resize(count);
+            drawCommands.resize(count * WordsPerDrawCommand);
+        }
+
+        GpuBufferUpdate takeUpdate() {
+            GpuBufferUpdate update;
+            update.vertexByteLength = static_cast<uint32_t>(vertices.size() * sizeof(float));
+            update.drawCommandByteLength = static_cast<uint32_t>(drawCommands.size() * sizeof(uint32_t));
+            update.fullUpload = layoutReset;
+            if (layoutReset) {
+                vertexDirty.clear();
+                drawCommandDirty.clear();
+                if (update.vertexByteLength > 0) update.vertexRanges.push_back({0, update.vertexByteLength});
+                if (update.drawCommandByteLength > 0) update.drawCommandRanges.push_back({0, update.drawCommandByteLength});
+                layoutReset = false;
+            } else {
+                update.vertexRanges = vertexDirty.take();
+                update.drawCommandRanges = drawCommandDirty.take();
+            }
+            return update;
+        }
+
+        void clear() {
+            vertices.clear();
+            drawCommands.clear();
+            slots.clear();
+            pending.clear();
+            garbageVertices = 0;
+            liveVertices = 0;
+            vertexDirty.clear();
+            drawCommandDirty.clear();
+            layoutReset = true;
+        }
+};
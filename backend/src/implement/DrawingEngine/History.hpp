@@ -0,0 +1,70 @@
+#pragma once
+#include "../shape.hpp"
+#include "../draw.hpp"
+#include "ShapeStore.hpp"
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// One reversible change, stored as the data needed to swap between the two
+// states rather than a copy of the shape. Applying an op flips the board
+// from one side of the change to the other:
+//
+//   Add/Erase  the shape is parked (hidden in its slot, points untouched)
+//              or brought back
+//   Move       translate by -(dx, dy) to undo, +(dx, dy) to redo
+//   Transform  compose the inverse of `transform` to undo, itself to redo
+//              (both act on every shape in `ids` for selection edits)
+//   Recolor    swap the shape's colour with `color`
+//   Thickness  swap the shape's thickness with `thickness`
+//   Points     swap the stroke's points from `prefix` on with `tail`
+//
+// so a move or recolor never copies points, and an ink stroke costs nothing
+// until it is undone.
+struct HistoryOp {
+    enum Kind : uint8_t { Add, Erase, Move, Transform, Recolor, Thickness, Points };
+
+    Kind kind;
+    ShapeId id;
+    float dx = 0.0f, dy = 0.0f;
+    Affine transform;
+    Color color;
+    float thickness = 0.0f;
+    uint32_t prefix = 0;
+    std::vector<Point> tail;
+    std::vector<ShapeId> ids;  // bulk Move/Transform; id is 0 then
+
+    HistoryOp(Kind kind, ShapeId id) : kind(kind), id(id) {}
+
+    size_t bytes() const {
+        return sizeof(HistoryOp) + tail.capacity() * sizeof(Point) + ids.capacity() * sizeof(ShapeId);
+    }
+};
+
+// What one undo() reverts: a group, or a run of the same change to one shape
+// (an ink stroke, a drag) recorded outside a group. Sealed steps take no
+// more ops.
+struct HistoryStep {
+    std::vector<HistoryOp> ops;
+    bool sealed = false;
+};
+
+// An erased shape kept alive in its pool, with its points, for a step that
+// may restore it. It goes back into the same slot, so draw order survives
+// the round trip.
+struct ParkedShape {
+    ShapeRef ref;
+    uint32_t slot;
+    AABB bounds;
+    size_t bytes;  // as charged to the history budget
+};
+
+struct History {
+    std::deque<HistoryStep> undo;
+    std::deque<HistoryStep> redo;
+    size_t budget = 0;      // bytes; 0 disables recording
+    size_t bytes = 0;       // ops plus parked shapes
+    int groupDepth = 0;
+    bool groupOpen = false;  // the current group already has its step
+    bool paused = false;     // replaying, or loading a snapshot
+};
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// One bit per engine slot, so selection tests and bulk edits walk the
+// selection in draw order without hashing. Bits past the end read as 0.
+class SlotBitset {
+    public:
+        bool test(uint32_t slot) const {
+            size_t word = slot >> 6;
+            return word < words.size() && (words[word] >> (slot & 63)) & 1;
+        }
+
+        void set(uint32_t slot) {
+            size_t word = slot >> 6;
+            if (word >= words.size()) words.resize(word + 1, 0);
+            uint64_t bit = uint64_t(1) << (slot & 63);
+            if (!(words[word] & bit)) {
+                words[word] |= bit;
+                setCount++;
+            }
+        }
+
+        void reset(uint32_t slot) {
+            size_t word = slot >> 6;
+            if (word >= words.size()) return;
+            uint64_t bit = uint64_t(1) << (slot & 63);
+            if (words[word] & bit) {
+                words[word] &= ~bit;
+                setCount--;
+            }
+        }
+
+        size_t count() const { return setCount; }
+        bool empty() const { return setCount == 0; }
+
+        void clear() {
+            words.clear();
+            setCount = 0;
+        }
+
+        // Calls visit(slot) for every set bit in ascending order, skipping
+        // empty words 64 slots at a time
+        template<typename Visit>
+        void forEach(Visit visit) const {
+            for (size_t word = 0; word < words.size(); word++) {
+                uint64_t bits = words[word];
+                while (bits) {
+                    visit(static_cast<uint32_t>(word * 64 + __builtin_ctzll(bits)));
+                    bits &= bits - 1;
+                }
+            }
+        }
+
+    private:
+        std::vector<uint64_t> words;
+        size_t setCount = 0;
+};
@@ -0,0 +1,96 @@
+#pragma once
+#include "../shape.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Open-addressing hash map from ShapeId to the shape's slot in the engine.
+// Linear probing with backward-shift deletion, so lookups never have to walk
+// over tombstones. Id 0 is reserved as the empty marker.
+class ShapeIndex {
+    public:
+        ShapeIndex() { rehash(16); }
+
+        // Returns the slot for id, or -1 if the id is unknown
+        int64_t find(ShapeId id) const {
+            size_t i = bucketFor(id);
+            while (keys[i] != 0) {
+                if (keys[i] == id) return slots[i];
+                i = (i + 1) & mask;
+            }
+            return -1;
+        }
+
+        // Inserts or updates the slot for id
+        void assign(ShapeId id, uint32_t slot) {
+            if ((count + 1) * 2 > keys.size()) rehash(keys.size() * 2);
+            size_t i = bucketFor(id);
+            while (keys[i] != 0) {
+                if (keys[i] == id) {
+                    slots[i] = slot;
+                    return;
+                }
+                i = (i + 1) & mask;
+            }
+            keys[i] = id;
+            slots[i] = slot;
+            count++;
+        }
+
+        bool erase(ShapeId id) {
+            size_t i = bucketFor(id);
+            while (keys[i] != id) {
+                if (keys[i] == 0) return false;
+                i = (i + 1) & mask;
+            }
+            // Shift following entries back so probe chains stay unbroken
+            size_t hole = i;
+            size_t j = (i + 1) & mask;
+            while (keys[j] != 0) {
+                size_t home = bucketFor(keys[j]);
+                if (((j - home) & mask) >= ((j - hole) & mask)) {
+                    keys[hole] = keys[j];
+                    slots[hole] = slots[j];
+                    hole = j;
+                }
+                j = (j + 1) & mask;
+            }
+            keys[hole] = 0;
+            count--;
+            return true;
+        }
+
+        void clear() {
+            std::fill(keys.begin(), keys.end(), 0);
+            count = 0;
+        }
+
+        size_t size() const { return count; }
+
+    private:
+        size_t bucketFor(ShapeId id) const {
+            // splitmix64 finalizer - ids are sequential, so spread them out
+            uint64_t h = id;
+            h ^= h >> 30; h *= 0xbf58476d1ce4e5b9ULL;
+            h ^= h >> 27; h *= 0x94d049bb133111ebULL;
+            h ^= h >> 31;
+            return static_cast<size_t>(h) & mask;
+        }
+
+        void rehash(size_t capacity) {
+            std::vector<ShapeId> oldKeys = std::move(keys);
+            std::vector<uint32_t> oldSlots = std::move(slots);
+            keys.assign(capacity, 0);
+            slots.assign(capacity, 0);
+            mask = capacity - 1;
+            count = 0;
+            for (size_t i = 0; i < oldKeys.size(); i++) {
+                if (oldKeys[i] != 0) assign(oldKeys[i], oldSlots[i]);
+            }
+        }
+
+        std::vector<ShapeId> keys;
+        std::vector<uint32_t> slots;
+        size_t mask = 0;
+        size_t count = 0;
+};
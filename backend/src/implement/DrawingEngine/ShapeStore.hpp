@@ -0,0 +1,179 @@
+#pragma once
+#include "../shape.hpp"
+#include "../stroke_shape.hpp"
+#include "../rectangle_shape.hpp"
+#include "../ellipse_shape.hpp"
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Pools move strokes when they grow; a copy would detach them from the arena
+static_assert(std::is_nothrow_move_constructible<StrokeShape>::value, "StrokeShape must move without copying");
+
+// For `if constexpr` branches inside visitors
+template<typename T>
+constexpr bool isStrokeType = std::is_same<std::decay_t<T>, StrokeShape>::value;
+
+// Where a slot's shape lives: its type's pool and its index there
+struct ShapeRef {
+    static constexpr uint32_t None = UINT32_MAX;
+
+    uint32_t index = None;
+    ShapeType type = ShapeType::Stroke;
+
+    bool empty() const { return index == None; }
+};
+
+// The engine's shapes, stored by value in one contiguous pool per type and
+// reached in draw order through a slot table of ShapeRefs.
+//
+// visit() calls a generic lambda with the concrete shape type, chosen by a
+// switch on the slot's type, so board-wide loops run without virtual calls
+// or casts at the call site and walk each pool mostly in order. Shapes
+// still derive from Shape, and at() hands out a Shape* for code that does
+// not care about the type. Pointers into the pools stay valid until the
+// next push().
+//
+// detach() empties a slot but keeps the shape in its pool, where it can be
+// attached again (history parks erased shapes this way); release() returns
+// the entry to its pool's free list.
+class ShapeStore {
+    public:
+        size_t size() const { return refs.size(); }  // slots, empty ones included
+        ShapeRef ref(size_t slot) const { return refs[slot]; }
+        bool occupied(size_t slot) const { return !refs[slot].empty(); }
+
+        Shape* at(size_t slot) { return refs[slot].empty() ? nullptr : &get(refs[slot]); }
+        const Shape* at(size_t slot) const { return refs[slot].empty() ? nullptr : &get(refs[slot]); }
+
+        Shape& get(ShapeRef ref) {
+            switch (ref.type) {
+                case ShapeType::Rectangle: return rectangles[ref.index];
+                case ShapeType::Ellipse: return ellipses[ref.index];
+                default: return strokes[ref.index];
+            }
+        }
+        const Shape& get(ShapeRef ref) const {
+            return const_cast<ShapeStore*>(this)->get(ref);
+        }
+
+        // Calls visit(shape) with the slot's shape as its concrete type. The
+        // slot must not be empty.
+        template<typename Visit>
+        decltype(auto) visit(size_t slot, Visit&& visitor) {
+            return visitRef(refs[slot], std::forward<Visit>(visitor));
+        }
+        template<typename Visit>
+        decltype(auto) visit(size_t slot, Visit&& visitor) const {
+            return const_cast<ShapeStore*>(this)->visitRef(refs[slot], [&](const auto& shape) -> decltype(auto) {
+                return visitor(shape);
+            });
+        }
+
+        // The same dispatch for a shape reached some other way
+        template<typename ShapeT, typename Visit>
+        static decltype(auto) visitShape(ShapeT& shape, Visit&& visitor) {
+            using Stroke = std::conditional_t<std::is_const<ShapeT>::value, const StrokeShape, StrokeShape>;
+            using Rectangle = std::conditional_t<std::is_const<ShapeT>::value, const RectangleShape, RectangleShape>;
+            using Ellipse = std::conditional_t<std::is_const<ShapeT>::value, const EllipseShape, EllipseShape>;
+            switch (shape.type) {
+                case ShapeType::Rectangle: return visitor(static_cast<Rectangle&>(shape));
+                case ShapeType::Ellipse: return visitor(static_cast<Ellipse&>(shape));
+                default: return visitor(static_cast<Stroke&>(shape));
+            }
+        }
+
+        // Moves the shape into its pool and appends a slot for it
+        uint32_t push(std::unique_ptr<Shape> shape) {
+            ShapeRef ref;
+            ref.type = shape->type;
+            visitShape(*shape, [&](auto& typed) {
+                ref.index = place(pool(typed), freeList(typed), std::move(typed));
+            });
+            refs.push_back(ref);
+            return static_cast<uint32_t>(refs.size() - 1);
+        }
+
+        // Empties slot; the shape stays in its pool
+        ShapeRef detach(size_t slot) {
+            ShapeRef ref = refs[slot];
+            refs[slot] = ShapeRef();
+            return ref;
+        }
+
+        void attach(size_t slot, ShapeRef ref) { refs[slot] = ref; }
+
+        // Destroys the shape and frees its pool entry for reuse
+        void release(ShapeRef ref) {
+            visitShape(get(ref), [&](auto& typed) {
+                typed = blank(typed);
+                freeList(typed).push_back(ref.index);
+            });
+        }
+
+        // Slot compaction: move a ref down, then cut the table
+        void moveSlot(size_t from, size_t to) {
+            refs[to] = refs[from];
+            refs[from] = ShapeRef();
+        }
+        void truncate(size_t slots) { refs.resize(slots); }
+
+        void reserve(size_t slots) { refs.reserve(slots); }
+
+        void clear() {
+            refs.clear();
+            strokes.clear();
+            rectangles.clear();
+            ellipses.clear();
+            freeStrokes.clear();
+            freeRectangles.clear();
+            freeEllipses.clear();
+        }
+
+        // Every stroke in the pool, attached or not; freed entries are blank
+        // strokes with an empty range
+        std::vector<StrokeShape>& strokePool() { return strokes; }
+
+    private:
+        template<typename Visit>
+        decltype(auto) visitRef(ShapeRef ref, Visit&& visitor) {
+            switch (ref.type) {
+                case ShapeType::Rectangle: return visitor(rectangles[ref.index]);
+                case ShapeType::Ellipse: return visitor(ellipses[ref.index]);
+                default: return visitor(strokes[ref.index]);
+            }
+        }
+
+        template<typename T>
+        static uint32_t place(std::vector<T>& items, std::vector<uint32_t>& freeList, T&& item) {
+            if (freeList.empty()) {
+                items.push_back(std::move(item));
+                return static_cast<uint32_t>(items.size() - 1);
+            }
+            uint32_t index = freeList.back();
+            freeList.pop_back();
+            items[index] = std::move(item);
+            return index;
+        }
+
+        // Per-type lookups, overloaded on the shape they are for
+        std::vector<StrokeShape>& pool(const StrokeShape&) { return strokes; }
+        std::vector<RectangleShape>& pool(const RectangleShape&) { return rectangles; }
+        std::vector<EllipseShape>& pool(const EllipseShape&) { return ellipses; }
+        std::vector<uint32_t>& freeList(const StrokeShape&) { return freeStrokes; }
+        std::vector<uint32_t>& freeList(const RectangleShape&) { return freeRectangles; }
+        std::vector<uint32_t>& freeList(const EllipseShape&) { return freeEllipses; }
+        static StrokeShape blank(const StrokeShape&) { return StrokeShape(Color(), 0.0f); }
+        static RectangleShape blank(const RectangleShape&) { return RectangleShape(Point(), Point(), Color(), 0.0f); }
+        static EllipseShape blank(const EllipseShape&) { return EllipseShape(Point(), 0.0f, 0.0f, Color(), 0.0f); }
+
+        std::vector<ShapeRef> refs;  // slot-aligned with the engine's other tables
+        std::vector<StrokeShape> strokes;
+        std::vector<RectangleShape> rectangles;
+        std::vector<EllipseShape> ellipses;
+        std::vector<uint32_t> freeStrokes;
+        std::vector<uint32_t> freeRectangles;
+        std::vector<uint32_t> freeEllipses;
+};
@@ -0,0 +1,108 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "../affine.hpp"
+#include "../color.hpp"
+
+// Binary board snapshot, version 2. All fields are little-endian.
+//
+//   SnapshotHeader                     32 bytes
+//   SnapshotShape[shapeCount]          72 bytes each, draw order
+//   point stream                       pointBytes bytes
+//
+// The header and shape table are fixed-size records read in place (from an
+// mmap on native builds). Stroke points live in the point stream: per
+// stroke, coordinates are quantized to multiples of `quantum` world units,
+// the first point is stored as zig-zag varints and every later point as the
+// zig-zag varint delta from the one before. Quantizing absolute positions
+// before taking deltas means decoding never drifts.
+//
+// Version 1 records are the first 48 bytes of a version 2 record, without
+// the transform; they still load, as untransformed shapes.
+namespace Snapshot {
+
+    constexpr char Magic[4] = {'W', 'B', 'S', 'N'};
+    constexpr uint16_t Version = 2;
+    constexpr size_t RecordSizeV1 = 48;
+    constexpr float DefaultQuantum = 1.0f / 64.0f;
+
+    enum ShapeKind : uint8_t {
+        KindStroke = 0,
+        KindRectangle = 1,
+        KindEllipse = 2
+    };
+
+    struct Header {
+        char magic[4];
+        uint16_t version;
+        uint16_t headerSize;  // readers skip fields they do not know
+        uint32_t shapeCount;
+        uint32_t pointCount;  // total stroke points, for reserving
+        uint64_t nextId;
+        float quantum;
+        uint32_t pointBytes;
+    };
+    static_assert(sizeof(Header) == 32, "snapshot header layout");
+
+    struct ShapeRecord {
+        uint64_t id;
+        uint8_t kind;
+        uint8_t reserved[3];
+        uint32_t rgba;         // RGBA8, red in the low byte
+        float thickness;
+        uint32_t pointCount;   // strokes only
+        uint64_t pointOffset;  // byte offset into the point stream (strokes only)
+        float geometry[4];     // rectangles: topLeft.x, topLeft.y, bottomRight.x, bottomRight.y;
+                               // ellipses: center.x, center.y, radiusX, radiusY
+        float transform[6];    // a, b, c, d, tx, ty over geometry; identity for strokes,
+                               // whose points are saved transformed
+    };
+    static_assert(sizeof(ShapeRecord) == 72, "snapshot shape record layout");
+
+    inline void packTransform(const Affine& t, float* out) {
+        out[0] = t.a;
+        out[1] = t.b;
+        out[2] = t.c;
+        out[3] = t.d;
+        out[4] = t.tx;
+        out[5] = t.ty;
+    }
+
+    inline Affine unpackTransform(const float* in) {
+        Affine t;
+        t.a = in[0];
+        t.b = in[1];
+        t.c = in[2];
+        t.d = in[3];
+        t.tx = in[4];
+        t.ty = in[5];
+        return t;
+    }
+
+    inline uint32_t packColor(const Color& c) {
+        auto channel = [](float v) {
+            return uint32_t(std::lround(std::min(1.0f, std::max(0.0f, v)) * 255.0f));
+        };
+        return channel(c.r) | (channel(c.g) << 8) | (channel(c.b) << 16) | (channel(c.a) << 24);
+    }
+
+    inline Color unpackColor(uint32_t rgba) {
+        return Color((rgba & 0xff) / 255.0f, ((rgba >> 8) & 0xff) / 255.0f,
+                     ((rgba >> 16) & 0xff) / 255.0f, (rgba >> 24) / 255.0f);
+    }
+
+    // Quantized coordinate; llround of NaN/huge values is clamped first
+    inline int64_t quantize(float v, float quantum) {
+        double q = double(v) / quantum;
+        if (!(q > -4e15)) q = q != q ? 0.0 : -4e15;
+        if (q > 4e15) q = 4e15;
+        return std::llround(q);
+    }
+
+    inline float dequantize(int64_t q, float quantum) {
+        return static_cast<float>(double(q) * quantum);
+    }
+
+} // namespace Snapshot
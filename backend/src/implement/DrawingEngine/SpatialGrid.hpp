@@ -0,0 +1,153 @@
+#pragma once
+#include "../draw.hpp"
+#include "../shape.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Uniform-grid spatial index over shape bounding boxes.
+//
+// Every shape is listed in each cell its box overlaps. Shapes covering more
+// than MaxCellsPerShape cells go into a separate "oversized" list that every
+// query checks, so one huge shape cannot flood the grid. The grid does not
+// store boxes itself: callers pass the old box when updating or removing, and
+// must filter candidates against the real bounds (cells over-approximate).
+class SpatialGrid {
+    public:
+        explicit SpatialGrid(float cellSize = 256.0f) : cellSize(cellSize) {}
+
+        void insert(ShapeId id, const AABB& box) {
+            if (box.empty()) return;
+            CellSpan span = spanFor(box);
+            if (span.oversized()) {
+                oversized.push_back(id);
+                return;
+            }
+            for (int32_t cy = span.minY; cy <= span.maxY; cy++) {
+                for (int32_t cx = span.minX; cx <= span.maxX; cx++) {
+                    cells[key(cx, cy)].push_back(id);
+                }
+            }
+        }
+
+        void remove(ShapeId id, const AABB& box) {
+            if (box.empty()) return;
+            CellSpan span = spanFor(box);
+            if (span.oversized()) {
+                eraseFrom(oversized, id);
+                return;
+            }
+            for (int32_t cy = span.minY; cy <= span.maxY; cy++) {
+                for (int32_t cx = span.minX; cx <= span.maxX; cx++) {
+                    removeFromCell(key(cx, cy), id);
+                }
+            }
+        }
+
+        // Only touches the cells that differ between the two boxes, so a
+        // stroke growing point by point costs nothing until it crosses a cell
+        void update(ShapeId id, const AABB& oldBox, const AABB& newBox) {
+            if (oldBox.empty() || newBox.empty()) {
+                remove(id, oldBox);
+                insert(id, newBox);
+                return;
+            }
+            CellSpan before = spanFor(oldBox);
+            CellSpan after = spanFor(newBox);
+            if (before == after) return;
+            if (before.oversized() || after.oversized()) {
+                remove(id, oldBox);
+                insert(id, newBox);
+                return;
+            }
+            for (int32_t cy = before.minY; cy <= before.maxY; cy++) {
+                for (int32_t cx = before.minX; cx <= before.maxX; cx++) {
+                    if (!after.contains(cx, cy)) removeFromCell(key(cx, cy), id);
+                }
+            }
+            for (int32_t cy = after.minY; cy <= after.maxY; cy++) {
+                for (int32_t cx = after.minX; cx <= after.maxX; cx++) {
+                    if (!before.contains(cx, cy)) cells[key(cx, cy)].push_back(id);
+                }
+            }
+        }
+
+        // Ids of every shape whose cells overlap rect, deduplicated, unordered
+        std::vector<ShapeId> candidates(const AABB& rect) const {
+            std::vector<ShapeId> result(oversized.begin(), oversized.end());
+            if (rect.empty()) return result;
+
+            CellSpan span = spanFor(rect);
+            if (span.cellCount() > cells.size()) {
+                // Huge viewport: cheaper to walk the occupied cells
+                for (const auto& cell : cells) {
+                    if (span.contains(cellX(cell.first), cellY(cell.first))) {
+                        result.insert(result.end(), cell.second.begin(), cell.second.end());
+                    }
+                }
+            } else {
+                for (int32_t cy = span.minY; cy <= span.maxY; cy++) {
+                    for (int32_t cx = span.minX; cx <= span.maxX; cx++) {
+                        auto it = cells.find(key(cx, cy));
+                        if (it != cells.end()) result.insert(result.end(), it->second.begin(), it->second.end());
+                    }
+                }
+            }
+            std::sort(result.begin(), result.end());
+            result.erase(std::unique(result.begin(), result.end()), result.end());
+            return result;
+        }
+
+        void clear() {
+            cells.clear();
+            oversized.clear();
+        }
+
+    private:
+        static constexpr uint64_t MaxCellsPerShape = 1024;
+
+        struct CellSpan {
+            int32_t minX, minY, maxX, maxY;
+            uint64_t cellCount() const { return uint64_t(maxX - minX + 1) * uint64_t(maxY - minY + 1); }
+            bool oversized() const { return cellCount() > MaxCellsPerShape; }
+            bool contains(int32_t cx, int32_t cy) const { return cx >= minX && cx <= maxX && cy >= minY && cy <= maxY; }
+            bool operator==(const CellSpan& o) const { return minX == o.minX && minY == o.minY && maxX == o.maxX && maxY == o.maxY; }
+        };
+
+        int32_t cellOf(float v) const {
+            // Clamp so absurd coordinates cannot overflow the packed key
+            float c = std::floor(v / cellSize);
+            return static_cast<int32_t>(std::max(-1e9f, std::min(1e9f, c)));
+        }
+
+        CellSpan spanFor(const AABB& box) const {
+            return {cellOf(box.minX), cellOf(box.minY), cellOf(box.maxX), cellOf(box.maxY)};
+        }
+
+        static uint64_t key(int32_t cx, int32_t cy) {
+            return (uint64_t(uint32_t(cx)) << 32) | uint32_t(cy);
+        }
+        static int32_t cellX(uint64_t k) { return int32_t(uint32_t(k >> 32)); }
+        static int32_t cellY(uint64_t k) { return int32_t(uint32_t(k)); }
+
+        static void eraseFrom(std::vector<ShapeId>& ids, ShapeId id) {
+            auto it = std::find(ids.begin(), ids.end(), id);
+            if (it != ids.end()) {
+                *it = ids.back();
+                ids.pop_back();
+            }
+        }
+
+        void removeFromCell(uint64_t k, ShapeId id) {
+            auto it = cells.find(k);
+            if (it == cells.end()) return;
+            eraseFrom(it->second, id);
+            if (it->second.empty()) cells.erase(it);
+        }
+
+        float cellSize;
+        std::unordered_map<uint64_t, std::vector<ShapeId>> cells;
+        std::vector<ShapeId> oversized;
+};
@@ -0,0 +1,93 @@
+#pragma once
+#include "../shape.hpp"
+#include <cstdint>
+#include <vector>
+
+// Operation types from docs/002_operational_transform.md; Noop is what a
+// transform leaves of an op that lost its conflict
+enum class OperationType : uint8_t {
+    Noop,
+    StrokeCreate,
+    StrokeUpdate,
+    StrokeDelete,
+    CursorMove,
+    Selection,
+    ClearAll
+};
+
+// One client edit as the OT core sees it: ordering and identity only. The
+// payload (points, colour, partial updates) stays with the caller, keyed by
+// `payload`, which transforms carry through untouched. String ids from the
+// wire (users, strokes) are interned to integers by the caller.
+struct Operation {
+    uint64_t version = 0;      // global, assigned by the room's OperationLog
+    uint64_t baseVersion = 0;  // last version the sender had applied
+    uint64_t timestamp = 0;    // sender's clock in ms; the later update wins
+    ShapeId strokeId = 0;
+    uint32_t userId = 0;       // one per client session
+    uint32_t payload = 0;
+    OperationType type = OperationType::Noop;
+    uint16_t transforms = 0;   // concurrent ops it was transformed against
+
+    Operation() = default;
+    Operation(OperationType type, uint32_t userId, ShapeId strokeId, uint64_t timestamp, uint64_t baseVersion = 0)
+        : baseVersion(baseVersion), timestamp(timestamp), strokeId(strokeId), userId(userId), type(type) {}
+
+    bool isNoop() const { return type == OperationType::Noop; }
+};
+
+// Transform rules shared by the server log and the WASM client.
+//
+// Every rule depends only on the two ops, never on which side applied first,
+// so transform(a, b) and transform(b, a) converge: applying a then
+// transform(b, a) leaves the same board as b then transform(a, b).
+//   - creates, cursor moves and selections never conflict with each other
+//   - update vs update on one stroke: the later timestamp wins (ties go to
+//     the higher user id), the other becomes a noop
+//   - delete beats update; a second delete of a stroke is a noop
+//   - clear_all beats every concurrent stroke op, including creates, which
+//     the clearing user never saw
+namespace OT {
+
+    // True when a's update of a stroke gives way to b's
+    inline bool yieldsTo(const Operation& a, const Operation& b) {
+        return (a.timestamp < b.timestamp) | ((a.timestamp == b.timestamp) & (a.userId < b.userId));
+    }
+
+    // True when `applied` turns `op` into a noop. Branch-free (bitwise, no
+    // short-circuits): the log runs it over long runs of mixed ops.
+    inline bool overrides(const Operation& applied, const Operation& op) {
+        bool cleared = applied.type == OperationType::ClearAll;
+        bool sameStroke = op.strokeId == applied.strokeId;
+        bool deleted = sameStroke & (applied.type == OperationType::StrokeDelete);
+        bool newer = sameStroke & (applied.type == OperationType::StrokeUpdate) & yieldsTo(op, applied);
+        switch (op.type) {
+            case OperationType::StrokeCreate: return cleared;
+            case OperationType::StrokeUpdate: return cleared | deleted | newer;
+            case OperationType::StrokeDelete: return cleared | deleted;
+            default: return false;
+        }
+    }
+
+    // `op` rewritten to apply after `applied`, which neither saw the other
+    inline Operation transform(Operation op, const Operation& applied) {
+        if (overrides(applied, op)) op.type = OperationType::Noop;
+        if (op.transforms < UINT16_MAX) op.transforms++;
+        return op;
+    }
+
+    // Client side: a server op that arrived while `pending` (this client's
+    // unacknowledged ops, oldest first) were already applied locally. Each
+    // pending op is rewritten as if sent after `incoming`, and the returned
+    // op is what to apply on top of the local board. The server's echo of
+    // this client's own op is an ack, not an incoming op: pop it instead.
+    inline Operation rebase(Operation incoming, std::vector<Operation>& pending) {
+        for (Operation& local : pending) {
+            Operation transformed = transform(incoming, local);
+            local = transform(local, incoming);
+            incoming = transformed;
+        }
+        return incoming;
+    }
+
+} // namespace OT
@@ -0,0 +1,51 @@
+#include "OperationLog.hpp"
+#include <algorithm>
+
+OperationLog::OperationLog(size_t capacity) {
+    size_t size = 1;
+    while (size < capacity) size *= 2;
+    ring.resize(size);
+    mask = size - 1;
+}
+
+bool OperationLog::process(Operation& op) {
+    if (!canTransform(op.baseVersion)) return false;
+
+    // A noop stays a noop, so one flag over the run equals transforming
+    // step by step
+    bool overridden = false;
+    uint64_t transforms = op.transforms;
+    for (uint64_t v = op.baseVersion + 1; v <= version; v++) {
+        const Operation& applied = at(v);
+        bool concurrent = applied.userId != op.userId;
+        overridden |= concurrent & OT::overrides(applied, op);
+        transforms += concurrent;
+    }
+    Operation result = op;
+    if (overridden) result.type = OperationType::Noop;
+    result.transforms = static_cast<uint16_t>(std::min<uint64_t>(transforms, UINT16_MAX));
+    result.version = version + 1;
+    if (!append(result)) return false;
+    op = result;
+    return true;
+}
+
+bool OperationLog::append(const Operation& op) {
+    if (op.version != version + 1) return false;
+    ring[op.version & mask] = op;
+    version = op.version;
+    if (count < ring.size()) count++;
+    return true;
+}
+
+bool OperationLog::since(uint64_t from, std::vector<Operation>& out) const {
+    if (!canTransform(from)) return false;
+    out.reserve(out.size() + (version - from));
+    for (uint64_t v = from + 1; v <= version; v++) out.push_back(at(v));
+    return true;
+}
+
+void OperationLog::reset(uint64_t currentVersion) {
+    version = currentVersion;
+    count = 0;
+}
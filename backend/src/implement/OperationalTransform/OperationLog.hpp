@@ -0,0 +1,52 @@
+#pragma once
+#include "Operation.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// One room's recent history: assigns global versions and transforms each
+// late op against everything it missed (docs/002_operational_transform.md,
+// "Operation Processing Flow").
+//
+// The last `capacity` ops sit in a power-of-two ring indexed by version, so
+// the ops after any base version are a contiguous run found without a search,
+// and appending never allocates. A sender whose base version has rotated out
+// cannot be transformed and has to resync from a snapshot.
+//
+// Ops from the sender itself are skipped: a client's own earlier ops are
+// already behind its new one even when not yet acknowledged.
+class OperationLog {
+    public:
+        explicit OperationLog(size_t capacity = 1024);
+
+        // Transforms `op` against the concurrent ops, versions it and appends
+        // it, noop or not, so the sender still gets its ack. False, leaving
+        // `op` alone, when its base version is unknown (ahead of the log or
+        // already rotated out).
+        bool process(Operation& op);
+
+        // Appends an op versioned elsewhere (a client mirroring the server);
+        // false unless it is the next version
+        bool append(const Operation& op);
+
+        // Ops after `version`, oldest first; false when some have rotated out
+        bool since(uint64_t version, std::vector<Operation>& out) const;
+
+        uint64_t currentVersion() const { return version; }
+        uint64_t oldestVersion() const { return version - count + 1; }  // currentVersion() + 1 when empty
+        size_t size() const { return count; }
+        size_t capacity() const { return ring.size(); }
+        bool canTransform(uint64_t baseVersion) const { return baseVersion <= version && baseVersion + 1 >= oldestVersion(); }
+
+        // Forgets the history and continues from `currentVersion` (after a
+        // snapshot load or resync)
+        void reset(uint64_t currentVersion = 0);
+
+    private:
+        const Operation& at(uint64_t v) const { return ring[v & mask]; }
+
+        std::vector<Operation> ring;
+        uint64_t mask;
+        uint64_t version = 0;
+        size_t count = 0;
+};
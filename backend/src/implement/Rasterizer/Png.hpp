@@ -0,0 +1,230 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Minimal PNG encoder for 8-bit RGBA images, with no zlib dependency.
+//
+// Rows use the Sub filter, which turns flat runs (board backgrounds) into
+// zeros. The filtered bytes go through a greedy LZ77 pass with a single
+// hash probe per position and a fixed-Huffman deflate block. That is far
+// from zlib's ratio on photos, but previews are mostly background and
+// strokes, and encoding stays a small fraction of rasterizing.
+namespace Png {
+
+    namespace detail {
+
+        inline uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+            static const std::vector<uint32_t> table = [] {
+                std::vector<uint32_t> t(256);
+                for (uint32_t n = 0; n < 256; n++) {
+                    uint32_t c = n;
+                    for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                    t[n] = c;
+                }
+                return t;
+            }();
+            crc = ~crc;
+            for (size_t i = 0; i < size; i++) crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+            return ~crc;
+        }
+
+        inline uint32_t adler32(const uint8_t* data, size_t size) {
+            uint32_t a = 1, b = 0;
+            while (size > 0) {
+                size_t block = size < 5552 ? size : 5552;  // largest run without overflow
+                size -= block;
+                while (block--) {
+                    a += *data++;
+                    b += a;
+                }
+                a %= 65521;
+                b %= 65521;
+            }
+            return (b << 16) | a;
+        }
+
+        // Deflate writes bits least significant first
+        class BitWriter {
+            public:
+                explicit BitWriter(std::vector<uint8_t>& out) : out(out) {}
+
+                void bits(uint32_t value, int count) {
+                    buffer |= uint64_t(value) << filled;
+                    filled += count;
+                    while (filled >= 8) {
+                        out.push_back(uint8_t(buffer));
+                        buffer >>= 8;
+                        filled -= 8;
+                    }
+                }
+
+
+                void flush() {
+                    if (filled > 0) out.push_back(uint8_t(buffer));
+                    buffer = 0;
+                    filled = 0;
+                }
+
+            private:
+                std::vector<uint8_t>& out;
+                uint64_t buffer = 0;
+                int filled = 0;
+        };
+
+        // Huffman codes are defined most significant bit first, the stream
+        // least significant first; codes are stored pre-reversed
+        inline uint16_t reverse(uint32_t code, int length) {
+            uint32_t reversed = 0;
+            for (int i = 0; i < length; i++) reversed |= ((code >> i) & 1) << (length - 1 - i);
+            return static_cast<uint16_t>(reversed);
+        }
+
+        struct FixedCodes {
+            uint16_t literal[288];
+            uint8_t literalLength[288];
+            uint16_t distance[30];
+
+            // The fixed Huffman alphabets (RFC 1951, 3.2.6)
+            FixedCodes() {
+                for (uint32_t symbol = 0; symbol < 288; symbol++) {
+                    uint32_t code;
+                    int length;
+                    if (symbol < 144) { code = 0x30 + symbol; length = 8; }
+                    else if (symbol < 256) { code = 0x190 + symbol - 144; length = 9; }
+                    else if (symbol < 280) { code = symbol - 256; length = 7; }
+                    else { code = 0xC0 + symbol - 280; length = 8; }
+                    literal[symbol] = reverse(code, length);
+                    literalLength[symbol] = static_cast<uint8_t>(length);
+                }
+                for (uint32_t symbol = 0; symbol < 30; symbol++) distance[symbol] = reverse(symbol, 5);
+            }
+        };
+
+        inline const FixedCodes& fixedCodes() {
+            static const FixedCodes codes;
+            return codes;
+        }
+
+        inline void literalLength(BitWriter& writer, const FixedCodes& codes, uint32_t symbol) {
+            writer.bits(codes.literal[symbol], codes.literalLength[symbol]);
+        }
+
+        inline void match(BitWriter& writer, const FixedCodes& codes, uint32_t length, uint32_t distance) {
+            static const uint16_t lengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                                    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+            static const uint8_t lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                                    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+            static const uint16_t distanceBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+                                                      193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+                                                      6145, 8193, 12289, 16385, 24577};
+            static const uint8_t distanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                                      6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+            int l = 28;
+            while (lengthBase[l] > length) l--;
+            literalLength(writer, codes, 257 + l);
+            writer.bits(length - lengthBase[l], lengthExtra[l]);
+            int d = 29;
+            while (distanceBase[d] > distance) d--;
+            writer.bits(codes.distance[d], 5);
+            writer.bits(distance - distanceBase[d], distanceExtra[d]);
+        }
+
+        // zlib stream: header, one final fixed-Huffman block, Adler-32
+        inline std::vector<uint8_t> deflate(const std::vector<uint8_t>& data) {
+            constexpr size_t Window = 32768;
+            constexpr uint32_t MaxMatch = 258;
+            constexpr int HashBits = 15;
+
+            std::vector<uint8_t> out = {0x78, 0x01};
+            out.reserve(data.size() / 4 + 64);
+            BitWriter writer(out);
+            const FixedCodes& codes = fixedCodes();
+            writer.bits(1, 1);  // BFINAL
+            writer.bits(1, 2);  // BTYPE = fixed Huffman
+
+            std::vector<int64_t> head(size_t(1) << HashBits, -1);
+            auto hash = [&data](size_t i) {
+                uint32_t v = uint32_t(data[i]) | uint32_t(data[i + 1]) << 8 | uint32_t(data[i + 2]) << 16;
+                return (v * 2654435761u) >> (32 - HashBits);
+            };
+
+            size_t i = 0;
+            while (i < data.size()) {
+                uint32_t length = 0;
+                size_t distance = 0;
+                if (i + 3 <= data.size()) {
+                    uint32_t h = hash(i);
+                    int64_t candidate = head[h];
+                    head[h] = static_cast<int64_t>(i);
+                    if (candidate >= 0 && i - size_t(candidate) <= Window) {
+                        size_t limit = std::min<size_t>(MaxMatch, data.size() - i);
+                        while (length < limit && data[size_t(candidate) + length] == data[i + length]) length++;
+                        distance = i - size_t(candidate);
+                    }
+                }
+                if (length >= 3) {
+                    match(writer, codes, length, static_cast<uint32_t>(distance));
+                    // Index the skipped positions so later runs still find them
+                    for (size_t k = i + 1; k < i + length && k + 3 <= data.size(); k++) head[hash(k)] = static_cast<int64_t>(k);
+                    i += length;
+                } else {
+                    literalLength(writer, codes, data[i]);
+                    i++;
+                }
+            }
+            literalLength(writer, codes, 256);  // end of block
+            writer.flush();
+
+            uint32_t adler = adler32(data.data(), data.size());
+            for (int shift = 24; shift >= 0; shift -= 8) out.push_back(uint8_t(adler >> shift));
+            return out;
+        }
+
+        inline void putBigEndian(std::vector<uint8_t>& out, uint32_t v) {
+            for (int shift = 24; shift >= 0; shift -= 8) out.push_back(uint8_t(v >> shift));
+        }
+
+        inline void chunk(std::vector<uint8_t>& out, const char type[4], const std::vector<uint8_t>& body) {
+            putBigEndian(out, static_cast<uint32_t>(body.size()));
+            size_t start = out.size();
+            out.insert(out.end(), type, type + 4);
+            out.insert(out.end(), body.begin(), body.end());
+            putBigEndian(out, crc32(out.data() + start, out.size() - start));
+        }
+
+    } // namespace detail
+
+    // rgba holds width * height pixels, rows top to bottom, straight alpha
+    inline std::vector<uint8_t> encode(const uint8_t* rgba, uint32_t width, uint32_t height) {
+        size_t stride = size_t(width) * 4;
+        std::vector<uint8_t> filtered;
+        filtered.reserve((stride + 1) * height);
+        for (uint32_t y = 0; y < height; y++) {
+            const uint8_t* row = rgba + y * stride;
+            filtered.push_back(1);  // Sub: each byte minus the one a pixel to the left
+            for (size_t x = 0; x < stride; x++) filtered.push_back(uint8_t(row[x] - (x >= 4 ? row[x - 4] : 0)));
+        }
+
+        std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        std::vector<uint8_t> header;
+        detail::putBigEndian(header, width);
+        detail::putBigEndian(header, height);
+        header.insert(header.end(), {8, 6, 0, 0, 0});  // 8-bit RGBA, deflate, no interlace
+        detail::chunk(png, "IHDR", header);
+        detail::chunk(png, "IDAT", detail::deflate(filtered));
+        detail::chunk(png, "IEND", {});
+        return png;
+    }
+
+    inline bool writeFile(const std::string& path, const std::vector<uint8_t>& bytes) {
+        FILE* file = fopen(path.c_str(), "wb");
+        if (!file) return false;
+        bool ok = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+        return fclose(file) == 0 && ok;
+    }
+
+} // namespace Png
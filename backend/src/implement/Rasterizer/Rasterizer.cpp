@@ -0,0 +1,339 @@
+#include "Rasterizer.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <thread>
+
+namespace {
+
+constexpr int TileSize = 64;
+constexpr uint32_t ChunkSegments = 16;
+constexpr float MergeDistance = 0.5f;      // pixels; closer points are merged
+constexpr float OutlineTolerance = 0.25f;  // pixels an ellipse outline may stray
+constexpr uint32_t NoPath = UINT32_MAX;
+
+// World to pixel: uniform scale, then offset
+struct View {
+    float scale = 1.0f;
+    float offsetX = 0.0f;
+    float offsetY = 0.0f;
+
+    Point toPixel(const Point& world) const {
+        return Point(world.x * scale + offsetX, world.y * scale + offsetY);
+    }
+};
+
+struct Path {
+    float r, g, b, a;  // a scaled down for hairlines
+    float halfWidth;   // pixels, at least half a pixel
+};
+
+// Up to ChunkSegments consecutive segments of one path (count points,
+// sharing the last with the next chunk), with their pixel box
+struct Chunk {
+    uint32_t path;
+    uint32_t first;
+    uint32_t count;
+    AABB box;
+};
+
+struct Scene {
+    std::vector<Point> points;  // pixel space, every path back to back
+    std::vector<Path> paths;
+    std::vector<Chunk> chunks;
+    std::vector<std::vector<uint32_t>> tiles;  // chunk indices per tile, draw order
+    int tilesX = 0;
+    int tilesY = 0;
+};
+
+View fitView(const AABB& area, float margin, uint32_t width, uint32_t height) {
+    View view;
+    float areaWidth = area.maxX - area.minX;
+    float areaHeight = area.maxY - area.minY;
+    float roomX = std::max(float(width) - 2.0f * margin, 1.0f);
+    float roomY = std::max(float(height) - 2.0f * margin, 1.0f);
+    if (areaWidth > 0.0f || areaHeight > 0.0f) {
+        view.scale = std::min(areaWidth > 0.0f ? roomX / areaWidth : INFINITY,
+                              areaHeight > 0.0f ? roomY / areaHeight : INFINITY);
+    }
+    view.offsetX = (float(width) - areaWidth * view.scale) * 0.5f - area.minX * view.scale;
+    view.offsetY = (float(height) - areaHeight * view.scale) * 0.5f - area.minY * view.scale;
+    return view;
+}
+
+// Appends the shape's world-space path to scratch
+void appendWorldPath(const Shape& shape, const View& view, std::vector<Point>& scratch) {
+    ShapeStore::visitShape(shape, [&](const auto& typed) {
+        using Typed = std::decay_t<decltype(typed)>;
+        if constexpr (isStrokeType<Typed>) {
+            for (size_t i = 0; i < typed.pointCount(); i++) scratch.push_back(typed.pointAt(i));
+        } else if constexpr (std::is_same<Typed, EllipseShape>::value) {
+            float radius = std::max(typed.radiusX, typed.radiusY) * typed.transform.maxScale() * view.scale;
+            typed.appendOutline(EllipseShape::segmentsFor(radius, OutlineTolerance), scratch);
+        } else {
+            typed.appendOutline(scratch);
+        }
+    });
+    if (!shape.transform.isIdentity()) {
+        for (Point& point : scratch) point = shape.transform.apply(point);
+    }
+}
+
+void addPath(Scene& scene, const Shape& shape, const View& view, std::vector<Point>& scratch) {
+    // Lines thinner than a pixel are drawn a pixel wide and correspondingly faint
+    float width = shape.thickness * view.scale;
+    float alpha = shape.color.a * std::min(width, 1.0f);
+    if (!(alpha > 0.0f)) return;
+
+    scratch.clear();
+    appendWorldPath(shape, view, scratch);
+    if (scratch.empty()) return;
+
+    uint32_t first = static_cast<uint32_t>(scene.points.size());
+    Point last = view.toPixel(scratch[0]);
+    scene.points.push_back(last);
+    for (size_t i = 1; i < scratch.size(); i++) {
+        Point point = view.toPixel(scratch[i]);
+        float dx = point.x - last.x, dy = point.y - last.y;
+        if (dx * dx + dy * dy >= MergeDistance * MergeDistance || i + 1 == scratch.size()) {
+            scene.points.push_back(point);
+            last = point;
+        }
+    }
+    uint32_t count = static_cast<uint32_t>(scene.points.size()) - first;
+
+    uint32_t pathIndex = static_cast<uint32_t>(scene.paths.size());
+    float halfWidth = std::max(width, 1.0f) * 0.5f;
+    scene.paths.push_back({shape.color.r, shape.color.g, shape.color.b, alpha, halfWidth});
+
+    float reach = halfWidth + 1.0f;
+    for (uint32_t start = 0; start == 0 || start + 1 < count; start += ChunkSegments) {
+        Chunk chunk;
+        chunk.path = pathIndex;
+        chunk.first = first + start;
+        chunk.count = std::min(ChunkSegments + 1, count - start);
+        for (uint32_t i = 0; i < chunk.count; i++) {
+            const Point& point = scene.points[chunk.first + i];
+            chunk.box.expand(point.x, point.y, reach);
+        }
+        scene.chunks.push_back(chunk);
+    }
+}
+
+void binChunks(Scene& scene, uint32_t width, uint32_t height) {
+    scene.tilesX = static_cast<int>((width + TileSize - 1) / TileSize);
+    scene.tilesY = static_cast<int>((height + TileSize - 1) / TileSize);
+    scene.tiles.assign(size_t(scene.tilesX) * scene.tilesY, {});
+    for (uint32_t i = 0; i < scene.chunks.size(); i++) {
+        const AABB& box = scene.chunks[i].box;
+        if (box.maxX < 0.0f || box.maxY < 0.0f || box.minX >= float(width) || box.minY >= float(height)) continue;
+        int x0 = static_cast<int>(std::max(box.minX, 0.0f)) / TileSize;
+        int y0 = static_cast<int>(std::max(box.minY, 0.0f)) / TileSize;
+        int x1 = std::min(scene.tilesX - 1, static_cast<int>(std::min(box.maxX, float(width - 1))) / TileSize);
+        int y1 = std::min(scene.tilesY - 1, static_cast<int>(std::min(box.maxY, float(height - 1))) / TileSize);
+        for (int ty = y0; ty <= y1; ty++) {
+            for (int tx = x0; tx <= x1; tx++) scene.tiles[size_t(ty) * scene.tilesX + tx].push_back(i);
+        }
+    }
+}
+
+// One worker's buffers for a tile: premultiplied colour, the current path's
+// coverage, and the span of each row that coverage touched
+struct TileBuffers {
+    float color[TileSize * TileSize * 4];
+    float coverage[TileSize * TileSize] = {};
+    int rowMin[TileSize];
+    int rowMax[TileSize];
+};
+
+class TileRenderer {
+    public:
+        TileRenderer(const Scene& scene, const RasterOptions& options, RasterImage& image)
+            : scene(scene), options(options), image(image) {}
+
+        void render(int tileX, int tileY, TileBuffers& buffers) {
+            originX = tileX * TileSize;
+            originY = tileY * TileSize;
+            tileWidth = std::min<int>(TileSize, int(image.width) - originX);
+            tileHeight = std::min<int>(TileSize, int(image.height) - originY);
+            tile = &buffers;
+
+            const Color& bg = options.background;
+            for (int i = 0; i < TileSize * TileSize; i++) {
+                float* pixel = tile->color + i * 4;
+                pixel[0] = bg.r * bg.a;
+                pixel[1] = bg.g * bg.a;
+                pixel[2] = bg.b * bg.a;
+                pixel[3] = bg.a;
+            }
+            for (int row = 0; row < TileSize; row++) {
+                tile->rowMin[row] = TileSize;
+                tile->rowMax[row] = -1;
+            }
+
+            uint32_t current = NoPath;
+            for (uint32_t index : scene.tiles[size_t(tileY) * scene.tilesX + tileX]) {
+                const Chunk& chunk = scene.chunks[index];
+                if (chunk.path != current) {
+                    if (current != NoPath) composite(scene.paths[current]);
+                    current = chunk.path;
+                }
+                float halfWidth = scene.paths[current].halfWidth;
+                const Point* points = scene.points.data() + chunk.first;
+                if (chunk.count == 1) cover(points[0], points[0], halfWidth);
+                for (uint32_t i = 1; i < chunk.count; i++) cover(points[i - 1], points[i], halfWidth);
+            }
+            if (current != NoPath) composite(scene.paths[current]);
+            writeOut();
+        }
+
+    private:
+        // Scanline pass over one segment's capsule: per row, only the span
+        // the segment can reach gets exact distances
+        void cover(Point a, Point b, float halfWidth) {
+            a = Point(a.x - originX, a.y - originY);
+            b = Point(b.x - originX, b.y - originY);
+            float reach = halfWidth + 0.5f;
+            float dx = b.x - a.x, dy = b.y - a.y;
+            float lengthSq = dx * dx + dy * dy;
+            float inverse = lengthSq > 0.0f ? 1.0f / lengthSq : 0.0f;
+
+            int rowStart = clampToTile(std::floor(std::min(a.y, b.y) - reach), tileHeight);
+            int rowEnd = clampToTile(std::ceil(std::max(a.y, b.y) + reach), tileHeight);
+            for (int row = rowStart; row <= rowEnd; row++) {
+                float cy = row + 0.5f;
+                float low, high;
+                if (std::fabs(dy) < 1e-6f) {
+                    if (std::fabs(cy - a.y) > reach) continue;
+                    low = std::min(a.x, b.x);
+                    high = std::max(a.x, b.x);
+                } else {
+                    // The part of the segment within reach of this row
+                    float t0 = (cy - reach - a.y) / dy, t1 = (cy + reach - a.y) / dy;
+                    if (t0 > t1) std::swap(t0, t1);
+                    t0 = std::max(t0, 0.0f);
+                    t1 = std::min(t1, 1.0f);
+                    if (t0 > t1) continue;
+                    low = std::min(a.x + t0 * dx, a.x + t1 * dx);
+                    high = std::max(a.x + t0 * dx, a.x + t1 * dx);
+                }
+                int colStart = clampToTile(std::floor(low - reach), tileWidth);
+                int colEnd = clampToTile(std::ceil(high + reach), tileWidth);
+
+                float* coverage = tile->coverage + row * TileSize;
+                bool touched = false;
+                for (int col = colStart; col <= colEnd; col++) {
+                    float px = col + 0.5f;
+                    float t = std::min(std::max(((px - a.x) * dx + (cy - a.y) * dy) * inverse, 0.0f), 1.0f);
+                    float ex = px - a.x - t * dx, ey = cy - a.y - t * dy;
+                    float c = reach - std::sqrt(ex * ex + ey * ey);
+                    if (c > 0.0f) {
+                        coverage[col] = std::max(coverage[col], std::min(c, 1.0f));
+                        touched = true;
+                    }
+                }
+                if (touched) {
+                    tile->rowMin[row] = std::min(tile->rowMin[row], colStart);
+                    tile->rowMax[row] = std::max(tile->rowMax[row], colEnd);
+                }
+            }
+        }
+
+        // Blends the path's coverage source-over, then clears it
+        void composite(const Path& path) {
+            for (int row = 0; row < tileHeight; row++) {
+                float* coverage = tile->coverage + row * TileSize;
+                for (int col = tile->rowMin[row]; col <= tile->rowMax[row]; col++) {
+                    float alpha = path.a * coverage[col];
+                    coverage[col] = 0.0f;
+                    if (alpha <= 0.0f) continue;
+                    float* pixel = tile->color + (row * TileSize + col) * 4;
+                    float keep = 1.0f - alpha;
+                    pixel[0] = path.r * alpha + pixel[0] * keep;
+                    pixel[1] = path.g * alpha + pixel[1] * keep;
+                    pixel[2] = path.b * alpha + pixel[2] * keep;
+                    pixel[3] = alpha + pixel[3] * keep;
+                }
+                tile->rowMin[row] = TileSize;
+                tile->rowMax[row] = -1;
+            }
+        }
+
+        void writeOut() {
+            auto toByte = [](float v) { return uint8_t(std::min(std::max(v, 0.0f), 1.0f) * 255.0f + 0.5f); };
+            for (int row = 0; row < tileHeight; row++) {
+                uint8_t* out = image.rgba.data() + (size_t(originY + row) * image.width + originX) * 4;
+                const float* pixel = tile->color + row * TileSize * 4;
+                for (int col = 0; col < tileWidth; col++, pixel += 4, out += 4) {
+                    float alpha = pixel[3];
+                    float unmultiply = alpha > 0.0f ? 1.0f / alpha : 0.0f;
+                    out[0] = toByte(pixel[0] * unmultiply);
+                    out[1] = toByte(pixel[1] * unmultiply);
+                    out[2] = toByte(pixel[2] * unmultiply);
+                    out[3] = toByte(alpha);
+                }
+            }
+        }
+
+        static int clampToTile(float v, int size) {
+            return static_cast<int>(std::min(std::max(v, 0.0f), float(size - 1)));
+        }
+
+        const Scene& scene;
+        const RasterOptions& options;
+        RasterImage& image;
+        TileBuffers* tile = nullptr;
+        int originX = 0, originY = 0;
+        int tileWidth = 0, tileHeight = 0;
+};
+
+} // namespace
+
+namespace Rasterizer {
+
+RasterImage render(const DrawingEngine& engine, const RasterOptions& options) {
+    RasterImage image;
+    image.width = options.width;
+    image.height = options.height;
+    if (image.width == 0 || image.height == 0) return image;
+    image.rgba.resize(size_t(image.width) * image.height * 4);
+
+    bool fitted = options.viewport.empty();
+    AABB area = fitted ? engine.getBoardBounds() : options.viewport;
+    if (area.empty()) area = AABB(0, 0, 0, 0);
+    View view = fitView(area, fitted ? options.margin : 0.0f, image.width, image.height);
+
+    // Everything the image shows, which is wider than area on one axis
+    AABB visible(-view.offsetX / view.scale, -view.offsetY / view.scale,
+                 (float(image.width) - view.offsetX) / view.scale, (float(image.height) - view.offsetY) / view.scale);
+
+    Scene scene;
+    std::vector<Point> scratch;
+    for (const Shape* shape : engine.getShapes()) {
+        if (engine.getShapeBounds(shape->id).intersects(visible)) addPath(scene, *shape, view, scratch);
+    }
+    binChunks(scene, image.width, image.height);
+
+    size_t tileCount = scene.tiles.size();
+    unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<size_t>(threads, tileCount));
+
+    std::atomic<size_t> next(0);
+    auto work = [&]() {
+        // Workers take tiles in turn; each has its own buffers, and tiles
+        // write disjoint parts of the image
+        std::unique_ptr<TileBuffers> buffers(new TileBuffers());
+        TileRenderer renderer(scene, options, image);
+        for (size_t tile; (tile = next++) < tileCount;) {
+            renderer.render(static_cast<int>(tile % scene.tilesX), static_cast<int>(tile / scene.tilesX), *buffers);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < threads; i++) pool.emplace_back(work);
+    work();
+    for (std::thread& thread : pool) thread.join();
+    return image;
+}
+
+} // namespace Rasterizer
@@ -0,0 +1,40 @@
+#pragma once
+#include "../DrawingEngine/DrawingEngine.hpp"
+#include <cstdint>
+#include <vector>
+
+struct RasterOptions {
+    uint32_t width = 256;
+    uint32_t height = 256;
+    AABB viewport;           // world area to draw; empty fits the board's bounds
+    float margin = 8.0f;     // pixels kept clear around a fitted board
+    Color background = Color(1, 1, 1, 1);
+    unsigned threads = 0;    // 0: one per core
+};
+
+// 8-bit RGBA, straight alpha, rows top to bottom
+struct RasterImage {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> rgba;
+};
+
+// CPU renderer for board previews, no GPU or browser needed.
+//
+// The viewport is scaled uniformly to fit the image and centred. Every
+// shape becomes a pixel-space polyline (points closer than half a pixel
+// merged, ellipses segmented for the output size) drawn with round joins and
+// caps, as the default tessellation style draws them. Coverage is the
+// distance to the nearest segment, anti-aliased over one pixel and taken as
+// the maximum within a shape, so a stroke crossing itself does not darken;
+// shapes are blended source-over in draw order.
+//
+// The image is cut into 64-pixel tiles rendered in parallel. Paths are
+// split into short chunks binned to the tiles they touch, and each tile
+// scans rows of only the segments binned to it, so one long stroke does not
+// make every tile walk all of its points.
+namespace Rasterizer {
+
+    RasterImage render(const DrawingEngine& engine, const RasterOptions& options = RasterOptions());
+
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include "RoomServer.hpp"
+#include "../CrdtDocument/CrdtDocument.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// In-process client for tests and load runs: frames go straight to
+// RoomServer::receive() and are drained from the session's outbox, with no
+// sockets involved. Each client holds its own replica of the room
+// (CrdtDocument over a DrawingEngine), so a test can edit through
+// document(), flush() the ops and check that other clients converge.
+class LoopbackClient {
+    public:
+        LoopbackClient(RoomServer& server, uint32_t replicaId)
+            : server(server), signal(std::make_shared<Signal>()), replica(board, replicaId), user(replicaId) {
+            session = server.open(signal);
+        }
+
+        ~LoopbackClient() { server.close(session); }
+
+        LoopbackClient(const LoopbackClient&) = delete;
+        LoopbackClient& operator=(const LoopbackClient&) = delete;
+
+        void join(const std::string& room) { send(RoomProtocol::join(room)); }
+        void leave() { send({RoomProtocol::Leave}); }
+        void send(const std::vector<uint8_t>& frame) { server.receive(session, frame.data(), frame.size()); }
+        // Reports this client's cursor under its replica id
+        void moveCursor(float x, float y) { send(RoomProtocol::cursor(user, x, y)); }
+
+        // Sends the document's queued local ops as one frame; false if none
+        bool flush() {
+            if (!replica.hasPendingOps()) return false;
+            std::vector<uint8_t> ops = replica.takeOps();
+            send(RoomProtocol::frame(RoomProtocol::Ops, ops.data(), ops.size()));
+            return true;
+        }
+
+        // Handles every frame delivered so far: a Welcome or Broadcast
+        // merges into the document, a Presence replaces cursors(), an Error
+        // is recorded. Returns how many.
+        size_t poll() {
+            std::vector<RoomProtocol::SharedFrame> frames;
+            session->outbox.drain(frames);
+            for (const RoomProtocol::SharedFrame& shared : frames) {
+                const std::vector<uint8_t>& frame = *shared;
+                if (frame.empty()) continue;
+                if (frame[0] == RoomProtocol::Welcome) welcomes++;
+                if (frame[0] == RoomProtocol::Welcome || frame[0] == RoomProtocol::Broadcast) {
+                    replica.applyEncoded(frame.data() + 1, frame.size() - 1);
+                } else if (frame[0] == RoomProtocol::Presence) {
+                    if (RoomProtocol::parsePresence(frame.data(), frame.size(), snapshot)) presences++;
+                } else if (frame[0] == RoomProtocol::Error && frame.size() == 2) {
+                    errors.push_back(static_cast<RoomProtocol::ErrorCode>(frame[1]));
+                }
+            }
+            received += frames.size();
+            return frames.size();
+        }
+
+        // Polls until done() holds; false on timeout
+        bool waitUntil(const std::function<bool()>& done, int timeoutMs = 2000) {
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+            for (;;) {
+                poll();
+                if (done()) return true;
+                std::unique_lock<std::mutex> lock(signal->mutex);
+                if (!signal->arrived.wait_until(lock, deadline, [this] { return signal->pending; })) {
+                    lock.unlock();
+                    poll();
+                    return done();
+                }
+                signal->pending = false;
+            }
+        }
+
+        CrdtDocument& document() { return replica; }
+        DrawingEngine& engine() { return board; }
+        size_t framesReceived() const { return received; }
+        size_t framesQueued() const { return session->outbox.size(); }
+        size_t welcomesReceived() const { return welcomes; }
+        size_t presencesReceived() const { return presences; }
+        const std::vector<RoomProtocol::CursorPosition>& cursors() const { return snapshot; }
+        const std::vector<RoomProtocol::ErrorCode>& errorsReceived() const { return errors; }
+
+    private:
+        struct Signal : Peer {
+            void ready() override {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    pending = true;
+                }
+                arrived.notify_all();
+            }
+
+            std::mutex mutex;
+            std::condition_variable arrived;
+            bool pending = false;
+        };
+
+        RoomServer& server;
+        std::shared_ptr<Signal> signal;
+        std::shared_ptr<Session> session;
+        DrawingEngine board;
+        CrdtDocument replica;
+        uint32_t user;
+        size_t received = 0;
+        size_t welcomes = 0;
+        size_t presences = 0;
+        std::vector<RoomProtocol::CursorPosition> snapshot;
+        std::vector<RoomProtocol::ErrorCode> errors;
+};
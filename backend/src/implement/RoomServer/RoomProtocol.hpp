@@ -0,0 +1,151 @@
+#pragma once
+#include "../varint.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Binary frames between whiteboard clients and the room server. Each frame
+// is one transport message (a WebSocket binary message, one loopback
+// delivery) and starts with its type byte:
+//
+//   client -> server
+//     Join       varint name length, room name bytes
+//     Leave      -
+//     Ops        CRDT op packet (CrdtCodec), applied to the room and relayed
+//     Cursor     varint user id, f32 x, f32 y
+//   server -> client
+//     Welcome    the room's document (CrdtDocument::encodeState)
+//     Broadcast  ops another member sent, as received
+//     Error      u8 ErrorCode
+//     Presence   varint count, then count x (varint user id, f32 x, f32 y):
+//                every cursor in the room, replacing the previous snapshot
+//
+// Ops are never echoed to their sender, which applied them locally already.
+// Cursors are lossy: the server keeps the latest per connection and sends
+// snapshots at its own rate, including the receiver's own cursor.
+namespace RoomProtocol {
+
+    enum MessageType : uint8_t {
+        Join = 1,
+        Leave = 2,
+        Ops = 3,
+        Cursor = 4,
+        Welcome = 16,
+        Broadcast = 17,
+        Error = 18,
+        Presence = 19
+    };
+
+    enum ErrorCode : uint8_t {
+        NotJoined = 1,    // Ops or Leave before a Join
+        Malformed = 2,    // unknown type, bad room name, or ops that do not decode
+        TooLarge = 3      // frame over the server's limit
+    };
+
+    constexpr size_t MaxRoomName = 128;
+
+    struct CursorPosition {
+        uint32_t user = 0;
+        float x = 0.0f;
+        float y = 0.0f;
+    };
+
+    // Outbound frames are built once and shared, read-only, by every
+    // connection queue they are pushed to
+    using SharedFrame = std::shared_ptr<const std::vector<uint8_t>>;
+
+    inline SharedFrame share(std::vector<uint8_t> frame) {
+        return std::make_shared<const std::vector<uint8_t>>(std::move(frame));
+    }
+
+    inline std::vector<uint8_t> join(const std::string& room) {
+        std::vector<uint8_t> frame = {Join};
+        Varint::write(frame, room.size());
+        frame.insert(frame.end(), room.begin(), room.end());
+        return frame;
+    }
+
+    // Type byte followed by a body (ops, state)
+    inline std::vector<uint8_t> frame(MessageType type, const uint8_t* body = nullptr, size_t size = 0) {
+        std::vector<uint8_t> out;
+        out.reserve(size + 1);
+        out.push_back(type);
+        if (size) out.insert(out.end(), body, body + size);
+        return out;
+    }
+
+    inline std::vector<uint8_t> error(ErrorCode code) {
+        return {Error, code};
+    }
+
+    // Room name of a Join frame; false if malformed or too long
+    inline bool parseJoin(const uint8_t* data, size_t size, std::string& room) {
+        if (size < 1 || data[0] != Join) return false;
+        const uint8_t* p = data + 1;
+        const uint8_t* end = data + size;
+        uint64_t length;
+        if (!Varint::read(p, end, length) || length == 0 || length > MaxRoomName || length != uint64_t(end - p)) return false;
+        room.assign(reinterpret_cast<const char*>(p), size_t(length));
+        return true;
+    }
+
+    inline void writeCursor(std::vector<uint8_t>& out, const CursorPosition& cursor) {
+        Varint::write(out, cursor.user);
+        size_t at = out.size();
+        out.resize(at + 2 * sizeof(float));
+        std::memcpy(out.data() + at, &cursor.x, sizeof(float));
+        std::memcpy(out.data() + at + sizeof(float), &cursor.y, sizeof(float));
+    }
+
+    inline bool readCursor(const uint8_t*& p, const uint8_t* end, CursorPosition& cursor) {
+        uint64_t user;
+        if (!Varint::read(p, end, user) || user > UINT32_MAX || size_t(end - p) < 2 * sizeof(float)) return false;
+        cursor.user = uint32_t(user);
+        std::memcpy(&cursor.x, p, sizeof(float));
+        std::memcpy(&cursor.y, p + sizeof(float), sizeof(float));
+        p += 2 * sizeof(float);
+        return true;
+    }
+
+    inline std::vector<uint8_t> cursor(uint32_t user, float x, float y) {
+        std::vector<uint8_t> frame = {Cursor};
+        writeCursor(frame, {user, x, y});
+        return frame;
+    }
+
+    inline bool parseCursor(const uint8_t* data, size_t size, CursorPosition& cursor) {
+        if (size < 1 || data[0] != Cursor) return false;
+        const uint8_t* p = data + 1;
+        return readCursor(p, data + size, cursor) && p == data + size;
+    }
+
+    inline std::vector<uint8_t> presence(const std::vector<CursorPosition>& cursors) {
+        std::vector<uint8_t> frame = {Presence};
+        frame.reserve(1 + 5 + cursors.size() * 13);
+        Varint::write(frame, cursors.size());
+        for (const CursorPosition& cursor : cursors) writeCursor(frame, cursor);
+        return frame;
+    }
+
+    inline bool parsePresence(const uint8_t* data, size_t size, std::vector<CursorPosition>& cursors) {
+        if (size < 1 || data[0] != Presence) return false;
+        const uint8_t* p = data + 1;
+        const uint8_t* end = data + size;
+        uint64_t count;
+        // Each cursor takes at least 9 bytes, which bounds the reserve
+        if (!Varint::read(p, end, count) || count > uint64_t(end - p) / 9) return false;
+        cursors.clear();
+        cursors.reserve(size_t(count));
+        for (uint64_t i = 0; i < count; i++) {
+            CursorPosition cursor;
+            if (!readCursor(p, end, cursor)) return false;
+            cursors.push_back(cursor);
+        }
+        return p == end;
+    }
+
+} // namespace RoomProtocol
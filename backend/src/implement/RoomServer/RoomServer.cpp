@@ -0,0 +1,373 @@
+#include "RoomServer.hpp"
+#include "../CrdtDocument/CrdtDocument.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <unordered_map>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Member {
+    std::shared_ptr<Session> session;
+    uint32_t cursorSeen = 0;  // cursorVersion in the last snapshot
+};
+
+// A room lives on one shard and is only touched by that shard's thread.
+// Rooms are kept until the server stops; persisting them is the Go
+// server's job for now.
+struct Room {
+    DrawingEngine engine;
+    CrdtDocument document;
+    std::vector<Member> members;
+    RoomProtocol::SharedFrame welcome;  // encodeState() as a Welcome; reset by every applied op
+    bool membersChanged = false;        // since the last presence snapshot
+    size_t cursorsShown = 0;            // in the last presence snapshot
+    Clock::time_point nextSnapshot;
+
+    Room() : document(engine, 0) {}
+};
+
+struct Event {
+    enum Kind : uint8_t { Join, Leave, Frame, Fail };
+
+    Event(Kind kind, std::shared_ptr<Session> session) : kind(kind), session(std::move(session)) {}
+
+    Kind kind;
+    std::shared_ptr<Session> session;
+    std::string room;            // Join
+    std::vector<uint8_t> data;   // Frame
+    RoomProtocol::ErrorCode error = RoomProtocol::Malformed;  // Fail
+};
+
+} // namespace
+
+// One worker: an inbox other threads post to and a thread that drains it
+// in batches, owning the rooms that hash to it
+class Shard {
+    public:
+        explicit Shard(const ServerOptions& options) : options(options), thread([this] { run(); }) {}
+
+        void post(Event event) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (stopping) return;
+                inbox.push_back(std::move(event));
+            }
+            wake.notify_one();
+        }
+
+        void stop() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (stopping) return;
+                stopping = true;
+            }
+            wake.notify_one();
+            thread.join();
+        }
+
+        std::atomic<size_t> roomCount{0};
+        std::atomic<size_t> sessionCount{0};
+        std::atomic<uint64_t> framesIn{0};
+        std::atomic<uint64_t> opsApplied{0};
+        std::atomic<uint64_t> framesOut{0};
+        std::atomic<uint64_t> coalesced{0};
+        std::atomic<uint64_t> resyncs{0};
+        std::atomic<uint64_t> cursorsIn{0};
+        std::atomic<uint64_t> presenceTicks{0};
+
+    private:
+        // Ops first: presence ticks run between batches, never ahead of
+        // events already waiting
+        void run() {
+            std::vector<Event> batch;
+            auto period = std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(1.0 / options.presenceMaxHz));
+            Clock::time_point nextTick = Clock::now() + period;
+            for (;;) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    wake.wait_until(lock, nextTick, [this] { return !inbox.empty() || stopping; });
+                    if (stopping && inbox.empty()) return;  // everything queued is done
+                    batch.swap(inbox);
+                }
+                for (Event& event : batch) handle(event);
+                size_t load = batch.size();
+                batch.clear();
+
+                Clock::time_point now = Clock::now();
+                if (now >= nextTick) {
+                    snapshotCursors(now, load);
+                    nextTick = now + period;
+                }
+            }
+        }
+
+        // Sends each room whose cursors or members changed one Presence
+        // frame, at most at the room's own rate
+        void snapshotCursors(Clock::time_point now, size_t load) {
+            for (auto& entry : rooms) {
+                Room& room = *entry.second;
+                if (room.members.empty() || now < room.nextSnapshot) continue;
+                bool changed = room.membersChanged;
+                for (Member& member : room.members) {
+                    uint32_t version = member.session->cursorVersion.load(std::memory_order_acquire);
+                    changed |= version != member.cursorSeen;
+                    member.cursorSeen = version;
+                }
+                if (!changed) continue;
+
+                cursors.clear();
+                for (const Member& member : room.members) {
+                    if (member.cursorSeen == 0) continue;
+                    uint64_t bits = member.session->cursorBits.load(std::memory_order_relaxed);
+                    RoomProtocol::CursorPosition cursor;
+                    cursor.user = member.session->cursorUser.load(std::memory_order_relaxed);
+                    uint32_t x = uint32_t(bits), y = uint32_t(bits >> 32);
+                    std::memcpy(&cursor.x, &x, sizeof(float));
+                    std::memcpy(&cursor.y, &y, sizeof(float));
+                    cursors.push_back(cursor);
+                }
+                room.membersChanged = false;
+                if (cursors.empty() && room.cursorsShown == 0) continue;  // nobody has a cursor yet
+                room.cursorsShown = cursors.size();
+                RoomProtocol::SharedFrame frame = RoomProtocol::share(RoomProtocol::presence(cursors));
+                for (const Member& member : room.members) send(*member.session, frame);
+                presenceTicks++;
+                double hz = Presence::tickHz(room.members.size(), load, options);
+                room.nextSnapshot = now + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / hz));
+            }
+        }
+
+        void handle(Event& event) {
+            Session& session = *event.session;
+            switch (event.kind) {
+                case Event::Join: {
+                    std::unique_ptr<Room>& room = rooms[event.room];
+                    if (!room) {
+                        room = std::make_unique<Room>();
+                        roomCount++;
+                    }
+                    leave(session);
+                    room->members.push_back({event.session});
+                    room->membersChanged = true;
+                    memberOf[session.id] = room.get();
+                    sessionCount++;
+                    send(session, welcome(*room));
+                    break;
+                }
+                case Event::Leave:
+                    leave(session);
+                    break;
+                case Event::Frame:
+                    framesIn++;
+                    relay(event);
+                    break;
+                case Event::Fail:
+                    send(session, RoomProtocol::share(RoomProtocol::error(event.error)));
+                    break;
+            }
+        }
+
+        void leave(Session& session) {
+            auto it = memberOf.find(session.id);
+            if (it == memberOf.end()) return;
+            std::vector<Member>& members = it->second->members;
+            auto member = std::find_if(members.begin(), members.end(),
+                                       [&session](const Member& m) { return m.session.get() == &session; });
+            if (member != members.end()) {
+                *member = std::move(members.back());
+                members.pop_back();
+            }
+            it->second->membersChanged = true;
+            memberOf.erase(it);
+            sessionCount--;
+        }
+
+        void send(Session& session, const RoomProtocol::SharedFrame& frame) {
+            framesOut++;
+            switch (session.outbox.push(frame)) {
+                case SendQueue::Queued:
+                    break;
+                case SendQueue::Woke:
+                    session.peer->ready();
+                    break;
+                case SendQueue::Coalesced:
+                    coalesced++;
+                    break;
+                case SendQueue::Overflow:
+                    resync(session, frame);
+                    break;
+            }
+        }
+
+        // A consumer too far behind gets its room's state instead of the
+        // backlog. The transport still has a drain pending, since the queue
+        // was not empty.
+        void resync(Session& session, const RoomProtocol::SharedFrame& frame) {
+            auto it = memberOf.find(session.id);
+            session.outbox.replace(it != memberOf.end() ? welcome(*it->second) : frame);
+            resyncs++;
+        }
+
+        const RoomProtocol::SharedFrame& welcome(Room& room) {
+            if (!room.welcome) {
+                std::vector<uint8_t> state = room.document.encodeState();
+                room.welcome = RoomProtocol::share(RoomProtocol::frame(RoomProtocol::Welcome, state.data(), state.size()));
+            }
+            return room.welcome;
+        }
+
+        // Applies the ops that decode and relays exactly those bytes to the
+        // rest of the room, encoded once and shared by every member's queue
+        void relay(const Event& event) {
+            Session& sender = *event.session;
+            auto it = memberOf.find(sender.id);
+            if (it == memberOf.end()) {
+                send(sender, RoomProtocol::share(RoomProtocol::error(RoomProtocol::NotJoined)));
+                return;
+            }
+            Room& room = *it->second;
+
+            const uint8_t* body = event.data.data() + 1;
+            size_t size = event.data.size() - 1;
+            size_t valid = 0;
+            CrdtOp op;
+            // Ops the document rejects are relayed anyway: every replica
+            // skips them the same way, and stopping at one would make the
+            // rest of the packet land differently depending on order
+            while (valid < size) {
+                size_t used = CrdtCodec::decode(body + valid, size - valid, op);
+                if (used == 0) break;
+                if (room.document.apply(op)) opsApplied++;
+                valid += used;
+            }
+
+            if (valid > 0) {
+                room.welcome.reset();
+                RoomProtocol::SharedFrame frame = RoomProtocol::share(RoomProtocol::frame(RoomProtocol::Broadcast, body, valid));
+                for (const Member& member : room.members) {
+                    if (member.session.get() != &sender) send(*member.session, frame);
+                }
+            }
+            if (valid < size) send(sender, RoomProtocol::share(RoomProtocol::error(RoomProtocol::Malformed)));
+        }
+
+        const ServerOptions options;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::vector<Event> inbox;
+        bool stopping = false;
+
+        std::unordered_map<std::string, std::unique_ptr<Room>> rooms;
+        std::unordered_map<uint64_t, Room*> memberOf;  // session id -> its room here
+        std::vector<RoomProtocol::CursorPosition> cursors;  // snapshot scratch
+        std::thread thread;  // last: starts once everything above exists
+};
+
+RoomServer::RoomServer(const ServerOptions& options) : options(options) {
+    unsigned count = options.shards ? options.shards : std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < count; i++) shards.push_back(std::make_unique<Shard>(options));
+}
+
+RoomServer::~RoomServer() {
+    stop();
+}
+
+std::shared_ptr<Session> RoomServer::open(std::shared_ptr<Peer> peer) {
+    auto session = std::make_shared<Session>(options.sendQueueFrames, options.sendQueueBytes);
+    session->id = nextSession++;
+    session->peer = std::move(peer);
+    return session;
+}
+
+void RoomServer::receive(const std::shared_ptr<Session>& session, const uint8_t* data, size_t size) {
+    // Sessions outside a room get their errors from a shard picked by id
+    auto fail = [&](RoomProtocol::ErrorCode code) {
+        unsigned shard = session->shard >= 0 ? unsigned(session->shard) : unsigned(session->id % shards.size());
+        Event event(Event::Fail, session);
+        event.error = code;
+        shards[shard]->post(std::move(event));
+    };
+
+    if (size > options.maxFrameBytes) return fail(RoomProtocol::TooLarge);
+    if (size == 0) return fail(RoomProtocol::Malformed);
+    switch (data[0]) {
+        case RoomProtocol::Join: {
+            Event event(Event::Join, session);
+            if (!RoomProtocol::parseJoin(data, size, event.room)) return fail(RoomProtocol::Malformed);
+            unsigned target = shardFor(event.room);
+            // A cursor belongs to the room it was moved in: the old room
+            // drops it with the member, and the new one waits for a move
+            session->cursorVersion.store(0, std::memory_order_release);
+            if (session->shard >= 0 && unsigned(session->shard) != target) {
+                shards[session->shard]->post(Event{Event::Leave, session});
+            }
+            session->shard = static_cast<int>(target);
+            shards[target]->post(std::move(event));
+            break;
+        }
+        case RoomProtocol::Leave:
+            if (session->shard < 0) return fail(RoomProtocol::NotJoined);
+            shards[session->shard]->post(Event{Event::Leave, session});
+            session->shard = -1;
+            break;
+        case RoomProtocol::Cursor: {
+            // Stored in place, not queued: the shard picks up the latest at
+            // its next presence tick
+            RoomProtocol::CursorPosition cursor;
+            if (!RoomProtocol::parseCursor(data, size, cursor)) return fail(RoomProtocol::Malformed);
+            if (session->shard < 0) return fail(RoomProtocol::NotJoined);
+            uint32_t x, y;
+            std::memcpy(&x, &cursor.x, sizeof(float));
+            std::memcpy(&y, &cursor.y, sizeof(float));
+            session->cursorUser.store(cursor.user, std::memory_order_relaxed);
+            session->cursorBits.store(uint64_t(x) | uint64_t(y) << 32, std::memory_order_relaxed);
+            session->cursorVersion.fetch_add(1, std::memory_order_release);
+            shards[session->shard]->cursorsIn++;
+            break;
+        }
+        case RoomProtocol::Ops: {
+            if (session->shard < 0) return fail(RoomProtocol::NotJoined);
+            Event event(Event::Frame, session);
+            event.data.assign(data, data + size);
+            shards[session->shard]->post(std::move(event));
+            break;
+        }
+        default:
+            fail(RoomProtocol::Malformed);
+    }
+}
+
+void RoomServer::close(const std::shared_ptr<Session>& session) {
+    if (session->shard < 0) return;
+    shards[session->shard]->post(Event{Event::Leave, session});
+    session->shard = -1;
+}
+
+void RoomServer::stop() {
+    for (auto& shard : shards) shard->stop();
+}
+
+unsigned RoomServer::shardFor(const std::string& room) const {
+    return static_cast<unsigned>(std::hash<std::string>()(room) % shards.size());
+}
+
+ServerStats RoomServer::stats() const {
+    ServerStats total;
+    for (const auto& shard : shards) {
+        total.rooms += shard->roomCount;
+        total.sessions += shard->sessionCount;
+        total.framesIn += shard->framesIn;
+        total.opsApplied += shard->opsApplied;
+        total.framesOut += shard->framesOut;
+        total.coalesced += shard->coalesced;
+        total.resyncs += shard->resyncs;
+        total.cursorsIn += shard->cursorsIn;
+        total.presenceTicks += shard->presenceTicks;
+    }
+    return total;
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include "RoomProtocol.hpp"
+#include "SendQueue.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Outbound half of one client connection, implemented by a transport
+// (WebSocket adapter, LoopbackClient). ready() says the session's outbox
+// went from empty to non-empty; the transport then drains it on its own
+// thread and keeps draining, e.g. on socket writability, until it comes up
+// empty. ready() is called from worker threads, normally the one owning
+// the connection's room, but two can overlap while a connection switches
+// rooms, so it must be thread-safe (a WebSocket adapter defers the drain to
+// its socket's event loop).
+class Peer {
+    public:
+        virtual ~Peer() = default;
+        virtual void ready() = 0;
+};
+
+// One client connection as the server sees it. The transport keeps the
+// handle from RoomServer::open() (e.g. in its per-socket user data), passes
+// it back with every frame and writes out what it drains from outbox.
+struct Session {
+    Session(size_t queueFrames, size_t queueBytes) : outbox(queueFrames, queueBytes) {}
+
+    uint64_t id = 0;
+    std::shared_ptr<Peer> peer;
+    SendQueue outbox;
+    // Written by the connection's receiving thread only; rooms are tracked
+    // by the shard that owns them
+    int shard = -1;
+    // Latest cursor, a lossy register: receive() overwrites it on the
+    // receiving thread and the room's presence tick reads it
+    std::atomic<uint32_t> cursorUser{0};
+    std::atomic<uint64_t> cursorBits{0};     // x, y as float bits
+    std::atomic<uint32_t> cursorVersion{0};  // 0 until the first Cursor since Join
+};
+
+struct ServerOptions {
+    unsigned shards = 0;                  // worker threads; 0: one per core
+    size_t maxFrameBytes = 1 << 20;
+    size_t sendQueueFrames = 64;          // per connection, before ops are coalesced
+    size_t sendQueueBytes = 4 << 20;      // per connection, before a resync
+    // Presence snapshots per room and second, see Presence::tickHz
+    double presenceMaxHz = 30.0;
+    double presenceMinHz = 4.0;
+    double presenceBudget = 200000.0;     // cursors delivered per room and second
+};
+
+namespace Presence {
+
+    // Snapshot rate for a room. One tick sends every member's cursor to
+    // every member, so the cost grows with members^2 and the rate falls to
+    // keep it near the budget; backlog (events waiting on the shard) slows
+    // it further so presence yields to ops under load.
+    inline double tickHz(size_t members, size_t backlog, const ServerOptions& options) {
+        double n = double(std::max<size_t>(members, 1));
+        double hz = options.presenceBudget / (n * n) / (1.0 + double(backlog) / 64.0);
+        return std::min(options.presenceMaxHz, std::max(options.presenceMinHz, hz));
+    }
+
+} // namespace Presence
+
+struct ServerStats {
+    size_t rooms = 0;
+    size_t sessions = 0;       // joined
+    uint64_t framesIn = 0;
+    uint64_t opsApplied = 0;
+    uint64_t framesOut = 0;       // frames pushed to connection queues
+    uint64_t coalesced = 0;       // Broadcasts merged into a slow consumer's queue
+    uint64_t resyncs = 0;         // backlogs replaced by a Welcome
+    uint64_t cursorsIn = 0;
+    uint64_t presenceTicks = 0;   // snapshots sent, one shared frame per room each
+};
+
+class Shard;
+
+// Native multi-room server: every room hosts a CrdtDocument over its own
+// DrawingEngine and relays each member's ops to the others.
+//
+// Rooms are sharded by name over a fixed pool of workers. Each worker owns
+// its rooms outright and runs an event loop over its own inbox, so rooms on
+// different workers never share a lock and a room's state is only touched
+// by one thread. receive() reads just enough of a frame on the caller's
+// (transport) thread to route it. A Join picks the shard from the room name,
+// and later frames follow the session to that shard. A relayed op packet is
+// framed once and the same buffer is pushed to every member's outbox.
+//
+// Cursors take a separate, lossy path so they never delay ops: receive()
+// stores them in the session without touching the shard's inbox, and each
+// shard sends one Presence snapshot per room per tick, after the ops it has
+// queued.
+//
+// The transport calls open() per connection, receive() per frame and
+// close() on disconnect. Calls for one session must not overlap; different
+// sessions may call in from any number of threads.
+class RoomServer {
+    public:
+        explicit RoomServer(const ServerOptions& options = ServerOptions());
+        ~RoomServer();  // stops the workers
+        RoomServer(const RoomServer&) = delete;
+        RoomServer& operator=(const RoomServer&) = delete;
+
+        std::shared_ptr<Session> open(std::shared_ptr<Peer> peer);
+        void receive(const std::shared_ptr<Session>& session, const uint8_t* data, size_t size);
+        void close(const std::shared_ptr<Session>& session);
+
+        // Finishes every frame queued so far, then stops the workers
+        void stop();
+
+        unsigned shardCount() const { return static_cast<unsigned>(shards.size()); }
+        unsigned shardFor(const std::string& room) const;
+        ServerStats stats() const;  // sums the shards' counters; approximate while running
+
+    private:
+        ServerOptions options;
+        std::vector<std::unique_ptr<Shard>> shards;
+        std::atomic<uint64_t> nextSession{1};
+};
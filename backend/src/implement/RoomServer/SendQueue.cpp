@@ -0,0 +1,71 @@
+#include "SendQueue.hpp"
+
+namespace {
+
+size_t counted(const std::vector<uint8_t>& frame) {
+    return !frame.empty() && frame[0] == RoomProtocol::Welcome ? 0 : frame.size();
+}
+
+} // namespace
+
+SendQueue::Result SendQueue::push(const RoomProtocol::SharedFrame& frame) {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t size = counted(*frame);
+    bool snapshot = !frame->empty() && (*frame)[0] == RoomProtocol::Presence;
+    if (snapshot && presence) {
+        queuedBytes = queuedBytes - (*presence)->size() + size;
+        *presence = frame;
+        return Coalesced;
+    }
+    if (!frames.empty() && queuedBytes + merged.size() + size > maxBytes) return Overflow;
+
+    bool broadcast = frame->size() > 1 && (*frame)[0] == RoomProtocol::Broadcast;
+    if (broadcast && (!merged.empty() || frames.size() >= maxFrames)) {
+        if (merged.empty()) merged.push_back(RoomProtocol::Broadcast);
+        merged.insert(merged.end(), frame->begin() + 1, frame->end());
+        return Coalesced;
+    }
+    // Other frames keep their place behind the ops merged so far
+    seal();
+    frames.push_back(frame);
+    queuedBytes += size;
+    if (snapshot) presence = &frames.back();
+    return frames.size() == 1 ? Woke : Queued;
+}
+
+void SendQueue::replace(const RoomProtocol::SharedFrame& frame) {
+    std::lock_guard<std::mutex> lock(mutex);
+    frames.clear();
+    merged.clear();
+    presence = nullptr;
+    frames.push_back(frame);
+    queuedBytes = counted(*frame);
+}
+
+size_t SendQueue::drain(std::vector<RoomProtocol::SharedFrame>& out) {
+    std::lock_guard<std::mutex> lock(mutex);
+    seal();
+    size_t count = frames.size();
+    for (RoomProtocol::SharedFrame& frame : frames) out.push_back(std::move(frame));
+    frames.clear();
+    queuedBytes = 0;
+    presence = nullptr;
+    return count;
+}
+
+size_t SendQueue::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return frames.size() + (merged.empty() ? 0 : 1);
+}
+
+size_t SendQueue::bytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return queuedBytes + merged.size();
+}
+
+void SendQueue::seal() {
+    if (merged.empty()) return;
+    queuedBytes += merged.size();
+    frames.push_back(RoomProtocol::share(std::move(merged)));
+    merged.clear();
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "RoomProtocol.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+// Outbound frames of one connection, waiting for its transport to write
+// them. Entries are shared, immutable frames, so a broadcast to a room of N
+// costs one encode and N pointer pushes.
+//
+// The queue is bounded for slow consumers. Once maxFrames are waiting,
+// further Broadcasts are coalesced: their op bodies are appended to one
+// merged Broadcast at the tail, which is valid because CRDT op packets
+// concatenate. Only that connection pays for the copy. Past maxBytes the
+// push fails with Overflow (an empty queue takes any frame), and the caller
+// replaces the backlog with a fresh Welcome via replace(). Welcome frames
+// are not counted towards maxBytes; otherwise a room whose state is larger
+// than the budget would resync on every op.
+//
+// Presence snapshots are lossy: a new one replaces a snapshot still waiting
+// in the queue, so a backed-up connection holds at most one.
+//
+// push() and replace() come from worker threads, drain() from the
+// transport; all are thread-safe.
+class SendQueue {
+    public:
+        enum Result : uint8_t {
+            Queued,     // behind other frames
+            Woke,       // the queue was empty: the transport must be told
+            Coalesced,  // merged into the tail Broadcast, or replaced a Presence
+            Overflow    // over maxBytes; nothing queued
+        };
+
+        // maxFrames 0 is taken as 1: the queue must be able to hold a frame
+        // to wake its transport at all
+        SendQueue(size_t maxFrames, size_t maxBytes) : maxFrames(std::max<size_t>(maxFrames, 1)), maxBytes(maxBytes) {}
+
+        Result push(const RoomProtocol::SharedFrame& frame);
+        // Drops everything queued and queues frame alone
+        void replace(const RoomProtocol::SharedFrame& frame);
+        // Appends everything queued to out, in order; returns how many
+        size_t drain(std::vector<RoomProtocol::SharedFrame>& out);
+
+        size_t size() const;   // frames, counting a pending merged Broadcast as one
+        size_t bytes() const;  // counted towards maxBytes
+
+    private:
+        void seal();
+
+        const size_t maxFrames;
+        const size_t maxBytes;
+        mutable std::mutex mutex;
+        std::deque<RoomProtocol::SharedFrame> frames;
+        std::vector<uint8_t> merged;  // coalesced Broadcast being built; empty when not coalescing
+        size_t queuedBytes = 0;
+        RoomProtocol::SharedFrame* presence = nullptr;  // queued snapshot; deque elements stay put on push_back
+};
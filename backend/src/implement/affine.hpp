@@ -0,0 +1,91 @@
+#pragma once
+#include <cmath>
+#include "draw.hpp"
+
+// 2D affine transform, laid out like canvas setTransform(a, b, c, d, e, f):
+//
+//   x' = a * x + c * y + tx
+//   y' = b * x + d * y + ty
+struct Affine {
+    float a = 1.0f, b = 0.0f, c = 0.0f, d = 1.0f;
+    float tx = 0.0f, ty = 0.0f;
+
+    static Affine translation(float dx, float dy) {
+        Affine t;
+        t.tx = dx;
+        t.ty = dy;
+        return t;
+    }
+
+    // Scale by (sx, sy) about (cx, cy)
+    static Affine scaling(float sx, float sy, float cx = 0.0f, float cy = 0.0f) {
+        Affine t;
+        t.a = sx;
+        t.d = sy;
+        t.tx = cx - sx * cx;
+        t.ty = cy - sy * cy;
+        return t;
+    }
+
+    // Rotate counter-clockwise (y up) by radians about (cx, cy)
+    static Affine rotation(float radians, float cx = 0.0f, float cy = 0.0f) {
+        float cs = std::cos(radians), sn = std::sin(radians);
+        Affine t;
+        t.a = cs;
+        t.b = sn;
+        t.c = -sn;
+        t.d = cs;
+        t.tx = cx - cs * cx + sn * cy;
+        t.ty = cy - sn * cx - cs * cy;
+        return t;
+    }
+
+    bool isIdentity() const { return isTranslation() && tx == 0.0f && ty == 0.0f; }
+    bool isTranslation() const { return a == 1.0f && b == 0.0f && c == 0.0f && d == 1.0f; }
+    bool axisAligned() const { return b == 0.0f && c == 0.0f; }
+
+    Point apply(const Point& p) const { return Point(a * p.x + c * p.y + tx, b * p.x + d * p.y + ty); }
+
+    // This transform followed by next
+    Affine then(const Affine& next) const {
+        Affine t;
+        t.a = next.a * a + next.c * b;
+        t.b = next.b * a + next.d * b;
+        t.c = next.a * c + next.c * d;
+        t.d = next.b * c + next.d * d;
+        t.tx = next.a * tx + next.c * ty + next.tx;
+        t.ty = next.b * tx + next.d * ty + next.ty;
+        return t;
+    }
+
+    // Identity if the transform is singular
+    Affine inverse() const {
+        float det = a * d - b * c;
+        if (det == 0.0f || !std::isfinite(det)) return Affine();
+        Affine t;
+        t.a = d / det;
+        t.b = -b / det;
+        t.c = -c / det;
+        t.d = a / det;
+        t.tx = -(t.a * tx + t.c * ty);
+        t.ty = -(t.b * tx + t.d * ty);
+        return t;
+    }
+
+    // Largest factor a length can grow by (upper bound)
+    float maxScale() const {
+        return std::max(std::sqrt(a * a + b * b), std::sqrt(c * c + d * d));
+    }
+
+    // Box around the transformed corners of box
+    AABB applyBox(const AABB& box) const {
+        AABB out;
+        if (box.empty()) return out;
+        Point corners[4] = {
+            apply(Point(box.minX, box.minY)), apply(Point(box.maxX, box.minY)),
+            apply(Point(box.maxX, box.maxY)), apply(Point(box.minX, box.maxY))
+        };
+        for (const Point& p : corners) out.expand(p.x, p.y);
+        return out;
+    }
+};
@@ -2,13 +2,44 @@
 #include <vector>
 #include <cmath>
 #include <algorithm>
+#include <cstdint>
+#include <utility>
 #include "color.hpp"
+#include "rdp_kernel.hpp"
 
 struct Point {
     float x, y;
     Point(float x=0, float y=0) : x(x), y(y) {}
 };
 
+// Axis-aligned bounding box. Default-constructed boxes are empty.
+struct AABB {
+    float minX, minY, maxX, maxY;
+    AABB() : minX(INFINITY), minY(INFINITY), maxX(-INFINITY), maxY(-INFINITY) {}
+    AABB(float minX, float minY, float maxX, float maxY) : minX(minX), minY(minY), maxX(maxX), maxY(maxY) {}
+
+    bool empty() const { return minX > maxX || minY > maxY; }
+    void expand(float x, float y, float pad = 0.0f) {
+        minX = std::min(minX, x - pad);
+        minY = std::min(minY, y - pad);
+        maxX = std::max(maxX, x + pad);
+        maxY = std::max(maxY, y + pad);
+    }
+    void expand(const AABB& o) {
+        minX = std::min(minX, o.minX);
+        minY = std::min(minY, o.minY);
+        maxX = std::max(maxX, o.maxX);
+        maxY = std::max(maxY, o.maxY);
+    }
+    bool intersects(const AABB& o) const {
+        return !empty() && !o.empty() && minX <= o.maxX && o.minX <= maxX && minY <= o.maxY && o.minY <= maxY;
+    }
+    bool operator==(const AABB& o) const {
+        return minX == o.minX && minY == o.minY && maxX == o.maxX && maxY == o.maxY;
+    }
+    bool operator!=(const AABB& o) const { return !(*this == o); }
+};
+
 struct Stroke {
     std::vector<Point> points;
     Color color;
@@ -49,32 +80,75 @@ namespace RDP {
         return sqrt(dx * dx + dy * dy);
     }
 
+    // Marks the points RDP keeps (keep[i] = 1) for xs/ys[0..count).
+    // Iterative with an explicit stack, so a long stroke cannot overflow the
+    // small WASM stack, and nothing is copied per level. The farthest-point
+    // scan is vectorised (see rdp_kernel.hpp); distances are compared squared.
+    inline void markKept(const float* xs, const float* ys, size_t count, float epsilon, std::vector<uint8_t>& keep) {
+        keep.assign(count, 0);
+        if (count == 0) return;
+        keep[0] = 1;
+        keep[count - 1] = 1;
+
+        thread_local std::vector<std::pair<size_t, size_t>> stack;
+        stack.clear();
+        stack.emplace_back(0, count - 1);
+        float epsilonSq = epsilon > 0 ? epsilon * epsilon : 0.0f;
+
+        while (!stack.empty()) {
+            size_t first = stack.back().first;
+            size_t last = stack.back().second;
+            stack.pop_back();
+            if (last - first < 2) continue;
+
+            float maxDistanceSq;
+            size_t maxIndex = detail::farthestPoint(xs, ys, first, last, maxDistanceSq);
+            if (maxDistanceSq > epsilonSq) {
+                keep[maxIndex] = 1;
+                stack.emplace_back(maxIndex, last);
+                stack.emplace_back(first, maxIndex);
+            }
+        }
+    }
+
+    // Simplifies xs/ys[0..count) in place; returns the new point count.
+    // Allocation-free once the thread's scratch buffers have warmed up.
+    inline size_t simplifyInPlace(float* xs, float* ys, size_t count, float epsilon) {
+        if (count <= 2) return count;
+
+        thread_local std::vector<uint8_t> keep;
+        markKept(xs, ys, count, epsilon, keep);
+
+        size_t write = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (keep[i]) {
+                xs[write] = xs[i];
+                ys[write] = ys[i];
+                write++;
+            }
+        }
+        return write;
+    }
+
     inline std::vector<Point> simplify(const std::vector<Point>& points, float epsilon) {
         if (points.size() <= 2) return points;
-        
-        float maxDistance = 0;
-        size_t maxIndex = 0;
-        
-        for (size_t i = 1; i < points.size() - 1; i++) {
-            float distance = pointToLineDistance(points[i], points[0], points[points.size() - 1]);
-            if (distance > maxDistance) {
-                maxDistance = distance;
-                maxIndex = i;
-            }
+
+        // The kernel wants structure-of-arrays input
+        thread_local std::vector<float> xs, ys;
+        thread_local std::vector<uint8_t> keep;
+        xs.resize(points.size());
+        ys.resize(points.size());
+        for (size_t i = 0; i < points.size(); i++) {
+            xs[i] = points[i].x;
+            ys[i] = points[i].y;
         }
-        
-        if (maxDistance > epsilon) {
-            std::vector<Point> firstHalf(points.begin(), points.begin() + maxIndex + 1);
-            std::vector<Point> secondHalf(points.begin() + maxIndex, points.end());
-            
-            auto firstResult = simplify(firstHalf, epsilon);
-            auto secondResult = simplify(secondHalf, epsilon);
-            
-            firstResult.pop_back();
-            firstResult.insert(firstResult.end(), secondResult.begin(), secondResult.end());
-            return firstResult;
-        } else {
-            return {points[0], points[points.size() - 1]};
+        markKept(xs.data(), ys.data(), points.size(), epsilon, keep);
+
+        std::vector<Point> result;
+        result.reserve(std::count(keep.begin(), keep.end(), uint8_t(1)));
+        for (size_t i = 0; i < points.size(); i++) {
+            if (keep[i]) result.push_back(points[i]);
         }
+        return result;
     }
 }
\ No newline at end of file
@@ -0,0 +1,48 @@
+#ifndef ELLIPSE_SHAPE_HPP
+#define ELLIPSE_SHAPE_HPP
+
+#include "shape.hpp"
+#include "draw.hpp"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+struct EllipseShape : public Shape {
+    Point center;
+    float radiusX;
+    float radiusY;
+    
+    static constexpr int MinSegments = 8;
+    static constexpr int MaxSegments = 1024;
+    
+    EllipseShape(const Point& center, float radiusX, float radiusY, const Color& color, float thickness)
+        : Shape(ShapeType::Ellipse, color, thickness), center(center),
+          radiusX(std::fabs(radiusX)), radiusY(std::fabs(radiusY)) {}
+    
+    std::unique_ptr<Shape> clone() const override {
+        return std::make_unique<EllipseShape>(*this);
+    }
+    
+    // Segments that keep the outline polygon within tolerance of a curve of
+    // this radius: a chord over an arc of 2pi/n sags r * (1 - cos(pi/n))
+    static int segmentsFor(float radius, float tolerance) {
+        if (!(tolerance > 0.0f) || !(radius > tolerance)) return MinSegments;
+        float n = std::ceil(3.14159265f / std::acos(1.0f - tolerance / radius));
+        return static_cast<int>(std::min(std::max(n, float(MinSegments)), float(MaxSegments)));
+    }
+    
+    // Appends segments + 1 points around the ellipse; the last repeats the first
+    void appendOutline(int segments, std::vector<Point>& out) const {
+        float step = 2.0f * 3.14159265f / segments;
+        for (int i = 0; i < segments; i++) {
+            out.emplace_back(center.x + radiusX * std::cos(i * step), center.y + radiusY * std::sin(i * step));
+        }
+        out.push_back(out[out.size() - segments]);
+    }
+    
+    AABB getBounds() const {
+        return AABB(center.x - radiusX, center.y - radiusY, center.x + radiusX, center.y + radiusY);
+    }
+};
+
+#endif
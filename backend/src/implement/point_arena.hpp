@@ -0,0 +1,188 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "draw.hpp"
+
+// A stroke's span inside a PointArena
+struct PointRange {
+    uint32_t offset = 0;
+    uint32_t length = 0;
+    uint32_t capacity = 0;
+};
+
+// Contiguous structure-of-arrays point storage shared by every stroke in a
+// DrawingEngine. Strokes own a PointRange into x[]/y[] instead of their own
+// vector, so inking does not allocate per stroke and iteration stays linear.
+//
+// Ranges grow by doubling: in place when they sit at the end of the arena,
+// otherwise by moving to the end and leaving the old span behind as garbage.
+// Released and abandoned spans are reclaimed by compact(), which callers run
+// once wantsCompaction() says garbage outweighs live points.
+class PointArena {
+    public:
+        PointRange allocate(uint32_t capacity) {
+            PointRange range;
+            range.offset = static_cast<uint32_t>(xs.size());
+            range.capacity = capacity;
+            xs.resize(xs.size() + capacity);
+            ys.resize(ys.size() + capacity);
+            return range;
+        }
+
+        PointRange store(const std::vector<Point>& points) {
+            PointRange range = allocate(static_cast<uint32_t>(points.size()));
+            for (size_t i = 0; i < points.size(); i++) {
+                xs[range.offset + i] = points[i].x;
+                ys[range.offset + i] = points[i].y;
+            }
+            range.length = range.capacity;
+            liveLength += range.length;
+            return range;
+        }
+
+        // A full range of count points for the caller to fill through xData/yData
+        PointRange allocateLive(uint32_t count) {
+            PointRange range = allocate(count);
+            range.length = count;
+            liveLength += count;
+            return range;
+        }
+
+        void reserve(size_t points) {
+            xs.reserve(points);
+            ys.reserve(points);
+        }
+
+        void append(PointRange& range, const Point& pt) {
+            if (range.length == range.capacity) grow(range);
+            xs[range.offset + range.length] = pt.x;
+            ys[range.offset + range.length] = pt.y;
+            range.length++;
+            liveLength++;
+        }
+
+        void set(const PointRange& range, size_t i, const Point& pt) {
+            xs[range.offset + i] = pt.x;
+            ys[range.offset + i] = pt.y;
+        }
+
+        // Replaces the contents of range, reusing its span when it fits
+        void assign(PointRange& range, const std::vector<Point>& points) {
+            if (points.size() > range.capacity) {
+                release(range);
+                range = store(points);
+                return;
+            }
+            for (size_t i = 0; i < points.size(); i++) {
+                xs[range.offset + i] = points[i].x;
+                ys[range.offset + i] = points[i].y;
+            }
+            liveLength -= range.length;
+            range.length = static_cast<uint32_t>(points.size());
+            liveLength += range.length;
+        }
+
+        // Drops points from `length` on; the span keeps its capacity
+        void truncate(PointRange& range, uint32_t length) {
+            if (length >= range.length) return;
+            liveLength -= range.length - length;
+            range.length = length;
+        }
+
+        // RDP-simplifies range where it sits; the span keeps its capacity
+        void simplify(PointRange& range, float epsilon) {
+            size_t kept = RDP::simplifyInPlace(xs.data() + range.offset, ys.data() + range.offset, range.length, epsilon);
+            liveLength -= range.length - kept;
+            range.length = static_cast<uint32_t>(kept);
+        }
+
+        void release(PointRange& range) {
+            garbage += range.capacity;
+            liveLength -= range.length;
+            range = PointRange();
+        }
+
+        void translate(const PointRange& range, float dx, float dy) {
+            float* x = xs.data() + range.offset;
+            float* y = ys.data() + range.offset;
+            for (uint32_t i = 0; i < range.length; i++) {
+                x[i] += dx;
+                y[i] += dy;
+            }
+        }
+
+        Point get(const PointRange& range, size_t i) const {
+            return Point(xs[range.offset + i], ys[range.offset + i]);
+        }
+
+        std::vector<Point> copyOut(const PointRange& range) const {
+            std::vector<Point> points;
+            points.reserve(range.length);
+            for (uint32_t i = 0; i < range.length; i++) {
+                points.emplace_back(xs[range.offset + i], ys[range.offset + i]);
+            }
+            return points;
+        }
+
+        const float* xData(const PointRange& range) const { return xs.data() + range.offset; }
+        const float* yData(const PointRange& range) const { return ys.data() + range.offset; }
+        float* xData(const PointRange& range) { return xs.data() + range.offset; }
+        float* yData(const PointRange& range) { return ys.data() + range.offset; }
+
+        size_t livePoints() const { return liveLength; }
+        size_t storedPoints() const { return xs.size(); }
+
+        bool wantsCompaction() const {
+            return garbage > 1024 && garbage > liveLength;
+        }
+
+        // Rewrites the arena tightly. forEachRange(visit) must call visit(range)
+        // for every live range; ranges are packed in the order visited.
+        template<typename ForEachRange>
+        void compact(ForEachRange forEachRange) {
+            std::vector<float> newXs, newYs;
+            newXs.reserve(liveLength);
+            newYs.reserve(liveLength);
+            forEachRange([&](PointRange& range) {
+                uint32_t offset = static_cast<uint32_t>(newXs.size());
+                newXs.insert(newXs.end(), xs.begin() + range.offset, xs.begin() + range.offset + range.length);
+                newYs.insert(newYs.end(), ys.begin() + range.offset, ys.begin() + range.offset + range.length);
+                range.offset = offset;
+                range.capacity = range.length;
+            });
+            xs.swap(newXs);
+            ys.swap(newYs);
+            garbage = 0;
+        }
+
+        void clear() {
+            xs.clear();
+            ys.clear();
+            garbage = 0;
+            liveLength = 0;
+        }
+
+    private:
+        void grow(PointRange& range) {
+            uint32_t newCapacity = range.capacity < 8 ? 8 : range.capacity * 2;
+            if (range.offset + range.capacity == xs.size()) {
+                // Last range in the arena: extend in place
+                xs.resize(range.offset + newCapacity);
+                ys.resize(range.offset + newCapacity);
+                range.capacity = newCapacity;
+                return;
+            }
+            PointRange moved = allocate(newCapacity);
+            std::copy(xs.begin() + range.offset, xs.begin() + range.offset + range.length, xs.begin() + moved.offset);
+            std::copy(ys.begin() + range.offset, ys.begin() + range.offset + range.length, ys.begin() + moved.offset);
+            garbage += range.capacity;
+            moved.length = range.length;
+            range = moved;
+        }
+
+        std::vector<float> xs;
+        std::vector<float> ys;
+        size_t garbage = 0;     // points in released or abandoned spans
+        size_t liveLength = 0;  // points referenced by live ranges
+};
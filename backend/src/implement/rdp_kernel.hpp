@@ -0,0 +1,164 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Vectorised inner loop of RDP: the point farthest from a segment.
+// Picks wasm-simd128 in the Emscripten build (-msimd128), AVX2 or SSE2 on
+// native x86, and a scalar loop everywhere else. Every path picks the first
+// point at the maximum distance, like the scalar loop does.
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace RDP {
+namespace detail {
+
+    // Squared distances from points to segment start + t * (c, d), t clamped
+    // to [0, 1]. invLenSq is 0 for a degenerate segment, which pins t to 0.
+    struct Segment {
+        float sx, sy, c, d, invLenSq;
+
+        Segment(float x0, float y0, float x1, float y1) : sx(x0), sy(y0), c(x1 - x0), d(y1 - y0) {
+            float lenSq = c * c + d * d;
+            invLenSq = lenSq > 0.0f ? 1.0f / lenSq : 0.0f;
+        }
+
+        float distanceSq(float px, float py) const {
+            float a = px - sx;
+            float b = py - sy;
+            float t = (a * c + b * d) * invLenSq;
+            t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+            float dx = a - t * c;
+            float dy = b - t * d;
+            return dx * dx + dy * dy;
+        }
+    };
+
+    // Farthest of xs/ys[first+1 .. last-1] from the segment first -> last.
+    // Writes its squared distance to maxDistSq (-1 if there are no points).
+    inline size_t farthestPoint(const float* xs, const float* ys, size_t first, size_t last, float& maxDistSq) {
+        Segment seg(xs[first], ys[first], xs[last], ys[last]);
+        float best = -1.0f;
+        size_t bestIndex = first;
+        size_t i = first + 1;
+
+#if defined(__wasm_simd128__)
+        v128_t sx = wasm_f32x4_splat(seg.sx), sy = wasm_f32x4_splat(seg.sy);
+        v128_t c = wasm_f32x4_splat(seg.c), d = wasm_f32x4_splat(seg.d);
+        v128_t inv = wasm_f32x4_splat(seg.invLenSq);
+        v128_t zero = wasm_f32x4_splat(0.0f), one = wasm_f32x4_splat(1.0f);
+        v128_t bestV = wasm_f32x4_splat(-1.0f);
+        v128_t bestI = wasm_i32x4_splat(0);
+        v128_t idx = wasm_i32x4_make(int32_t(i), int32_t(i + 1), int32_t(i + 2), int32_t(i + 3));
+        v128_t step = wasm_i32x4_splat(4);
+        for (; i + 4 <= last; i += 4) {
+            v128_t a = wasm_f32x4_sub(wasm_v128_load(xs + i), sx);
+            v128_t b = wasm_f32x4_sub(wasm_v128_load(ys + i), sy);
+            v128_t t = wasm_f32x4_mul(wasm_f32x4_add(wasm_f32x4_mul(a, c), wasm_f32x4_mul(b, d)), inv);
+            t = wasm_f32x4_pmin(wasm_f32x4_pmax(t, zero), one);
+            v128_t dx = wasm_f32x4_sub(a, wasm_f32x4_mul(t, c));
+            v128_t dy = wasm_f32x4_sub(b, wasm_f32x4_mul(t, d));
+            v128_t dist = wasm_f32x4_add(wasm_f32x4_mul(dx, dx), wasm_f32x4_mul(dy, dy));
+            v128_t better = wasm_f32x4_gt(dist, bestV);
+            bestV = wasm_v128_bitselect(dist, bestV, better);
+            bestI = wasm_v128_bitselect(idx, bestI, better);
+            idx = wasm_i32x4_add(idx, step);
+        }
+        float lanes[4];
+        int32_t lanesI[4];
+        wasm_v128_store(lanes, bestV);
+        wasm_v128_store(lanesI, bestI);
+        for (int k = 0; k < 4; k++) {
+            if (lanes[k] < 0.0f) continue;  // lane never saw a point
+            if (lanes[k] > best || (lanes[k] == best && size_t(lanesI[k]) < bestIndex)) {
+                best = lanes[k];
+                bestIndex = size_t(lanesI[k]);
+            }
+        }
+#elif defined(__AVX2__)
+        __m256 sx = _mm256_set1_ps(seg.sx), sy = _mm256_set1_ps(seg.sy);
+        __m256 c = _mm256_set1_ps(seg.c), d = _mm256_set1_ps(seg.d);
+        __m256 inv = _mm256_set1_ps(seg.invLenSq);
+        __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+        __m256 bestV = _mm256_set1_ps(-1.0f);
+        __m256i bestI = _mm256_setzero_si256();
+        __m256i idx = _mm256_add_epi32(_mm256_set1_epi32(int32_t(i)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        __m256i step = _mm256_set1_epi32(8);
+        for (; i + 8 <= last; i += 8) {
+            __m256 a = _mm256_sub_ps(_mm256_loadu_ps(xs + i), sx);
+            __m256 b = _mm256_sub_ps(_mm256_loadu_ps(ys + i), sy);
+            __m256 t = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(a, c), _mm256_mul_ps(b, d)), inv);
+            t = _mm256_min_ps(_mm256_max_ps(t, zero), one);
+            __m256 dx = _mm256_sub_ps(a, _mm256_mul_ps(t, c));
+            __m256 dy = _mm256_sub_ps(b, _mm256_mul_ps(t, d));
+            __m256 dist = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+            __m256 better = _mm256_cmp_ps(dist, bestV, _CMP_GT_OQ);
+            bestV = _mm256_blendv_ps(bestV, dist, better);
+            bestI = _mm256_blendv_epi8(bestI, idx, _mm256_castps_si256(better));
+            idx = _mm256_add_epi32(idx, step);
+        }
+        alignas(32) float lanes[8];
+        alignas(32) int32_t lanesI[8];
+        _mm256_store_ps(lanes, bestV);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanesI), bestI);
+        for (int k = 0; k < 8; k++) {
+            if (lanes[k] < 0.0f) continue;  // lane never saw a point
+            if (lanes[k] > best || (lanes[k] == best && size_t(lanesI[k]) < bestIndex)) {
+                best = lanes[k];
+                bestIndex = size_t(lanesI[k]);
+            }
+        }
+#elif defined(__SSE2__)
+        __m128 sx = _mm_set1_ps(seg.sx), sy = _mm_set1_ps(seg.sy);
+        __m128 c = _mm_set1_ps(seg.c), d = _mm_set1_ps(seg.d);
+        __m128 inv = _mm_set1_ps(seg.invLenSq);
+        __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+        __m128 bestV = _mm_set1_ps(-1.0f);
+        __m128i bestI = _mm_setzero_si128();
+        __m128i idx = _mm_setr_epi32(int32_t(i), int32_t(i + 1), int32_t(i + 2), int32_t(i + 3));
+        __m128i step = _mm_set1_epi32(4);
+        for (; i + 4 <= last; i += 4) {
+            __m128 a = _mm_sub_ps(_mm_loadu_ps(xs + i), sx);
+            __m128 b = _mm_sub_ps(_mm_loadu_ps(ys + i), sy);
+            __m128 t = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(a, c), _mm_mul_ps(b, d)), inv);
+            t = _mm_min_ps(_mm_max_ps(t, zero), one);
+            __m128 dx = _mm_sub_ps(a, _mm_mul_ps(t, c));
+            __m128 dy = _mm_sub_ps(b, _mm_mul_ps(t, d));
+            __m128 dist = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+            __m128 better = _mm_cmpgt_ps(dist, bestV);
+            bestV = _mm_or_ps(_mm_and_ps(better, dist), _mm_andnot_ps(better, bestV));
+            __m128i betterI = _mm_castps_si128(better);
+            bestI = _mm_or_si128(_mm_and_si128(betterI, idx), _mm_andnot_si128(betterI, bestI));
+            idx = _mm_add_epi32(idx, step);
+        }
+        alignas(16) float lanes[4];
+        alignas(16) int32_t lanesI[4];
+        _mm_store_ps(lanes, bestV);
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanesI), bestI);
+        for (int k = 0; k < 4; k++) {
+            if (lanes[k] < 0.0f) continue;  // lane never saw a point
+            if (lanes[k] > best || (lanes[k] == best && size_t(lanesI[k]) < bestIndex)) {
+                best = lanes[k];
+                bestIndex = size_t(lanesI[k]);
+            }
+        }
+#endif
+
+        // Scalar tail (or the whole range without SIMD)
+        for (; i < last; i++) {
+            float dist = seg.distanceSq(xs[i], ys[i]);
+            if (dist > best) {
+                best = dist;
+                bestIndex = i;
+            }
+        }
+        maxDistSq = best;
+        return bestIndex;
+    }
+
+} // namespace detail
+} // namespace RDP
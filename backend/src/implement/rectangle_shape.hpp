@@ -3,6 +3,7 @@
 
 #include "shape.hpp"
 #include "draw.hpp"
+#include <vector>
 
 struct RectangleShape : public Shape {
     Point topLeft;
@@ -21,6 +22,22 @@ struct RectangleShape : public Shape {
     Point getCenter() const { 
         return Point((topLeft.x + bottomRight.x) / 2, (topLeft.y + bottomRight.y) / 2); 
     }
+    
+    AABB getBounds() const {
+        AABB box;
+        box.expand(topLeft.x, topLeft.y);
+        box.expand(bottomRight.x, bottomRight.y);
+        return box;
+    }
+    
+    // Appends the four corners, going round, and the first again to close it
+    void appendOutline(std::vector<Point>& out) const {
+        out.push_back(topLeft);
+        out.emplace_back(bottomRight.x, topLeft.y);
+        out.push_back(bottomRight);
+        out.emplace_back(topLeft.x, bottomRight.y);
+        out.push_back(topLeft);
+    }
 };
 
 #endif
\ No newline at end of file
@@ -4,14 +4,26 @@
 #pragma once
 
 #include "color.hpp"
+#include "affine.hpp"
+#include <cstdint>
 #include <memory>
 
+// Stable shape identifier assigned by DrawingEngine. 0 means "not assigned".
+using ShapeId = uint64_t;
+
 enum class ShapeType { Stroke, Rectangle, Ellipse /*, ...*/ };
 
+// Concrete shapes also provide getBounds(): the box of their own geometry,
+// untransformed and without thickness, in O(1).
 struct Shape {
     ShapeType type;
     Color color;
     float thickness;
+    ShapeId id = 0;
+    // Applied on top of the shape's own geometry (points, corners). The
+    // engine composes moves and transforms here and folds it into the
+    // geometry lazily; see DrawingEngine::bakeTransforms().
+    Affine transform;
     
     // Add constructor for the base class
     Shape(ShapeType t, const Color& c, float th) 
@@ -0,0 +1,83 @@
+#pragma once
+#include <vector>
+#include "draw.hpp"
+
+// Online polyline simplification for a stroke that is still being inked.
+//
+// Keeps a sliding window of the raw samples since the last committed point
+// (the anchor). The newest output point is tentative: while every sample in
+// the window stays within epsilon of the segment anchor -> newest sample,
+// that sample simply replaces the tentative point. Once one strays, the
+// tentative point is committed and becomes the new anchor. Every dropped
+// sample therefore lies within epsilon of the output polyline, as with
+// offline RDP, although the greedy choice keeps somewhat more points.
+//
+// The window is capped at maxWindow samples (a commit is forced when it
+// fills), so memory is bounded and each sample costs O(maxWindow) at worst
+// -- constant per point, scanned with the vectorised RDP kernel.
+class StreamingSimplifier {
+    public:
+        enum class Action {
+            Append,   // add the sample as a new output point
+            Replace   // the sample replaces the last output point
+        };
+
+        explicit StreamingSimplifier(float epsilon = 1.0f, size_t maxWindow = 64)
+            : epsilon(epsilon), maxWindow(maxWindow < 3 ? 3 : maxWindow) {
+            xs.reserve(this->maxWindow + 1);
+            ys.reserve(this->maxWindow + 1);
+        }
+
+        Action push(const Point& pt) {
+            if (xs.empty() || !tentative) {
+                // First sample becomes the anchor, the second the tentative end
+                tentative = !xs.empty();
+                add(pt);
+                return Action::Append;
+            }
+
+            add(pt);
+            if (xs.size() <= maxWindow) {
+                float maxDistSq;
+                RDP::detail::farthestPoint(xs.data(), ys.data(), 0, xs.size() - 1, maxDistSq);
+                if (maxDistSq <= epsilon * epsilon) return Action::Replace;
+            }
+
+            // Commit the previous tentative point and start a new window from it
+            size_t committed = xs.size() - 2;
+            xs[0] = xs[committed];
+            ys[0] = ys[committed];
+            xs[1] = pt.x;
+            ys[1] = pt.y;
+            xs.resize(2);
+            ys.resize(2);
+            return Action::Append;
+        }
+
+        // Continue from an existing output point, e.g. after the stroke moved
+        void restart(const Point& anchor) {
+            reset();
+            add(anchor);
+        }
+
+        void reset() {
+            xs.clear();
+            ys.clear();
+            tentative = false;
+        }
+
+        float getEpsilon() const { return epsilon; }
+        size_t windowSize() const { return xs.size(); }
+
+    private:
+        void add(const Point& pt) {
+            xs.push_back(pt.x);
+            ys.push_back(pt.y);
+        }
+
+        float epsilon;
+        size_t maxWindow;
+        std::vector<float> xs;  // anchor, dropped samples, tentative end
+        std::vector<float> ys;
+        bool tentative = false;
+};
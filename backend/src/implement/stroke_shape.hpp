@@ -3,22 +3,69 @@
 
 #include "shape.hpp"
 #include "draw.hpp"
+#include "point_arena.hpp"
 
 struct StrokeShape : public Shape {
+    // Detached storage. Once a DrawingEngine owns the stroke its points live
+    // in the engine's PointArena (see arena/range) and this stays empty.
     std::vector<Point> points;
+    PointArena* arena = nullptr;
+    PointRange range;
+    // Box of the points, untransformed and without thickness. The engine
+    // grows it as points arrive; replaced points may leave it a little loose.
+    AABB bounds;
     
     StrokeShape(const Color& color, float thickness, const std::vector<Point>& pts = {})
         : Shape(ShapeType::Stroke, color, thickness), points(pts) {}
     
+    // Copies are always detached, so they never alias an engine's arena
+    StrokeShape(const StrokeShape& other)
+        : Shape(other), points(other.getPoints()), bounds(other.bounds) {}
+    
+    StrokeShape& operator=(const StrokeShape& other) {
+        if (this != &other) {
+            Shape::operator=(other);
+            points = other.getPoints();
+            bounds = other.bounds;
+            arena = nullptr;
+            range = PointRange();
+        }
+        return *this;
+    }
+    
+    // Moves keep the arena span; the engine's shape pools move strokes around
+    StrokeShape(StrokeShape&&) noexcept = default;
+    StrokeShape& operator=(StrokeShape&&) noexcept = default;
+    
     std::unique_ptr<Shape> clone() const override {
         return std::make_unique<StrokeShape>(*this);
     }
     
+    size_t pointCount() const { return arena ? range.length : points.size(); }
+    Point pointAt(size_t i) const { return arena ? arena->get(range, i) : points[i]; }
+    std::vector<Point> getPoints() const { return arena ? arena->copyOut(range) : points; }
+    
+    const AABB& getBounds() const { return bounds; }
+    
+    // Rescans every point, for when they were rewritten wholesale
+    void recomputeBounds() {
+        bounds = AABB();
+        for (size_t i = 0; i < pointCount(); i++) {
+            Point point = pointAt(i);
+            bounds.expand(point.x, point.y);
+        }
+    }
+    
     // Getter methods for Emscripten binding
     const Color& getColor() const { return color; }
     float getThickness() const { return thickness; }
     void simplify(float epsilon = 1.0f) {
-        points = RDP::simplify(points,epsilon);
+        if (arena) {
+            arena->simplify(range, epsilon);
+        } else {
+            points = RDP::simplify(points, epsilon);
+        }
+        recomputeBounds();
     }
 };
 
@@ -0,0 +1,279 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "color.hpp"
+
+enum class JoinStyle {
+    Miter,
+    Round,
+    Bevel
+};
+
+enum class CapStyle {
+    Butt,
+    Round,
+    Square
+};
+
+struct TessellationStyle {
+    JoinStyle join = JoinStyle::Round;
+    CapStyle cap = CapStyle::Round;
+    float miterLimit = 4.0f;     // miter length / half thickness before falling back to bevel
+    float arcTolerance = 0.25f;  // max world-unit error of round joins and caps
+};
+
+// Indexed triangles for one or more strokes.
+// vertices: [x, y, r, g, b, a] per vertex; indices: three per triangle.
+// Winding is mixed, so draw with face culling off.
+struct StrokeMesh {
+    static constexpr uint32_t FloatsPerVertex = 6;
+
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+
+    uint32_t vertexCount() const { return static_cast<uint32_t>(vertices.size() / FloatsPerVertex); }
+
+    void clear() {
+        vertices.clear();
+        indices.clear();
+    }
+
+    // Appends other, rebasing its indices onto this mesh's vertices
+    void append(const StrokeMesh& other) {
+        uint32_t base = vertexCount();
+        vertices.insert(vertices.end(), other.vertices.begin(), other.vertices.end());
+        indices.reserve(indices.size() + other.indices.size());
+        for (uint32_t index : other.indices) indices.push_back(base + index);
+    }
+};
+
+// Expands a polyline into a triangle mesh of the given thickness.
+//
+// The body is built as a strip: one left/right vertex pair per point, with
+// consecutive pairs joined by two triangles. At a turn the inner side shares
+// one mitred vertex (unless the neighbouring segments are too short for it);
+// the outer side is either mitred too or gets a bevel triangle or round fan
+// around the joint. Output is an indexed triangle list rather than a strip
+// topology, so fans need no degenerate triangles and a whole board can be
+// drawn with one drawIndexed call.
+namespace Tessellator {
+
+    namespace detail {
+
+        struct Builder {
+            StrokeMesh& mesh;
+            const Color& color;
+            float halfWidth;
+            const TessellationStyle& style;
+
+            uint32_t vertex(float x, float y) {
+                mesh.vertices.insert(mesh.vertices.end(), {x, y, color.r, color.g, color.b, color.a});
+                return mesh.vertexCount() - 1;
+            }
+
+            void triangle(uint32_t a, uint32_t b, uint32_t c) {
+                mesh.indices.insert(mesh.indices.end(), {a, b, c});
+            }
+
+            void quad(uint32_t left0, uint32_t right0, uint32_t left1, uint32_t right1) {
+                triangle(left0, right0, left1);
+                triangle(right0, right1, left1);
+            }
+
+            // Segments needed to keep a round arc within arcTolerance
+            int arcSegments(float angle) const {
+                float tolerance = std::min(style.arcTolerance, halfWidth);
+                float step = 2.0f * std::acos(1.0f - tolerance / halfWidth);
+                if (!(step > 0.0f)) return 64;
+                return std::max(1, std::min(64, static_cast<int>(std::ceil(std::fabs(angle) / step))));
+            }
+
+            // Fan around (cx, cy) from vertex `from` to vertex `to`, sweeping
+            // `angle` radians starting at `startAngle`
+            void fan(float cx, float cy, uint32_t from, uint32_t to, float startAngle, float angle) {
+                fan(vertex(cx, cy), cx, cy, from, to, startAngle, angle);
+            }
+
+            void fan(uint32_t center, float cx, float cy, uint32_t from, uint32_t to, float startAngle, float angle) {
+                int segments = arcSegments(angle);
+                uint32_t previous = from;
+                for (int k = 1; k < segments; k++) {
+                    float a = startAngle + angle * k / segments;
+                    uint32_t next = vertex(cx + std::cos(a) * halfWidth, cy + std::sin(a) * halfWidth);
+                    triangle(center, previous, next);
+                    previous = next;
+                }
+                triangle(center, previous, to);
+            }
+
+            void dot(float x, float y) {
+                if (style.cap == CapStyle::Butt) return;
+                if (style.cap == CapStyle::Square) {
+                    uint32_t a = vertex(x - halfWidth, y - halfWidth);
+                    uint32_t b = vertex(x + halfWidth, y - halfWidth);
+                    uint32_t c = vertex(x + halfWidth, y + halfWidth);
+                    uint32_t d = vertex(x - halfWidth, y + halfWidth);
+                    triangle(a, b, c);
+                    triangle(a, c, d);
+                    return;
+                }
+                const float pi = 3.14159265358979f;
+                uint32_t start = vertex(x + halfWidth, y);
+                uint32_t middle = vertex(x - halfWidth, y);
+                fan(x, y, start, middle, 0.0f, pi);
+                fan(x, y, middle, start, pi, pi);
+            }
+        };
+
+    } // namespace detail
+
+    inline void tessellate(const float* xs, const float* ys, size_t count, const Color& color, float thickness,
+                           const TessellationStyle& style, StrokeMesh& mesh) {
+        float halfWidth = thickness * 0.5f;
+        if (count == 0 || !(halfWidth > 0.0f)) return;
+        detail::Builder out{mesh, color, halfWidth, style};
+
+        // Drop repeated samples; they have no direction
+        thread_local std::vector<float> px, py;
+        px.clear();
+        py.clear();
+        for (size_t i = 0; i < count; i++) {
+            if (i > 0 && xs[i] == px.back() && ys[i] == py.back()) continue;
+            px.push_back(xs[i]);
+            py.push_back(ys[i]);
+        }
+        size_t n = px.size();
+        if (n == 1) {
+            out.dot(px[0], py[0]);
+            return;
+        }
+
+        // Unit direction and length of each segment
+        thread_local std::vector<float> dx, dy, len;
+        dx.resize(n - 1);
+        dy.resize(n - 1);
+        len.resize(n - 1);
+        for (size_t i = 0; i + 1 < n; i++) {
+            float ex = px[i + 1] - px[i];
+            float ey = py[i + 1] - py[i];
+            len[i] = std::sqrt(ex * ex + ey * ey);
+            dx[i] = ex / len[i];
+            dy[i] = ey / len[i];
+        }
+
+        // Start: left normal is (-dy, dx)
+        float sx = px[0], sy = py[0];
+        if (style.cap == CapStyle::Square) {
+            sx -= dx[0] * halfWidth;
+            sy -= dy[0] * halfWidth;
+        }
+        uint32_t left = out.vertex(sx - dy[0] * halfWidth, sy + dx[0] * halfWidth);
+        uint32_t right = out.vertex(sx + dy[0] * halfWidth, sy - dx[0] * halfWidth);
+        if (style.cap == CapStyle::Round) {
+            float normalAngle = std::atan2(dx[0], -dy[0]);
+            out.fan(px[0], py[0], left, right, normalAngle, 3.14159265358979f);
+        }
+
+        for (size_t j = 1; j + 1 < n; j++) {
+            float n0x = -dy[j - 1], n0y = dx[j - 1];
+            float n1x = -dy[j], n1y = dx[j];
+            float turn = dx[j - 1] * dy[j] - dy[j - 1] * dx[j];
+            float cosTurn = dx[j - 1] * dx[j] + dy[j - 1] * dy[j];
+
+            if (std::fabs(turn) < 1e-6f && cosTurn > 0.0f) {
+                // Straight on: one shared pair
+                uint32_t nextLeft = out.vertex(px[j] + n0x * halfWidth, py[j] + n0y * halfWidth);
+                uint32_t nextRight = out.vertex(px[j] - n0x * halfWidth, py[j] - n0y * halfWidth);
+                out.quad(left, right, nextLeft, nextRight);
+                left = nextLeft;
+                right = nextRight;
+                continue;
+            }
+
+            // Mitre direction bisects the two normals; its length reaches both edges
+            float mx = n0x + n1x, my = n0y + n1y;
+            float mLen = std::sqrt(mx * mx + my * my);
+            float miterScale = INFINITY;
+            if (mLen > 1e-6f) {
+                mx /= mLen;
+                my /= mLen;
+                float cosHalf = mx * n0x + my * n0y;
+                if (cosHalf > 1e-6f) miterScale = 1.0f / cosHalf;
+            }
+            float miterLength = halfWidth * miterScale;
+            float outer = turn > 0.0f ? -1.0f : 1.0f;  // left turn: outer edge is on the right
+
+            if (style.join == JoinStyle::Miter && miterScale <= style.miterLimit) {
+                uint32_t nextLeft = out.vertex(px[j] + mx * miterLength, py[j] + my * miterLength);
+                uint32_t nextRight = out.vertex(px[j] - mx * miterLength, py[j] - my * miterLength);
+                out.quad(left, right, nextLeft, nextRight);
+                left = nextLeft;
+                right = nextRight;
+                continue;
+            }
+
+            // Inner side: one shared mitre vertex when the segments are long
+            // enough to contain it, otherwise each segment keeps its own edge
+            float innerReach = miterLength * std::sqrt(std::max(0.0f, 1.0f - 1.0f / (miterScale * miterScale)));
+            bool sharedInner = innerReach <= std::min(len[j - 1], len[j]);
+            uint32_t innerEnd, innerStart;
+            if (sharedInner) {
+                innerEnd = innerStart = out.vertex(px[j] - outer * mx * miterLength, py[j] - outer * my * miterLength);
+            } else {
+                innerEnd = out.vertex(px[j] - outer * n0x * halfWidth, py[j] - outer * n0y * halfWidth);
+                innerStart = out.vertex(px[j] - outer * n1x * halfWidth, py[j] - outer * n1y * halfWidth);
+            }
+            uint32_t outerEnd = out.vertex(px[j] + outer * n0x * halfWidth, py[j] + outer * n0y * halfWidth);
+            uint32_t outerStart = out.vertex(px[j] + outer * n1x * halfWidth, py[j] + outer * n1y * halfWidth);
+
+            // Close the incoming segment
+            if (outer > 0.0f) {
+                out.quad(left, right, outerEnd, innerEnd);
+            } else {
+                out.quad(left, right, innerEnd, outerEnd);
+            }
+
+            // Fill the outer wedge around the joint, and with a shared inner
+            // vertex the two triangles between it and the joint
+            uint32_t center = out.vertex(px[j], py[j]);
+            if (sharedInner) {
+                out.triangle(innerEnd, center, outerEnd);
+                out.triangle(innerStart, center, outerStart);
+            }
+            if (style.join == JoinStyle::Round) {
+                float startAngle = std::atan2(outer * n0y, outer * n0x);
+                float sweep = std::atan2(turn, cosTurn);
+                out.fan(center, px[j], py[j], outerEnd, outerStart, startAngle, sweep);
+            } else {
+                out.triangle(center, outerEnd, outerStart);
+            }
+
+            if (outer > 0.0f) {
+                left = outerStart;
+                right = innerStart;
+            } else {
+                left = innerStart;
+                right = outerStart;
+            }
+        }
+
+        // End
+        size_t last = n - 1;
+        float ex = px[last], ey = py[last];
+        float lx = dx[last - 1], ly = dy[last - 1];
+        if (style.cap == CapStyle::Square) {
+            ex += lx * halfWidth;
+            ey += ly * halfWidth;
+        }
+        uint32_t endLeft = out.vertex(ex - ly * halfWidth, ey + lx * halfWidth);
+        uint32_t endRight = out.vertex(ex + ly * halfWidth, ey - lx * halfWidth);
+        out.quad(left, right, endLeft, endRight);
+        if (style.cap == CapStyle::Round) {
+            float normalAngle = std::atan2(-lx, ly);
+            out.fan(px[last], py[last], endRight, endLeft, normalAngle, 3.14159265358979f);
+        }
+    }
+
+} // namespace Tessellator
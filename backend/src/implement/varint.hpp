@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// LEB128 varints and zig-zag signed mapping, shared by the binary formats
+// (board snapshots, point frames). Readers are bounds-checked and report
+// truncated or overlong input instead of reading past the end.
+namespace Varint {
+
+    inline uint64_t zigzag(int64_t v) {
+        return (uint64_t(v) << 1) ^ uint64_t(v >> 63);
+    }
+
+    inline int64_t unzigzag(uint64_t v) {
+        return int64_t(v >> 1) ^ -int64_t(v & 1);
+    }
+
+    inline void write(std::vector<uint8_t>& out, uint64_t v) {
+        while (v >= 0x80) {
+            out.push_back(uint8_t(v) | 0x80);
+            v >>= 7;
+        }
+        out.push_back(uint8_t(v));
+    }
+
+    inline void writeSigned(std::vector<uint8_t>& out, int64_t v) {
+        write(out, zigzag(v));
+    }
+
+    // Reads one varint from [p, end), advancing p. False on truncation or
+    // more than 10 bytes.
+    inline bool read(const uint8_t*& p, const uint8_t* end, uint64_t& v) {
+        v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (p == end) return false;
+            uint8_t byte = *p++;
+            v |= uint64_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+
+    inline bool readSigned(const uint8_t*& p, const uint8_t* end, int64_t& v) {
+        uint64_t raw;
+        if (!read(p, end, raw)) return false;
+        v = unzigzag(raw);
+        return true;
+    }
+
+} // namespace Varint
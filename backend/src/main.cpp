@@ -3,8 +3,16 @@
 #include <sstream>
 #include <vector>
 #include <iomanip>
+#include <map>
+#include <random>
 #include <ctime>
+#include <chrono>
 #include "./implement/DrawingEngine/DrawingEngine.hpp"
+#include "./implement/OperationalTransform/OperationLog.hpp"
+#include "./implement/CrdtDocument/CrdtDocument.hpp"
+#include "./implement/RoomServer/LoopbackClient.hpp"
+#include "./implement/Rasterizer/Rasterizer.hpp"
+#include "./implement/Rasterizer/Png.hpp"
 #include "./implement/stroke_shape.hpp"
 #include "./implement/color.hpp"
 #include "./implement/draw.hpp"
@@ -409,6 +417,1594 @@ void testShapeCreation() {
     }
 }
 
+// Test function for stable shape ids
+void testStableShapeIds() {
+    printTestHeader("STABLE SHAPE ID TEST");
+    
+    DrawingEngine engine;
+    
+    // Create three strokes and remember their ids
+    std::vector<ShapeId> ids;
+    for (int i = 0; i < 3; i++) {
+        std::vector<Point> points = {
+            Point(10.0f + i * 30, 10.0f),
+            Point(20.0f + i * 30, 20.0f)
+        };
+        ids.push_back(engine.addStroke(StrokeShape(Color(0.0f, 0.0f, 0.0f, 1.0f), 2.0f, points)));
+    }
+    
+    printTestResult("Created 3 strokes with ids " + std::to_string(ids[0]) + ", " +
+                    std::to_string(ids[1]) + ", " + std::to_string(ids[2]));
+    
+    // Erasing the middle stroke must not disturb the ids of the others
+    engine.removeShapeById(ids[1]);
+    engine.addPointToStrokeById(ids[2], Point(100.0f, 100.0f));
+    
+    auto strokes = engine.getStrokes();
+    if (strokes.size() == 2 && strokes[1].id == ids[2] && strokes[1].points.size() == 3 &&
+        !engine.hasShape(ids[1]) && engine.getStrokeId(1) == ids[2]) {
+        printTestResult("SUCCESS: Ids stay valid after erasing a neighbour");
+    } else {
+        printTestResult("FAILED: Id lookup broken after erase", false);
+    }
+    
+    // Unknown ids are rejected rather than touching another shape
+    if (!engine.removeShapeById(ids[1]) && !engine.moveShapeById(ids[1], 1.0f, 1.0f)) {
+        printTestResult("SUCCESS: Stale ids are rejected");
+    } else {
+        printTestResult("FAILED: Stale id was accepted", false);
+    }
+    
+    // Erase enough shapes to force slot compaction, then re-check lookups
+    std::vector<ShapeId> bulk;
+    for (int i = 0; i < 200; i++) {
+        bulk.push_back(engine.addStroke(StrokeShape(Color(), 1.0f, {Point(i, i)})));
+    }
+    for (int i = 0; i < 199; i++) {
+        engine.removeShapeById(bulk[i]);
+    }
+    engine.moveShapeById(bulk[199], 1.0f, 1.0f);
+    
+    strokes = engine.getStrokes();
+    if (strokes.size() == 3 && strokes[2].id == bulk[199] && strokes[2].points[0].x == 200.0f &&
+        engine.hasShape(ids[0]) && engine.hasShape(ids[2])) {
+        printTestResult("SUCCESS: Ids survive slot compaction");
+    } else {
+        printTestResult("FAILED: Ids broken after slot compaction", false);
+    }
+}
+
+// Test function for the shared point arena
+void testPointArena() {
+    printTestHeader("POINT ARENA TEST");
+    
+    DrawingEngine engine;
+    
+    // Ink two strokes in alternation so their spans keep relocating
+    ShapeId a = engine.addStroke(StrokeShape(Color(1.0f, 0.0f, 0.0f, 1.0f), 2.0f));
+    ShapeId b = engine.addStroke(StrokeShape(Color(0.0f, 0.0f, 1.0f, 1.0f), 2.0f));
+    for (int i = 0; i < 500; i++) {
+        engine.addPointToStrokeById(a, Point(i, 0.0f));
+        engine.addPointToStrokeById(b, Point(0.0f, i));
+    }
+    
+    // Add and erase filler strokes to push the arena through compaction
+    for (int i = 0; i < 100; i++) {
+        ShapeId filler = engine.addStroke(StrokeShape(Color(), 1.0f, std::vector<Point>(50, Point(i, i))));
+        engine.removeShapeById(filler);
+    }
+    
+    auto strokes = engine.getStrokes();
+    bool intact = strokes.size() == 2 && strokes[0].points.size() == 500 && strokes[1].points.size() == 500;
+    for (int i = 0; intact && i < 500; i++) {
+        intact = strokes[0].points[i].x == i && strokes[1].points[i].y == i;
+    }
+    
+    if (intact) {
+        printTestResult("SUCCESS: Interleaved strokes kept their points through compaction");
+    } else {
+        printTestResult("FAILED: Arena lost or reordered points", false);
+    }
+    
+    // Copies handed out by the engine are detached from its arena
+    if (strokes[0].arena == nullptr && engine.getVertexBufferData().size() == 1000 * 7) {
+        printTestResult("SUCCESS: Returned strokes own their points");
+    } else {
+        printTestResult("FAILED: Returned strokes still alias the arena", false);
+    }
+}
+
+// Test function for the incremental GPU buffers
+void testIncrementalGpuBuffer() {
+    printTestHeader("INCREMENTAL GPU BUFFER TEST");
+    
+    DrawingEngine engine;
+    Color teal(0.0f, 0.5f, 0.5f, 1.0f);
+    ShapeId first = engine.addStroke(StrokeShape(teal, 2.0f, {Point(0, 0), Point(1, 1)}));
+    ShapeId second = engine.addStroke(StrokeShape(teal, 3.0f, {Point(5, 5)}));
+    
+    GpuBufferUpdate initial = engine.takeGpuBufferUpdate();
+    printTestResult("Initial upload: " + std::to_string(initial.vertexRanges.size()) + " vertex range(s), " +
+                    std::to_string(initial.vertexByteLength) + " bytes");
+    
+    // One new point on the first stroke should dirty exactly one vertex
+    engine.addPointToStrokeById(first, Point(2, 2));
+    GpuBufferUpdate delta = engine.takeGpuBufferUpdate();
+    const uint32_t vertexBytes = GpuBuffers::FloatsPerVertex * sizeof(float);
+    if (delta.vertexRanges.size() == 1 && delta.vertexRanges[0].size == vertexBytes && !delta.fullUpload) {
+        printTestResult("SUCCESS: Appending a point dirtied a single vertex");
+    } else {
+        printTestResult("FAILED: Append dirtied " + std::to_string(delta.vertexRanges.size()) + " range(s)", false);
+    }
+    
+    // The draw commands must describe the same vertices getVertexBufferData emits
+    const auto& vertices = engine.getGpuVertices();
+    const auto& commands = engine.getGpuDrawCommands();
+    std::vector<float> packed;
+    for (size_t c = 0; c + 3 < commands.size(); c += GpuBuffers::WordsPerDrawCommand) {
+        for (uint32_t v = 0; v < commands[c]; v++) {
+            size_t base = (commands[c + 2] + v) * GpuBuffers::FloatsPerVertex;
+            packed.insert(packed.end(), vertices.begin() + base, vertices.begin() + base + GpuBuffers::FloatsPerVertex);
+        }
+    }
+    if (packed == engine.getVertexBufferData()) {
+        printTestResult("SUCCESS: Persistent buffer matches getVertexBufferData");
+    } else {
+        printTestResult("FAILED: Persistent buffer diverged from getVertexBufferData", false);
+    }
+    
+    // Nothing changed, nothing to upload
+    GpuBufferUpdate idle = engine.takeGpuBufferUpdate();
+    engine.removeShapeById(second);
+    GpuBufferUpdate erased = engine.takeGpuBufferUpdate();
+    if (idle.vertexRanges.empty() && idle.drawCommandRanges.empty() &&
+        erased.vertexRanges.empty() && erased.drawCommandRanges.size() == 1 &&
+        engine.getGpuDrawCommands()[GpuBuffers::WordsPerDrawCommand] == 0) {
+        printTestResult("SUCCESS: Idle frames upload nothing and erase only touches a draw command");
+    } else {
+        printTestResult("FAILED: Unexpected uploads for idle/erase frames", false);
+    }
+}
+
+// Test function for the zero-copy vertex view
+void testZeroCopyVertexView() {
+    printTestHeader("ZERO-COPY VERTEX VIEW TEST");
+    
+    DrawingEngine engine;
+    ShapeId id = engine.addStroke(StrokeShape(Color(0.2f, 0.4f, 0.6f, 1.0f), 2.0f, {Point(1, 2), Point(3, 4)}));
+    
+    const std::vector<float>& view = engine.getVertexBufferView();
+    const float* data = view.data();
+    uint32_t generation = engine.getViewGeneration();
+    uint64_t version = engine.getContentVersion();
+    
+    if (view == engine.getVertexBufferData()) {
+        printTestResult("SUCCESS: View matches getVertexBufferData");
+    } else {
+        printTestResult("FAILED: View differs from getVertexBufferData", false);
+    }
+    
+    // No mutation: same storage, same generation
+    engine.getVertexBufferView();
+    if (engine.getVertexBufferView().data() == data && engine.getViewGeneration() == generation) {
+        printTestResult("SUCCESS: Unchanged board reuses the exported buffer");
+    } else {
+        printTestResult("FAILED: Exported buffer moved without a mutation", false);
+    }
+    
+    // A mutation bumps the content version; a longer buffer needs a new view
+    engine.addPointToStrokeById(id, Point(5, 6));
+    const std::vector<float>& grown = engine.getVertexBufferView();
+    if (engine.getContentVersion() > version && grown.size() == 3 * 7 &&
+        engine.getViewGeneration() != generation) {
+        printTestResult("SUCCESS: Mutation bumped the version and invalidated old views");
+    } else {
+        printTestResult("FAILED: Version/generation not updated after mutation", false);
+    }
+}
+
+// Test function for spatial queries
+void testSpatialQueries() {
+    printTestHeader("SPATIAL QUERY TEST");
+    
+    DrawingEngine engine;
+    
+    // A 10x10 lattice of short horizontal strokes, 100 units apart
+    std::vector<ShapeId> ids;
+    for (int row = 0; row < 10; row++) {
+        for (int col = 0; col < 10; col++) {
+            float x = col * 100.0f, y = row * 100.0f;
+            ids.push_back(engine.addStroke(StrokeShape(Color(), 2.0f, {Point(x, y), Point(x + 50.0f, y)})));
+        }
+    }
+    // One long stroke drawn on top, crossing the first row
+    ShapeId top = engine.addStroke(StrokeShape(Color(), 2.0f, {Point(-10.0f, 0.0f), Point(1000.0f, 0.0f)}));
+    
+    auto hits = engine.hitTest(25.0f, 0.5f, 1.0f);
+    if (hits.size() == 2 && hits[0] == top && hits[1] == ids[0]) {
+        printTestResult("SUCCESS: hitTest returns overlapping shapes topmost first");
+    } else {
+        printTestResult("FAILED: hitTest returned " + std::to_string(hits.size()) + " shape(s)", false);
+    }
+    
+    if (engine.hitTest(75.0f, 50.0f, 5.0f).empty()) {
+        printTestResult("SUCCESS: hitTest misses empty space");
+    } else {
+        printTestResult("FAILED: hitTest hit empty space", false);
+    }
+    
+    // Viewport covering the 2x2 top-left block (plus the long stroke)
+    auto visible = engine.queryRect(AABB(-5.0f, -5.0f, 160.0f, 110.0f));
+    if (visible.size() == 5 && visible.back() == top) {
+        printTestResult("SUCCESS: queryRect returns the viewport's shapes in draw order");
+    } else {
+        printTestResult("FAILED: queryRect returned " + std::to_string(visible.size()) + " shape(s)", false);
+    }
+    
+    // The index follows moves, appended points and erases
+    engine.moveShapeById(ids[99], -2000.0f, 0.0f);
+    engine.addPointToStrokeById(ids[55], Point(5000.0f, 5000.0f));
+    engine.removeShapeById(top);
+    bool moved = engine.hitTest(-1075.0f, 900.0f, 1.0f) == std::vector<ShapeId>{ids[99]};
+    bool grown = engine.hitTest(5000.0f, 5000.0f, 1.0f) == std::vector<ShapeId>{ids[55]};
+    bool erased = engine.hitTest(75.0f, 0.0f, 1.0f).empty();
+    if (moved && grown && erased) {
+        printTestResult("SUCCESS: Index tracks moves, growth and erases");
+    } else {
+        printTestResult("FAILED: Index out of date after mutations", false);
+    }
+}
+
+// Test function for viewport culling and level of detail
+void testViewportLevelOfDetail() {
+    printTestHeader("VIEWPORT LOD TEST");
+    
+    DrawingEngine engine;
+    
+    // Dense, gently curving strokes in a row, plus one far off-screen
+    for (int s = 0; s < 20; s++) {
+        std::vector<Point> points;
+        for (int i = 0; i < 500; i++) {
+            float t = i * 0.2f;
+            points.push_back(Point(s * 120.0f + t, 50.0f * std::sin(t * 0.05f)));
+        }
+        engine.addStroke(StrokeShape(Color(0.0f, 0.0f, 0.0f, 1.0f), 2.0f, points));
+    }
+    ShapeId far = engine.addStroke(StrokeShape(Color(), 2.0f, {Point(1e6f, 1e6f), Point(1e6f + 10.0f, 1e6f)}));
+    
+    size_t fullSize = engine.getVertexBufferData().size();
+    AABB viewport(-100.0f, -100.0f, 2500.0f, 100.0f);
+    
+    // Zoomed right in: only culling applies, every point survives
+    auto closeUp = engine.getVertexBufferDataForViewport(viewport, 100.0f);
+    if (closeUp.size() == fullSize - 2 * 7) {
+        printTestResult("SUCCESS: Close-up keeps every on-screen point and culls the far stroke");
+    } else {
+        printTestResult("FAILED: Close-up emitted " + std::to_string(closeUp.size() / 7) + " vertices", false);
+    }
+    
+    // Zoomed out: an order of magnitude fewer vertices
+    auto overview = engine.getVertexBufferDataForViewport(viewport, 0.25f);
+    printTestResult("Overview: " + std::to_string(fullSize / 7) + " -> " + std::to_string(overview.size() / 7) + " vertices");
+    if (overview.size() * 10 <= fullSize) {
+        printTestResult("SUCCESS: Overview decimated by at least 10x");
+    } else {
+        printTestResult("FAILED: Overview not decimated enough", false);
+    }
+    
+    // Cached levels are dropped when a stroke changes
+    ShapeId first = engine.getStrokeId(0);
+    engine.addPointToStrokeById(first, Point(0.0f, 90.0f));
+    auto afterEdit = engine.getVertexBufferDataForViewport(viewport, 0.25f);
+    bool sawNewPoint = false;
+    for (size_t i = 0; i + 1 < afterEdit.size(); i += 7) {
+        if (afterEdit[i] == 0.0f && afterEdit[i + 1] == 90.0f) sawNewPoint = true;
+    }
+    if (sawNewPoint && engine.queryRect(viewport).size() == 20 && engine.hasShape(far)) {
+        printTestResult("SUCCESS: Edited stroke was re-decimated");
+    } else {
+        printTestResult("FAILED: Stale level-of-detail data after edit", false);
+    }
+}
+
+void testIterativeSimplify() {
+    printTestHeader("ITERATIVE RDP TEST");
+    
+    // A sawtooth whose every tooth survives: the old recursive version went
+    // one stack frame deeper per tooth
+    std::vector<Point> saw;
+    for (int i = 0; i < 200000; i++) {
+        saw.push_back(Point(static_cast<float>(i), (i % 2) ? 10.0f : 0.0f));
+    }
+    auto kept = RDP::simplify(saw, 1.0f);
+    if (kept.size() == saw.size()) {
+        printTestResult("SUCCESS: 200k-point sawtooth kept every tooth");
+    } else {
+        printTestResult("FAILED: Sawtooth kept " + std::to_string(kept.size()) + " points", false);
+    }
+    
+    // Collinear points collapse to the endpoints, in place
+    std::vector<float> xs, ys;
+    for (int i = 0; i < 1001; i++) {
+        xs.push_back(i * 0.5f);
+        ys.push_back(i * 0.25f);
+    }
+    size_t count = RDP::simplifyInPlace(xs.data(), ys.data(), xs.size(), 0.1f);
+    if (count == 2 && xs[1] == 500.0f && ys[1] == 250.0f) {
+        printTestResult("SUCCESS: Straight line simplified in place to its endpoints");
+    } else {
+        printTestResult("FAILED: Straight line kept " + std::to_string(count) + " points", false);
+    }
+    
+    // Engine-owned strokes simplify inside the arena
+    DrawingEngine engine;
+    std::vector<Point> bent = {Point(0, 0), Point(5, 0.1f), Point(10, 0), Point(10, 5), Point(10, 10)};
+    ShapeId id = engine.addStroke(StrokeShape(Color(), 2.0f, bent));
+    engine.simplifyStrokeById(id, 1.0f);
+    auto strokes = engine.getStrokes();
+    if (strokes.size() == 1 && strokes[0].pointCount() == 3) {
+        printTestResult("SUCCESS: Arena stroke simplified to its corner");
+    } else {
+        printTestResult("FAILED: Arena stroke simplification", false);
+    }
+}
+
+void testStreamingSimplify() {
+    printTestHeader("STREAMING SIMPLIFY TEST");
+    
+    // A 240 Hz pen drawing a slow wobbly curve: many samples per visible bend
+    std::vector<Point> samples;
+    for (int i = 0; i < 20000; i++) {
+        float t = i * 0.01f;
+        samples.push_back(Point(t * 10.0f, 20.0f * std::sin(t * 0.5f) + 0.2f * std::sin(t * 37.0f)));
+    }
+    
+    DrawingEngine engine;
+    ShapeId id = engine.addStroke(StrokeShape(Color(0.0f, 0.0f, 0.0f, 1.0f), 2.0f, {}));
+    engine.beginStrokeSimplification(id, 0.5f);
+    for (const Point& sample : samples) engine.addPointToStrokeById(id, sample);
+    engine.endStrokeSimplification(id);
+    
+    auto stroke = engine.getStrokes()[0].getPoints();
+    size_t offline = RDP::simplify(samples, 0.5f).size();
+    printTestResult("Streamed " + std::to_string(samples.size()) + " samples -> " + std::to_string(stroke.size()) +
+                    " points (offline RDP: " + std::to_string(offline) + ")");
+    if (stroke.size() * 20 < samples.size() && stroke.size() <= offline * 3) {
+        printTestResult("SUCCESS: Point count close to offline RDP");
+    } else {
+        printTestResult("FAILED: Streaming kept too many points", false);
+    }
+    
+    // Every raw sample stays within epsilon of the streamed polyline
+    float worst = 0.0f;
+    size_t segment = 1;
+    for (const Point& sample : samples) {
+        float best = INFINITY;
+        for (size_t j = segment > 1 ? segment - 1 : 1; j < stroke.size() && j <= segment + 1; j++) {
+            best = std::min(best, RDP::pointToLineDistance(sample, stroke[j - 1], stroke[j]));
+        }
+        while (segment + 1 < stroke.size() && sample.x >= stroke[segment].x) segment++;
+        worst = std::max(worst, best);
+    }
+    if (stroke.front().x == samples.front().x && stroke.back().x == samples.back().x && worst <= 0.5f + 1e-3f) {
+        printTestResult("SUCCESS: Streamed stroke stays within epsilon of the samples");
+    } else {
+        printTestResult("FAILED: Streamed stroke deviates by " + std::to_string(worst), false);
+    }
+    
+    // The GPU copy sees replaced points, not just appended ones
+    engine.takeGpuBufferUpdate();
+    ShapeId live = engine.addStroke(StrokeShape(Color(), 2.0f, {}));
+    engine.beginStrokeSimplification(live, 1.0f);
+    engine.addPointToStrokeById(live, Point(0, 0));
+    engine.addPointToStrokeById(live, Point(1, 0));
+    engine.takeGpuBufferUpdate();
+    engine.addPointToStrokeById(live, Point(2, 0));  // collinear: replaces (1, 0)
+    engine.takeGpuBufferUpdate();
+    const auto& gpuVertices = engine.getGpuVertices();
+    const auto& commands = engine.getGpuDrawCommands();
+    uint32_t first = commands[4 + 2];
+    if (commands[4] == 2 && gpuVertices[(first + 1) * 7] == 2.0f) {
+        printTestResult("SUCCESS: Replaced point re-synced to the GPU buffer");
+    } else {
+        printTestResult("FAILED: GPU buffer missed the replaced point", false);
+    }
+}
+
+float meshArea(const StrokeMesh& mesh) {
+    float area = 0.0f;
+    for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3) {
+        const float* a = &mesh.vertices[mesh.indices[t] * StrokeMesh::FloatsPerVertex];
+        const float* b = &mesh.vertices[mesh.indices[t + 1] * StrokeMesh::FloatsPerVertex];
+        const float* c = &mesh.vertices[mesh.indices[t + 2] * StrokeMesh::FloatsPerVertex];
+        area += std::fabs((b[0] - a[0]) * (c[1] - a[1]) - (c[0] - a[0]) * (b[1] - a[1])) * 0.5f;
+    }
+    return area;
+}
+
+void testStrokeTessellation() {
+    printTestHeader("STROKE TESSELLATION TEST");
+    
+    DrawingEngine engine;
+    TessellationStyle style;
+    style.join = JoinStyle::Miter;
+    style.cap = CapStyle::Butt;
+    engine.setTessellationStyle(style);
+    
+    // An L with a mitred corner covers exactly the union of its two arms
+    ShapeId corner = engine.addStroke(StrokeShape(Color(1.0f, 0.0f, 0.0f, 1.0f), 2.0f, {Point(0, 0), Point(10, 0), Point(10, 10)}));
+    float area = meshArea(engine.getStrokeMesh(corner));
+    if (std::fabs(area - 40.0f) < 1e-3f) {
+        printTestResult("SUCCESS: Mitred L-stroke covers its exact area");
+    } else {
+        printTestResult("FAILED: Mitred L-stroke area " + std::to_string(area), false);
+    }
+    
+    // Round caps add a full disc to a straight segment
+    style.join = JoinStyle::Round;
+    style.cap = CapStyle::Round;
+    engine.setTessellationStyle(style);
+    ShapeId line = engine.addStroke(StrokeShape(Color(), 4.0f, {Point(0, 50), Point(20, 50)}));
+    area = meshArea(engine.getStrokeMesh(line));
+    float expected = 20.0f * 4.0f + 3.14159265f * 4.0f;
+    if (std::fabs(area - expected) < expected * 0.02f) {
+        printTestResult("SUCCESS: Round caps add a disc's worth of area");
+    } else {
+        printTestResult("FAILED: Round-capped area " + std::to_string(area) + ", expected " + std::to_string(expected), false);
+    }
+    
+    // Meshes are cached and only rebuilt for the stroke that changed
+    const StrokeMesh* cornerMesh = &engine.getStrokeMesh(corner);
+    const float* cornerData = cornerMesh->vertices.data();
+    engine.addPointToStrokeById(line, Point(30, 60));
+    bool kept = &engine.getStrokeMesh(corner) == cornerMesh && engine.getStrokeMesh(corner).vertices.data() == cornerData;
+    size_t before = engine.getStrokeMesh(line).indices.size();
+    if (kept && before > 0) {
+        printTestResult("SUCCESS: Unchanged stroke keeps its cached mesh");
+    } else {
+        printTestResult("FAILED: Cached mesh was rebuilt", false);
+    }
+    
+    // The packed board mesh holds every stroke with rebased indices
+    const StrokeMesh& board = engine.getTessellation();
+    size_t expectedIndices = engine.getStrokeMesh(corner).indices.size() + engine.getStrokeMesh(line).indices.size();
+    bool inRange = std::all_of(board.indices.begin(), board.indices.end(), [&](uint32_t i) { return i < board.vertexCount(); });
+    if (board.indices.size() == expectedIndices && inRange) {
+        printTestResult("SUCCESS: Board mesh packs " + std::to_string(board.indices.size() / 3) + " triangles");
+    } else {
+        printTestResult("FAILED: Board mesh indices", false);
+    }
+    
+    // Later edits patch the board mesh: it always equals a fresh packing of
+    // the shape meshes in draw order
+    auto repacked = [&engine] {
+        StrokeMesh mesh;
+        for (ShapeId id : engine.getShapeIds()) mesh.append(engine.getStrokeMesh(id));
+        return mesh;
+    };
+    auto matches = [&] {
+        const StrokeMesh& patched = engine.getTessellation();
+        StrokeMesh fresh = repacked();
+        return patched.vertices == fresh.vertices && patched.indices == fresh.indices;
+    };
+    ShapeId top = engine.addStroke(StrokeShape(Color(0, 0, 1, 1), 3.0f, {Point(0, 80), Point(40, 90)}));
+    bool patched = matches();
+    const float* boardData = engine.getTessellation().vertices.data();
+    engine.moveShapeById(corner, 5.0f, 5.0f);
+    patched = patched && matches() && engine.getTessellation().vertices.data() == boardData;
+    engine.addPointToStrokeById(top, Point(60, 70));
+    patched = patched && matches();
+    engine.addPointToStrokeById(line, Point(45, 40));
+    engine.recolorShapeById(top, Color(0, 1, 0, 1));
+    patched = patched && matches();
+    engine.removeShapeById(line);
+    engine.addStroke(StrokeShape(Color(), 2.0f, {Point(-5, -5), Point(-20, 0)}));
+    patched = patched && matches();
+    if (patched) {
+        printTestResult("SUCCESS: Board mesh is patched per shape and matches a full repack");
+    } else {
+        printTestResult("FAILED: Patched board mesh differs from a repack", false);
+    }
+}
+
+void testBinarySnapshot() {
+    printTestHeader("BINARY SNAPSHOT TEST");
+    
+    DrawingEngine engine;
+    ShapeId wavy = engine.addStroke(StrokeShape(Color(1.0f, 0.5f, 0.0f, 1.0f), 3.0f,
+                                                {Point(0.3f, -12.7f), Point(10.25f, 4.0f), Point(-1000.5f, 2048.125f)}));
+    ShapeId gone = engine.addStroke(StrokeShape(Color(), 1.0f, {Point(1, 1), Point(2, 2)}));
+    ShapeId box = engine.addShape(std::make_unique<RectangleShape>(Point(5, 5), Point(50, 40), Color(0, 0, 1, 1), 2.0f));
+    engine.removeShapeById(gone);
+    
+    std::vector<uint8_t> bytes = engine.saveSnapshot();
+    DrawingEngine loaded;
+    bool ok = loaded.loadSnapshot(bytes.data(), bytes.size());
+    auto ids = loaded.getShapeIds();
+    auto strokes = loaded.getStrokes();
+    bool same = ok && ids.size() == 2 && ids[0] == wavy && ids[1] == box && strokes.size() == 1 &&
+                strokes[0].pointCount() == 3 && strokes[0].color.g == 128.0f / 255.0f;
+    for (size_t i = 0; same && i < 3; i++) {
+        Point a = engine.getStrokes()[0].pointAt(i), b = strokes[0].pointAt(i);
+        same = std::fabs(a.x - b.x) <= Snapshot::DefaultQuantum && std::fabs(a.y - b.y) <= Snapshot::DefaultQuantum;
+    }
+    if (same && loaded.getShapeBounds(box) == engine.getShapeBounds(box)) {
+        printTestResult("SUCCESS: Snapshot round-trips shapes, ids and quantized points (" + std::to_string(bytes.size()) + " bytes)");
+    } else {
+        printTestResult("FAILED: Snapshot round trip", false);
+    }
+    
+    // New shapes never reuse an id from the snapshot
+    ShapeId fresh = loaded.addStroke(StrokeShape(Color(), 1.0f, {Point(0, 0)}));
+    if (fresh != wavy && fresh != box && fresh != gone) {
+        printTestResult("SUCCESS: Ids keep counting after a load");
+    } else {
+        printTestResult("FAILED: Loaded board reused an id", false);
+    }
+    
+    // Truncated input is rejected and the board is left alone
+    bool rejected = !loaded.loadSnapshot(bytes.data(), bytes.size() - 1) && loaded.getShapeIds().size() == 3;
+    if (rejected) {
+        printTestResult("SUCCESS: Truncated snapshot rejected without touching the board");
+    } else {
+        printTestResult("FAILED: Truncated snapshot accepted", false);
+    }
+    
+    // Rotated rectangles and ellipses keep their geometry and transform; a
+    // version 1 file (48-byte records, no transform) still loads
+    DrawingEngine turned;
+    ShapeId tilted = turned.addShape(std::make_unique<RectangleShape>(Point(10, 10), Point(60, 30), Color(0, 0, 1, 1), 2.0f));
+    turned.rotateShapeById(tilted, 0.6f, 35.0f, 20.0f);
+    std::vector<uint8_t> turnedBytes = turned.saveSnapshot();
+    DrawingEngine turnedBack;
+    bool kept = turnedBack.loadSnapshot(turnedBytes.data(), turnedBytes.size()) &&
+                turnedBack.getShapeTransform(tilted).b == turned.getShapeTransform(tilted).b &&
+                turnedBack.getVertexBufferData() == turned.getVertexBufferData();
+    ShapeId oval = turned.addShape(std::make_unique<EllipseShape>(Point(100, 50), 40.0f, 10.0f, Color(1, 0, 0, 1), 2.0f));
+    turned.rotateShapeById(oval, 0.9f, 100.0f, 50.0f);
+    std::vector<uint8_t> ovalBytes = turned.saveSnapshot();
+    DrawingEngine ovalBack;
+    bool ovalKept = ovalBack.loadSnapshot(ovalBytes.data(), ovalBytes.size()) &&
+                    ovalBack.getShapeTransform(oval).c == turned.getShapeTransform(oval).c &&
+                    ovalBack.getVertexBufferData() == turned.getVertexBufferData();
+    std::vector<uint8_t> v1(turnedBytes.begin(), turnedBytes.begin() + sizeof(Snapshot::Header) + Snapshot::RecordSizeV1);
+    uint16_t oldVersion = 1;
+    std::memcpy(v1.data() + 4, &oldVersion, sizeof(oldVersion));
+    DrawingEngine old;
+    bool readsV1 = old.loadSnapshot(v1.data(), v1.size()) && old.getShapeTransform(tilted).isIdentity() &&
+                   old.getShapeBounds(tilted) == AABB(9, 9, 61, 31);
+    if (kept && ovalKept && readsV1) {
+        printTestResult("SUCCESS: Rotated rectangles and ellipses round-trip; version 1 snapshots still load");
+    } else {
+        printTestResult("FAILED: Rotated outline or version 1 snapshot", false);
+    }
+    
+    // A 1M-point board through a file
+    DrawingEngine big;
+    for (int s = 0; s < 1000; s++) {
+        std::vector<Point> points;
+        for (int i = 0; i < 1000; i++) points.push_back(Point(s * 3.0f + i * 0.1f, std::sin(i * 0.01f) * 40.0f));
+        big.addStroke(StrokeShape(Color(0, 0, 0, 1), 2.0f, points));
+    }
+    const std::string path = "snapshot_test.bin";
+    big.saveSnapshotFile(path);
+    DrawingEngine reopened;
+    auto start = std::chrono::steady_clock::now();
+    bool opened = reopened.loadSnapshotFile(path);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::remove(path.c_str());
+    if (opened && reopened.getVertexBufferData().size() == big.getVertexBufferData().size()) {
+        printTestResult("SUCCESS: 1M-point snapshot opened in " + std::to_string(ms) + " ms");
+    } else {
+        printTestResult("FAILED: 1M-point snapshot file", false);
+    }
+}
+
+void testPointFrameCodec() {
+    printTestHeader("POINT FRAME CODEC TEST");
+    
+    DrawingEngine sender, receiver;
+    ShapeId a = sender.addStroke(StrokeShape(Color(), 2.0f, {}));
+    ShapeId b = sender.addStroke(StrokeShape(Color(), 2.0f, {}));
+    std::vector<uint8_t> empty = sender.saveSnapshot();
+    receiver.loadSnapshot(empty.data(), empty.size());
+    
+    // 200 samples of stroke a, then 50 of b, as a 240 Hz pen would send them
+    PointFrameWriter writer;
+    std::string json;
+    for (int i = 0; i < 250; i++) {
+        ShapeId id = i < 200 ? a : b;
+        Point pt(100.0f + i * 0.7f, 300.0f + 20.0f * std::sin(i * 0.05f));
+        pt.x = std::round(pt.x * 64.0f) / 64.0f;
+        pt.y = std::round(pt.y * 64.0f) / 64.0f;
+        sender.addPointToStrokeById(id, pt);
+        writer.add(id, pt, 1000000u + i * 4u);
+        json += "{\"type\":\"stroke_update\",\"stroke_id\":" + std::to_string(id) + ",\"point\":{\"x\":" +
+                std::to_string(pt.x) + ",\"y\":" + std::to_string(pt.y) + "},\"t\":" + std::to_string(1000000 + i * 4) + "}";
+    }
+    std::vector<uint8_t> packet = writer.take();
+    printTestResult("250 points: " + std::to_string(packet.size()) + " bytes binary vs " + std::to_string(json.size()) + " bytes JSON");
+    if (packet.size() * 5 <= json.size()) {
+        printTestResult("SUCCESS: Frames are at least 5x smaller than JSON");
+    } else {
+        printTestResult("FAILED: Frames not small enough", false);
+    }
+    
+    // Two frames, applied in one call, reproduce the sender's strokes
+    size_t applied = receiver.applyPointFrames(packet.data(), packet.size());
+    if (applied == 2 && receiver.getVertexBufferData() == sender.getVertexBufferData()) {
+        printTestResult("SUCCESS: Receiver matches sender after one applyPointFrames call");
+    } else {
+        printTestResult("FAILED: Applied " + std::to_string(applied) + " frames, strokes differ", false);
+    }
+    
+    // Timestamps survive; a truncated packet stops at the damaged frame
+    PointFrame frame;
+    size_t used = PointFrameCodec::decode(packet.data(), packet.size(), frame);
+    bool timed = used > 0 && frame.timestamps.size() == 200 && frame.timestamps[199] == 1000000u + 199 * 4u;
+    size_t partial = receiver.applyPointFrames(packet.data(), packet.size() - 1);
+    if (timed && partial == 1) {
+        printTestResult("SUCCESS: Timestamps decoded and truncated frame rejected");
+    } else {
+        printTestResult("FAILED: Timestamp or truncation handling", false);
+    }
+}
+
+void testCommandBatch() {
+    printTestHeader("COMMAND BATCH TEST");
+    
+    DrawingEngine direct, batched;
+    batched.initCommandRing(64);  // small, so records wrap and the ring fills
+    CommandWriter writer(batched.getCommandRing());
+    size_t written = 0, applied = 0, batches = 0;
+    auto write = [&](auto command) {
+        while (!command()) {
+            applied += batched.applyBatch();  // full: let the engine catch up
+            batches++;
+        }
+        written++;
+    };
+    
+    Color red(1, 0, 0, 1), blue(0, 0, 1, 1);
+    for (ShapeId id = 1; id <= 20; id++) {
+        direct.addStroke([&] { StrokeShape s(red, 2.0f); s.id = id; return s; }());
+        write([&] { return writer.newStroke(id, red, 2.0f); });
+        for (int i = 0; i < 10; i++) {
+            direct.addPointToStrokeById(id, Point(id * 10.0f + i, float(i)));
+            write([&] { return writer.addPoint(id, id * 10.0f + i, float(i)); });
+        }
+        if (id % 3 == 0) {
+            direct.moveShapeById(id, 5, -5);
+            write([&] { return writer.move(id, 5, -5); });
+        }
+        if (id % 4 == 0) {
+            direct.recolorShapeById(id, blue);
+            write([&] { return writer.recolor(id, blue); });
+        }
+        if (id % 5 == 0) {
+            direct.removeShapeById(id - 1);
+            write([&] { return writer.remove(id - 1); });
+        }
+    }
+    applied += batched.applyBatch();
+    batches++;
+    
+    if (applied == written && batched.getShapeIds() == direct.getShapeIds() &&
+        batched.getVertexBufferData() == direct.getVertexBufferData()) {
+        printTestResult("SUCCESS: " + std::to_string(written) + " records in " + std::to_string(batches) +
+                        " applyBatch calls match the direct API");
+    } else {
+        printTestResult("FAILED: Batched board differs (" + std::to_string(applied) + "/" + std::to_string(written) + " applied)", false);
+    }
+    
+    // A record claiming more words than were written drops the rest of the batch
+    CommandRing& ring = batched.getCommandRing();
+    writer.addPoint(1, 0, 0);
+    ring.records()[ring.writeIndex() - 5] |= 0xff00;
+    size_t corrupt = batched.applyBatch();
+    if (corrupt == 0 && ring.readIndex() == ring.writeIndex()) {
+        printTestResult("SUCCESS: Malformed record rejected");
+    } else {
+        printTestResult("FAILED: Malformed record applied", false);
+    }
+    
+    // A NewStroke with a taken or zero id is turned down and reported, and
+    // the records after it cannot reach the shape that owns the id
+    AABB before = batched.getShapeBounds(5);
+    writer.newStroke(5, blue, 3.0f);
+    writer.addPoint(5, 900, 900);
+    writer.move(5, 50, 50);
+    writer.newStroke(0, blue, 3.0f);
+    writer.newStroke(100, blue, 3.0f);
+    writer.addPoint(100, 1, 1);
+    size_t accepted = batched.applyBatch();
+    AABB after = batched.getShapeBounds(5);
+    bool untouched = before.minX == after.minX && before.maxX == after.maxX && before.maxY == after.maxY;
+    if (accepted == 2 && writer.rejected() == 2 && batched.getRejectedStrokes() == std::vector<ShapeId>{5, 0} &&
+        untouched && batched.hasShape(100)) {
+        printTestResult("SUCCESS: Colliding stroke ids are rejected and reported to the writer");
+    } else {
+        printTestResult("FAILED: Colliding stroke id applied (" + std::to_string(accepted) + " applied)", false);
+    }
+}
+
+void testUndoRedo() {
+    printTestHeader("UNDO / REDO TEST");
+    
+    DrawingEngine engine;
+    engine.setHistoryBudget(1 << 20);
+    std::vector<std::vector<float>> states = {engine.getVertexBufferData()};
+    
+    // Inking a stroke is one step; so are two moves in a row
+    ShapeId a = engine.addStroke(StrokeShape(Color(1, 0, 0, 1), 2.0f));
+    for (int i = 0; i < 20; i++) engine.addPointToStrokeById(a, Point(float(i), float(i % 3)));
+    states.push_back(engine.getVertexBufferData());
+    ShapeId b = engine.addStroke(StrokeShape(Color(0, 0, 1, 1), 2.0f, {Point(0, 10), Point(5, 10)}));
+    states.push_back(engine.getVertexBufferData());
+    engine.moveShapeById(b, 1, 1);
+    engine.moveShapeById(b, 2, 2);
+    states.push_back(engine.getVertexBufferData());
+    engine.recolorShapeById(a, Color(0, 1, 0, 1));
+    states.push_back(engine.getVertexBufferData());
+    engine.beginHistoryGroup();
+    engine.removeShapeById(a);
+    engine.simplifyStrokeById(b, 100.0f);
+    engine.endHistoryGroup();
+    states.push_back(engine.getVertexBufferData());
+    
+    bool undoOk = true;
+    for (size_t i = states.size() - 1; i > 0; i--) {
+        undoOk = undoOk && engine.undo() && engine.getVertexBufferData() == states[i - 1];
+    }
+    undoOk = undoOk && !engine.canUndo();
+    bool redoOk = true;
+    for (size_t i = 1; i < states.size(); i++) {
+        redoOk = redoOk && engine.redo() && engine.getVertexBufferData() == states[i];
+    }
+    if (undoOk && redoOk && !engine.canRedo()) {
+        printTestResult("SUCCESS: " + std::to_string(states.size() - 1) + " steps undone and redone exactly");
+    } else {
+        printTestResult("FAILED: Undo/redo did not restore the board", false);
+    }
+    
+    // Undoing the erase puts the stroke back under b, where it was drawn
+    engine.undo();
+    std::vector<ShapeId> order = engine.getShapeIds();
+    if (order.size() == 2 && order[0] == a && order[1] == b) {
+        printTestResult("SUCCESS: Restored shape kept its draw order");
+    } else {
+        printTestResult("FAILED: Restored shape moved in draw order", false);
+    }
+    
+    // A new change drops the redo side; the budget evicts the oldest steps
+    engine.moveShapeById(a, 1, 0);
+    size_t budget = 16 * 1024;
+    engine.setHistoryBudget(budget);
+    for (int i = 0; i < 200; i++) {
+        std::vector<Point> path;
+        for (int k = 0; k < 50; k++) path.emplace_back(float(k), float(i));
+        engine.removeShapeById(engine.addStroke(StrokeShape(Color(0, 0, 0, 1), 1.0f, path)));
+    }
+    int undone = 0;
+    while (engine.undo()) undone++;
+    if (engine.canRedo() && engine.getHistoryBytes() <= budget && undone > 0 && undone < 400) {
+        printTestResult("SUCCESS: History held to " + std::to_string(engine.getHistoryBytes()) +
+                        " bytes, " + std::to_string(undone) + " steps kept");
+    } else {
+        printTestResult("FAILED: History budget not enforced", false);
+    }
+}
+
+void testLazyTransforms() {
+    printTestHeader("LAZY TRANSFORM TEST");
+    
+    DrawingEngine engine;
+    std::vector<Point> path;
+    for (int i = 0; i < 10000; i++) path.emplace_back(float(i % 100), float(i / 100));
+    ShapeId id = engine.addStroke(StrokeShape(Color(1, 0, 0, 1), 2.0f, path));
+    
+    // A drag is O(1) per event: the points stay put until baked
+    std::vector<float> before = engine.getVertexBufferData();
+    for (int i = 0; i < 100; i++) engine.moveShapeById(id, 0.5f, 0.25f);
+    engine.rotateShapeById(id, 3.14159265f / 2, 50.0f, 50.0f);
+    const StrokeShape* stroke = static_cast<const StrokeShape*>(engine.getShapes()[0]);
+    bool lazy = stroke->pointAt(0).x == 0.0f && !engine.getShapeTransform(id).isIdentity();
+    
+    // Output and bounds already show the moved, rotated stroke: (0,0) -> (50,25) -> (75,50)
+    std::vector<float> moved = engine.getVertexBufferData();
+    AABB box = engine.getShapeBounds(id);
+    bool output = std::fabs(moved[0] - 75.0f) < 1e-3f && std::fabs(moved[1] - 50.0f) < 1e-3f &&
+                  box.maxX > 75.0f && box.maxX < 77.0f && !engine.hitTest(75.0f, 50.0f, 0.5f).empty();
+    if (lazy && output && moved.size() == before.size()) {
+        printTestResult("SUCCESS: Transform composed lazily and honored by output, bounds and hits");
+    } else {
+        printTestResult("FAILED: Lazy transform not applied", false);
+    }
+    
+    // Idle means untouched since the previous bake call
+    size_t first = engine.bakeTransforms();
+    size_t second = engine.bakeTransforms();
+    std::vector<float> baked = engine.getVertexBufferData();
+    bool same = baked.size() == moved.size();
+    for (size_t i = 0; same && i < baked.size(); i++) same = std::fabs(baked[i] - moved[i]) < 1e-3f;
+    if (first == 0 && second == 1 && engine.getShapeTransform(id).isIdentity() && same) {
+        printTestResult("SUCCESS: Idle transform baked into the points");
+    } else {
+        printTestResult("FAILED: Baking changed the stroke or ran too early", false);
+    }
+}
+
+void testSelection() {
+    printTestHeader("SELECTION TEST");
+    
+    DrawingEngine engine;
+    for (int i = 0; i < 100; i++) {
+        std::vector<Point> path = {Point(0.0f, i * 10.0f), Point(25.0f, i * 10.0f), Point(50.0f, i * 10.0f)};
+        engine.addStroke(StrokeShape(Color(0, 0, 0, 1), 2.0f, path));
+    }
+    // Only its segment crosses the box below; no vertex is inside
+    ShapeId line = engine.addStroke(StrokeShape(Color(0, 0, 0, 1), 2.0f, {Point(-1000.0f, 2000.0f), Point(1000.0f, 2000.0f)}));
+    std::vector<ShapeId> ids = engine.getShapeIds();
+    
+    size_t byRect = engine.selectByRect(AABB(10.0f, 95.0f, 20.0f, 125.0f));
+    std::vector<Point> lasso = {Point(-1.0f, 195.0f), Point(60.0f, 195.0f), Point(60.0f, 235.0f), Point(-1.0f, 235.0f)};
+    size_t both = engine.selectByLasso(lasso, true);
+    bool crossed = engine.selectByRect(AABB(400.0f, 1990.0f, 410.0f, 2010.0f)) == 1 && engine.getSelection()[0] == line;
+    if (byRect == 3 && both == 7 && crossed) {
+        printTestResult("SUCCESS: Rect and lasso selection picked the touched shapes");
+    } else {
+        printTestResult("FAILED: Selection picked " + std::to_string(byRect) + " / " + std::to_string(both) + " shapes", false);
+    }
+    
+    // A drag of the whole selection is one undo step
+    engine.setHistoryBudget(1 << 20);
+    engine.selectByRect(AABB(10.0f, 95.0f, 20.0f, 125.0f));
+    engine.selectByLasso(lasso, true);
+    for (int i = 0; i < 10; i++) engine.moveSelection(1.0f, 0.0f);
+    bool moved = engine.getShapeBounds(ids[10]).minX == 9.0f && engine.getShapeBounds(ids[9]).minX == -1.0f;
+    engine.undo();
+    bool back = engine.getShapeBounds(ids[10]).minX == -1.0f && !engine.canUndo();
+    if (moved && back) {
+        printTestResult("SUCCESS: Selection moved together and undone in one step");
+    } else {
+        printTestResult("FAILED: Selection move or its undo was wrong", false);
+    }
+    
+    engine.recolorSelection(Color(1, 0, 0, 1));
+    bool red = engine.getShapes()[21]->color.r == 1.0f && engine.getShapes()[30]->color.r == 0.0f;
+    engine.undo();
+    bool restored = engine.getShapes()[21]->color.r == 0.0f;
+    if (red && restored) {
+        printTestResult("SUCCESS: Selection recolored and restored in one step");
+    } else {
+        printTestResult("FAILED: Selection recolor was wrong", false);
+    }
+    
+    size_t deleted = engine.deleteSelection();
+    bool gone = deleted == 7 && engine.getShapes().size() == 94 && engine.getSelection().empty();
+    engine.undo();
+    if (gone && engine.getShapeIds() == ids) {
+        printTestResult("SUCCESS: Selection deleted and brought back in draw order");
+    } else {
+        printTestResult("FAILED: Selection delete or its undo was wrong", false);
+    }
+}
+
+void testRectanglesAndEllipses() {
+    printTestHeader("RECTANGLE AND ELLIPSE TEST");
+    
+    DrawingEngine engine;
+    engine.addStroke(StrokeShape(Color(0, 0, 0, 1), 2.0f, {Point(-50, -50), Point(-40, -40)}));
+    ShapeId box = engine.addShape(std::make_unique<RectangleShape>(Point(0, 0), Point(10, 10), Color(0, 0, 1, 1), 2.0f));
+    ShapeId ring = engine.addShape(std::make_unique<EllipseShape>(Point(100, 0), 20.0f, 10.0f, Color(1, 0, 0, 1), 2.0f));
+    
+    // Outlines are closed polylines in the same vertex stream as strokes
+    size_t ringVertices = EllipseShape::segmentsFor(20.0f, 0.25f) + 1;
+    std::vector<float> data = engine.getVertexBufferData();
+    bool closed = data[2 * 7] == 0.0f && data[6 * 7] == 0.0f && data[6 * 7 + 1] == 0.0f &&
+                  data[7 * 7] == 120.0f && data[(7 + ringVertices - 1) * 7] == 120.0f;
+    if (data.size() == (2 + 5 + ringVertices) * 7 && closed) {
+        printTestResult("SUCCESS: Rectangle and ellipse outlines in the vertex data (" + std::to_string(ringVertices) + " ellipse vertices)");
+    } else {
+        printTestResult("FAILED: Outline vertex data has " + std::to_string(data.size() / 7) + " vertices", false);
+    }
+    
+    // One GPU upload carries every shape, in the same layout
+    engine.takeGpuBufferUpdate();
+    const auto& commands = engine.getGpuDrawCommands();
+    const auto& vertices = engine.getGpuVertices();
+    std::vector<float> uploaded;
+    for (size_t i = 0; i < commands.size(); i += GpuBuffers::WordsPerDrawCommand) {
+        const float* first = vertices.data() + size_t(commands[i + 2]) * GpuBuffers::FloatsPerVertex;
+        uploaded.insert(uploaded.end(), first, first + size_t(commands[i]) * GpuBuffers::FloatsPerVertex);
+    }
+    if (commands[4] == 5 && commands[8] == ringVertices && uploaded == data) {
+        printTestResult("SUCCESS: GPU buffers hold strokes, rectangles and ellipses");
+    } else {
+        printTestResult("FAILED: GPU buffers miss a shape", false);
+    }
+    
+    // Bounds, hits and transforms see the real curve
+    bool bounds = engine.getShapeBounds(ring) == AABB(79, -11, 121, 11);
+    bool hits = engine.hitTest(120.0f, 0.0f, 0.5f) == std::vector<ShapeId>{ring} && engine.hitTest(100.0f, 0.0f, 0.5f).empty() &&
+                engine.hitTest(10.0f, 5.0f, 0.5f) == std::vector<ShapeId>{box} && engine.hitTest(5.0f, 5.0f, 0.5f).empty();
+    engine.rotateShapeById(ring, 3.14159265f / 2, 100.0f, 0.0f);
+    AABB turned = engine.getShapeBounds(ring);
+    bool rotated = std::fabs(turned.minX - 89.0f) < 1e-3f && std::fabs(turned.maxY - 21.0f) < 1e-3f &&
+                   !engine.hitTest(100.0f, 20.0f, 0.5f).empty();
+    engine.scaleShapeById(box, 2.0f, 2.0f, 0.0f, 0.0f);
+    engine.bakeTransforms(false);
+    bool baked = engine.getShapeTransform(box).isIdentity() && !engine.getShapeTransform(ring).isIdentity() &&
+                 engine.getShapeBounds(box) == AABB(-1, -1, 21, 21);
+    if (bounds && hits && rotated && baked) {
+        printTestResult("SUCCESS: Bounds, hit tests and transforms follow the outlines");
+    } else {
+        printTestResult("FAILED: Outline bounds, hits or transforms", false);
+    }
+    
+    // Zooming in adds ellipse segments; the rectangle stays at five vertices
+    AABB viewport(-100, -100, 200, 100);
+    size_t far = engine.getVertexBufferDataForViewport(viewport, 0.1f).size() / 7;
+    size_t near = engine.getVertexBufferDataForViewport(viewport, 20.0f).size() / 7;
+    if (far == 2 + 5 + EllipseShape::MinSegments + 1 && near > far + 40) {
+        printTestResult("SUCCESS: Ellipse segments follow the zoom (" + std::to_string(far) + " -> " + std::to_string(near) + " vertices)");
+    } else {
+        printTestResult("FAILED: Viewport outlines did not adapt", false);
+    }
+    
+    const StrokeMesh& board = engine.getTessellation();
+    size_t meshIndices = 0;
+    for (ShapeId id : engine.getShapeIds()) meshIndices += engine.getStrokeMesh(id).indices.size();
+    std::vector<uint8_t> bytes = engine.saveSnapshot();
+    DrawingEngine loaded;
+    bool restored = loaded.loadSnapshot(bytes.data(), bytes.size()) && loaded.getShapeIds().size() == 3;
+    AABB before = engine.getShapeBounds(ring), after = loaded.getShapeBounds(ring);
+    restored = restored && std::fabs(before.minX - after.minX) < 1e-3f && std::fabs(before.maxY - after.maxY) < 1e-3f;
+    if (!engine.getStrokeMesh(ring).indices.empty() && board.indices.size() == meshIndices && restored) {
+        printTestResult("SUCCESS: Outlines tessellate and survive a snapshot");
+    } else {
+        printTestResult("FAILED: Outline mesh or snapshot", false);
+    }
+}
+
+void testShapePools() {
+    printTestHeader("SHAPE POOL TEST");
+    
+    // Interleave the three kinds, erase some, and add more into the freed entries
+    auto addKind = [](DrawingEngine& engine, int i) -> ShapeId {
+        float x = static_cast<float>(i * 10);
+        switch (i % 3) {
+            case 0: return engine.addStroke(StrokeShape(Color(1, 0, 0, 1), 2.0f, {Point(x, 0), Point(x + 5, 5), Point(x, 10)}));
+            case 1: return engine.addShape(std::make_unique<RectangleShape>(Point(x, 20), Point(x + 5, 25), Color(0, 1, 0, 1), 1.0f));
+            default: return engine.addShape(std::make_unique<EllipseShape>(Point(x, 40), 4.0f, 2.0f, Color(0, 0, 1, 1), 1.0f));
+        }
+    };
+    DrawingEngine engine;
+    std::vector<ShapeId> ids;
+    for (int i = 0; i < 30; i++) ids.push_back(addKind(engine, i));
+    for (int i = 0; i < 30; i += 2) engine.removeShapeById(ids[i]);
+    for (int i = 30; i < 45; i++) addKind(engine, i);
+    
+    // The same shapes added fresh, in draw order, must draw the same
+    DrawingEngine fresh;
+    for (int i = 1; i < 30; i += 2) addKind(fresh, i);
+    for (int i = 30; i < 45; i++) addKind(fresh, i);
+    std::vector<float> data = engine.getVertexBufferData();
+    bool kinds = true;
+    std::vector<const Shape*> shapes = engine.getShapes();
+    std::vector<const Shape*> expected = fresh.getShapes();
+    for (size_t i = 0; i < shapes.size() && kinds; i++) kinds = shapes[i]->type == expected[i]->type;
+    if (shapes.size() == 30 && kinds && data == fresh.getVertexBufferData()) {
+        printTestResult("SUCCESS: Reused pool entries keep draw order and vertex data");
+    } else {
+        printTestResult("FAILED: Pools reordered or corrupted shapes", false);
+    }
+    
+    // Erased shapes park in their pool and come back on undo
+    engine.setHistoryBudget(1 << 20);
+    std::vector<ShapeId> live = engine.getShapeIds();
+    engine.beginHistoryGroup();
+    for (size_t i = 0; i < live.size(); i += 3) engine.removeShapeById(live[i]);
+    engine.endHistoryGroup();
+    addKind(engine, 45);
+    engine.undo();
+    engine.undo();
+    engine.takeGpuBufferUpdate();
+    if (engine.getShapeIds() == live && engine.getVertexBufferData() == data) {
+        printTestResult("SUCCESS: Parked shapes survive pool growth");
+    } else {
+        printTestResult("FAILED: Undo lost a parked shape", false);
+    }
+}
+
+void testBoardBounds() {
+    printTestHeader("BOARD BOUNDS TEST");
+    
+    DrawingEngine engine;
+    bool emptyAtStart = engine.getBoardBounds().empty();
+    ShapeId left = engine.addStroke(StrokeShape(Color(0, 0, 0, 1), 2.0f, {Point(-100, 0), Point(-90, 10)}));
+    ShapeId box = engine.addShape(std::make_unique<RectangleShape>(Point(10, 10), Point(0, 0), Color(0, 0, 1, 1), 2.0f));
+    ShapeId right = engine.addStroke(StrokeShape(Color(0, 0, 0, 1), 2.0f, {Point(50, 0)}));
+    
+    // Shapes carry their own geometry box; inking grows it point by point
+    engine.addPointToStrokeById(right, Point(80, -20));
+    const auto* stroke = static_cast<const StrokeShape*>(engine.getShapes()[2]);
+    const auto* rect = static_cast<const RectangleShape*>(engine.getShapes()[1]);
+    bool own = stroke->getBounds() == AABB(50, -20, 80, 0) && rect->getBounds() == AABB(0, 0, 10, 10) &&
+               engine.getShapeBounds(box) == AABB(-1, -1, 11, 11);
+    if (emptyAtStart && own && engine.getBoardBounds() == AABB(-101, -21, 81, 11)) {
+        printTestResult("SUCCESS: Shape and board bounds follow adds and inking");
+    } else {
+        printTestResult("FAILED: Shape or board bounds after adds", false);
+    }
+    
+    // Moves and erasures shrink the board back without a rescan
+    engine.moveShapeById(right, -100.0f, 0.0f);
+    AABB moved = engine.getBoardBounds();
+    engine.removeShapeById(left);
+    AABB erased = engine.getBoardBounds();
+    engine.removeShapeById(right);
+    engine.removeShapeById(box);
+    if (moved == AABB(-101, -21, 11, 11) && erased == AABB(-51, -21, 11, 11) && engine.getBoardBounds().empty()) {
+        printTestResult("SUCCESS: Board bounds shrink on moves and erasures");
+    } else {
+        printTestResult("FAILED: Board bounds after moves or erasures", false);
+    }
+    
+    // Compaction and snapshots keep the union exact
+    std::vector<ShapeId> ids;
+    for (int i = 0; i < 100; i++) {
+        float x = static_cast<float>(i);
+        ids.push_back(engine.addStroke(StrokeShape(Color(0, 0, 0, 1), 0.0f, {Point(x, -x), Point(x + 1, x)})));
+    }
+    for (int i = 50; i < 100; i++) engine.removeShapeById(ids[i]);
+    AABB compacted = engine.getBoardBounds();
+    std::vector<uint8_t> bytes = engine.saveSnapshot();
+    DrawingEngine loaded;
+    loaded.loadSnapshot(bytes.data(), bytes.size());
+    if (compacted == AABB(0, -49, 50, 49) && loaded.getBoardBounds() == compacted) {
+        printTestResult("SUCCESS: Board bounds survive compaction and snapshots");
+    } else {
+        printTestResult("FAILED: Board bounds after compaction or reload", false);
+    }
+}
+
+void testRasterizer() {
+    printTestHeader("RASTERIZER TEST");
+    
+    DrawingEngine engine;
+    engine.addStroke(StrokeShape(Color(1, 0, 0, 1), 4.0f, {Point(10, 32.25f), Point(54, 32.25f)}));
+    engine.addShape(std::make_unique<RectangleShape>(Point(4, 4), Point(20, 20), Color(0, 0, 1, 1), 2.0f));
+    RasterOptions options;
+    options.width = 64;
+    options.height = 64;
+    options.viewport = AABB(0, 0, 64, 64);
+    options.threads = 1;
+    RasterImage image = Rasterizer::render(engine, options);
+    auto pixel = [&image](int x, int y) { return image.rgba.data() + (size_t(y) * image.width + x) * 4; };
+    
+    // Solid inside, background outside, partial coverage on the edge
+    bool inside = pixel(32, 32)[0] == 255 && pixel(32, 32)[1] == 0 && pixel(32, 32)[3] == 255;
+    bool outside = pixel(32, 40)[0] == 255 && pixel(32, 40)[1] == 255 && pixel(32, 40)[2] == 255;
+    bool edge = pixel(32, 34)[1] > 150 && pixel(32, 34)[1] < 230;
+    bool outline = pixel(4, 12)[2] == 255 && pixel(4, 12)[0] == 0 && pixel(12, 12)[0] == 255;
+    if (inside && outside && edge && outline) {
+        printTestResult("SUCCESS: Strokes and outlines rasterize with anti-aliased edges");
+    } else {
+        printTestResult("FAILED: Rasterized pixels are off", false);
+    }
+    
+    // Tiles rendered on several threads give the same image as one thread
+    for (int i = 0; i < 300; i++) {
+        float x = static_cast<float>((i * 37) % 500), y = static_cast<float>((i * 91) % 300);
+        engine.addStroke(StrokeShape(Color(0.1f * (i % 10), 0.5f, 0.2f, 0.8f), 1.0f + i % 7,
+                                     {Point(x, y), Point(x + 40, y + 15), Point(x + 5, y + 60)}));
+    }
+    engine.addShape(std::make_unique<EllipseShape>(Point(250, 150), 200.0f, 100.0f, Color(0, 0, 0, 1), 3.0f));
+    RasterOptions fitted;
+    fitted.width = 300;
+    fitted.height = 200;
+    fitted.threads = 1;
+    RasterImage single = Rasterizer::render(engine, fitted);
+    fitted.threads = 4;
+    RasterImage parallel = Rasterizer::render(engine, fitted);
+    bool margin = single.rgba[0] == 255 && single.rgba[3] == 255;
+    if (single.rgba == parallel.rgba && margin) {
+        printTestResult("SUCCESS: Fitted board renders the same on 1 and 4 threads");
+    } else {
+        printTestResult("FAILED: Parallel tiles differ from a single-threaded render", false);
+    }
+    
+    std::vector<uint8_t> png = Png::encode(single.rgba.data(), single.width, single.height);
+    bool signature = png.size() > 33 && png[0] == 0x89 && png[1] == 'P' && png[12] == 'I' && png[15] == 'R';
+    bool size = png[16] == 0 && png[17] == 0 && png[18] == 1 && png[19] == 44 && png[23] == 200;
+    if (signature && size && png.size() < single.rgba.size() / 2) {
+        printTestResult("SUCCESS: PNG output (" + std::to_string(png.size()) + " bytes for " +
+                        std::to_string(single.rgba.size()) + " raw)");
+    } else {
+        printTestResult("FAILED: PNG header or size", false);
+    }
+}
+
+void testOperationalTransform() {
+    printTestHeader("OPERATIONAL TRANSFORM TEST");
+    
+    // Board model for the checks: stroke id -> timestamp of its last write
+    using Board = std::map<ShapeId, uint64_t>;
+    auto apply = [](Board& board, const Operation& op) {
+        switch (op.type) {
+            case OperationType::StrokeCreate:
+                board[op.strokeId] = op.timestamp;
+                break;
+            case OperationType::StrokeUpdate:
+                if (board.count(op.strokeId)) board[op.strokeId] = op.timestamp;
+                break;
+            case OperationType::StrokeDelete:
+                board.erase(op.strokeId);
+                break;
+            case OperationType::ClearAll:
+                board.clear();
+                break;
+            default:
+                break;
+        }
+    };
+    
+    // Every pair of concurrent ops converges whichever lands first
+    const OperationType types[] = {OperationType::StrokeCreate, OperationType::StrokeUpdate, OperationType::StrokeDelete,
+                                   OperationType::CursorMove, OperationType::ClearAll};
+    bool converges = true;
+    for (OperationType a : types) {
+        for (OperationType b : types) {
+            for (ShapeId strokeB : {ShapeId(1), ShapeId(2)}) {
+                for (uint64_t timeB : {uint64_t(5), uint64_t(10), uint64_t(20)}) {
+                    Operation opA(a, 1, a == OperationType::StrokeCreate ? 3 : 1, 10);
+                    Operation opB(b, 2, b == OperationType::StrokeCreate ? 4 : strokeB, timeB);
+                    Board first = {{1, 0}, {2, 0}}, second = first;
+                    apply(first, opA);
+                    apply(first, OT::transform(opB, opA));
+                    apply(second, opB);
+                    apply(second, OT::transform(opA, opB));
+                    converges = converges && first == second;
+                }
+            }
+        }
+    }
+    Operation early(OperationType::StrokeUpdate, 1, 7, 100), late(OperationType::StrokeUpdate, 2, 7, 200);
+    Operation erase(OperationType::StrokeDelete, 3, 7, 50);
+    bool rules = OT::transform(early, late).isNoop() && !OT::transform(late, early).isNoop() &&
+                 OT::transform(late, erase).isNoop() && !OT::transform(erase, late).isNoop();
+    if (converges && rules) {
+        printTestResult("SUCCESS: Transform rules converge for every pair of op types");
+    } else {
+        printTestResult("FAILED: Transform rules diverge or break the documented wins", false);
+    }
+    
+    // The log versions ops and transforms only against other users' ops
+    OperationLog log(4);
+    Operation create(OperationType::StrokeCreate, 1, 7, 10, 0);
+    Operation update(OperationType::StrokeUpdate, 1, 7, 20, 0);      // same sender, base predates its create
+    Operation remote(OperationType::StrokeUpdate, 2, 7, 15, 0);      // older than user 1's update
+    Operation removal(OperationType::StrokeDelete, 2, 7, 30, 2);
+    bool processed = log.process(create) && log.process(update) && log.process(remote) && log.process(removal);
+    bool versions = create.version == 1 && update.version == 2 && remote.version == 3 && log.currentVersion() == 4;
+    bool outcome = !update.isNoop() && update.transforms == 0 && remote.isNoop() && remote.transforms == 2 &&
+                   !removal.isNoop();
+    if (processed && versions && outcome) {
+        printTestResult("SUCCESS: Log assigns versions and applies the later-wins rule");
+    } else {
+        printTestResult("FAILED: Log versions or transform results", false);
+    }
+    
+    // The ring keeps the last `capacity` ops; older bases must resync
+    Operation fifth(OperationType::CursorMove, 3, 0, 40, 4);
+    bool wrapped = log.process(fifth) && log.size() == 4 && log.oldestVersion() == 2;
+    Operation stale(OperationType::StrokeCreate, 3, 8, 50, 0);
+    Operation ahead(OperationType::StrokeCreate, 3, 8, 50, 9);
+    std::vector<Operation> missed;
+    bool rejects = !log.process(stale) && !log.process(ahead) && !log.since(0, missed) && log.currentVersion() == 5;
+    bool synced = log.since(3, missed) && missed.size() == 2 && missed[0].version == 4 && missed[1].version == 5;
+    if (wrapped && rejects && synced) {
+        printTestResult("SUCCESS: Ring log rejects rotated-out bases and replays the rest");
+    } else {
+        printTestResult("FAILED: Ring wrap, rejection or catch-up", false);
+    }
+    
+    // A client rebasing server ops over its pending ones ends where the server does
+    OperationLog server;
+    Board serverBoard, clientBoard;
+    Operation base(OperationType::StrokeCreate, 1, 1, 1, 0);
+    server.process(base);
+    apply(serverBoard, base);
+    apply(clientBoard, base);
+    std::vector<Operation> pending = {Operation(OperationType::StrokeUpdate, 1, 1, 30, 1),
+                                      Operation(OperationType::StrokeCreate, 1, 2, 31, 1)};
+    for (const Operation& op : pending) apply(clientBoard, op);
+    std::vector<Operation> sent = pending;  // on the wire; rebasing rewrites only the local copies
+    std::vector<Operation> others = {Operation(OperationType::StrokeUpdate, 2, 1, 40, 1),
+                                     Operation(OperationType::StrokeCreate, 3, 3, 41, 1)};
+    for (Operation& op : others) {
+        server.process(op);
+        apply(serverBoard, op);
+        apply(clientBoard, OT::rebase(op, pending));
+    }
+    for (Operation& op : sent) {
+        server.process(op);
+        apply(serverBoard, op);
+    }
+    if (serverBoard == clientBoard && serverBoard.at(1) == 40 && serverBoard.size() == 3) {
+        printTestResult("SUCCESS: Client rebase converges with the server log");
+    } else {
+        printTestResult("FAILED: Client and server boards differ after rebase", false);
+    }
+}
+
+void testCrdtDocument() {
+    printTestHeader("CRDT DOCUMENT TEST");
+    
+    // Splits a packet back into single ops so they can be delivered in any order
+    auto splitOps = [](const std::vector<uint8_t>& packet) {
+        std::vector<std::vector<uint8_t>> ops;
+        CrdtOp op;
+        for (size_t at = 0; at < packet.size();) {
+            size_t used = CrdtCodec::decode(packet.data() + at, packet.size() - at, op);
+            if (used == 0) break;
+            ops.emplace_back(packet.begin() + at, packet.begin() + at + used);
+            at += used;
+        }
+        return ops;
+    };
+    
+    // Three replicas edit concurrently, including the same shapes
+    DrawingEngine engineA, engineB, engineC;
+    CrdtDocument a(engineA, 1), b(engineB, 2), c(engineC, 3);
+    ElementId shared = a.createStroke(Color(0, 0, 0, 1), 2.0f, {Point(0, 0), Point(10, 0)});
+    ElementId box = a.createRectangle(Point(5, 5), Point(20, 20), Color(0, 0, 1, 1), 1.0f);
+    std::vector<uint8_t> setup = a.takeOps();
+    b.applyEncoded(setup.data(), setup.size());
+    c.applyEncoded(setup.data(), setup.size());
+    
+    ElementId strokeA = a.createStroke(Color(1, 0, 0, 1), 3.0f, {Point(1, 1)});
+    for (int i = 0; i < 50; i++) a.appendPoints(strokeA, {Point(1.0f + i, 2.0f + i * 0.5f)});
+    a.setColor(shared, Color(0, 1, 0, 1));
+    a.moveShape(box, 3.0f, 4.0f);
+    b.appendPoints(shared, {Point(20, 5), Point(30, 5)});
+    b.setColor(shared, Color(1, 0, 1, 1));
+    b.deleteShape(box);
+    ElementId ellipseB = b.createEllipse(Point(40, 40), 8.0f, 4.0f, Color(0, 0, 0, 1), 1.0f);
+    c.appendPoints(shared, {Point(-5, -5)});
+    c.moveShape(shared, 1.0f, 1.0f);
+    c.setThickness(shared, 6.0f);
+    ElementId strokeC = c.createStroke(Color(0, 0, 0, 1), 1.0f, {Point(7, 7), Point(8, 9)});
+    std::vector<uint8_t> opsA = a.takeOps(), opsB = b.takeOps(), opsC = c.takeOps();
+    bool inkCoalesced = splitOps(opsA).size() == 3;  // create and 50 appends travel as one op
+    
+    // Every replica gets the others' ops, each in its own shuffled order with duplicates
+    std::vector<std::vector<uint8_t>> all;
+    for (const auto* packet : {&opsA, &opsB, &opsC}) {
+        for (auto& op : splitOps(*packet)) all.push_back(op);
+    }
+    std::mt19937 rng(5);
+    bool converged = true;
+    std::vector<float> reference;
+    for (CrdtDocument* doc : {&a, &b, &c}) {
+        std::vector<std::vector<uint8_t>> delivery = all;
+        delivery.insert(delivery.end(), all.begin(), all.begin() + 5);
+        std::shuffle(delivery.begin(), delivery.end(), rng);
+        for (const auto& op : delivery) converged = converged && doc->applyEncoded(op.data(), op.size()) == 1;
+    }
+    reference = engineA.getVertexBufferData();
+    converged = converged && engineB.getVertexBufferData() == reference && engineC.getVertexBufferData() == reference &&
+                a.encodeState().size() == b.encodeState().size() && a.getShapeIds() == c.getShapeIds();
+    if (inkCoalesced && converged && reference.size() > 0) {
+        printTestResult("SUCCESS: Three replicas converge on shuffled, duplicated ops");
+    } else {
+        printTestResult("FAILED: Replicas diverge after merging", false);
+    }
+    
+    // Merged content: later LWW writes win, delete beats the concurrent move,
+    // runs from different replicas interleave by id, draw order follows ids
+    const auto* merged = static_cast<const StrokeShape*>(engineB.getShapes()[0]);
+    bool lww = merged->getColor().r == 1 && merged->getColor().g == 0 && merged->getThickness() == 6.0f;
+    bool deleted = !b.hasShape(box) && !a.hasShape(box) && engineB.getShapes().size() == 4;
+    std::vector<ElementId> ids = b.getShapeIds();
+    bool ordered = std::is_sorted(ids.begin(), ids.end()) && ids[0] == shared &&
+                   b.elementId(engineB.getShapeIds()[3]) == ids[3];
+    bool points = merged->pointCount() == 5 && b.getTransform(shared).tx == 1.0f;
+    bool known = b.hasShape(ellipseB) && b.hasShape(strokeC) && b.hasShape(strokeA);
+    if (lww && deleted && ordered && points && known) {
+        printTestResult("SUCCESS: LWW registers, remove-wins deletes and id-ordered shapes");
+    } else {
+        printTestResult("FAILED: Merged registers, deletes or ordering", false);
+    }
+    
+    // A replica joining late rebuilds the same board from the state encoding
+    DrawingEngine engineLate;
+    CrdtDocument late(engineLate, 9);
+    std::vector<uint8_t> state = b.encodeState();
+    size_t stateOps = splitOps(state).size();
+    bool loaded = late.applyEncoded(state.data(), state.size()) == stateOps &&
+                  engineLate.getVertexBufferData() == reference && late.clock() == b.clock();
+    CrdtOp bogus;
+    bogus.id = ElementId(1000, 9);
+    bogus.shape = bogus.id;
+    bogus.shapeType = ShapeType::Rectangle;
+    bool rejects = !late.apply(bogus) && !late.appendPoints(box, {Point(0, 0)});
+    if (loaded && rejects) {
+        printTestResult("SUCCESS: Late joiner loads the encoded state; invalid ops are refused");
+    } else {
+        printTestResult("FAILED: State encoding or validation", false);
+    }
+    
+    // A packet whose first op is invalid only once the create has landed
+    // ([append to a rectangle, recolor]) converges in either delivery order
+    DrawingEngine engineP, engineQ, engineR;
+    CrdtDocument p(engineP, 1), q(engineQ, 2), r(engineR, 3);
+    ElementId rect = p.createRectangle(Point(0, 0), Point(8, 8), Color(0, 0, 0, 1), 1.0f);
+    p.createStroke(Color(0, 1, 0, 1), 2.0f, {Point(1, 1), Point(9, 9)});
+    std::vector<uint8_t> creates = p.takeOps();
+    std::vector<uint8_t> packet;
+    CrdtOp append;
+    append.type = CrdtOpType::AppendPoints;
+    append.id = ElementId(50, 7);
+    append.shape = rect;
+    append.points = {Point(4, 4)};
+    CrdtCodec::encode(append, packet);
+    CrdtOp recolor;
+    recolor.type = CrdtOpType::SetColor;
+    recolor.id = ElementId(51, 7);
+    recolor.shape = rect;
+    recolor.color = Color(1, 0, 0, 1);
+    CrdtCodec::encode(recolor, packet);
+    q.applyEncoded(creates.data(), creates.size());
+    q.applyEncoded(packet.data(), packet.size());
+    r.applyEncoded(packet.data(), packet.size());
+    r.applyEncoded(creates.data(), creates.size());
+    p.applyEncoded(packet.data(), packet.size());
+    bool either = q.encodeState() == r.encodeState() && p.encodeState() == q.encodeState() &&
+                     engineQ.getVertexBufferData() == engineR.getVertexBufferData() &&
+                     engineP.getVertexBufferData() == engineQ.getVertexBufferData();
+    // Rotating and thickening the lower shape edits it in place
+    ShapeId lowId = p.engineId(rect);
+    p.setTransform(rect, Affine::rotation(0.5f, 4, 4));
+    p.setThickness(rect, 3.0f);
+    std::vector<uint8_t> edits = p.takeOps();
+    q.applyEncoded(edits.data(), edits.size());
+    bool inPlace = p.engineId(rect) == lowId && engineP.getShapeIds()[0] == lowId &&
+                   engineP.getShapeTransform(lowId).b != 0.0f && engineP.getShapes()[0]->thickness == 3.0f &&
+                   p.encodeState() == q.encodeState();
+    DrawingEngine undoable;
+    undoable.setHistoryBudget(1 << 20);
+    ShapeId thin = undoable.addShape(std::make_unique<RectangleShape>(Point(0, 0), Point(8, 8), Color(0, 0, 0, 1), 1.0f));
+    undoable.setThicknessById(thin, 4.0f);
+    bool thicknessUndo = undoable.getShapeBounds(thin).maxX == 10.0f && undoable.undo() &&
+                         undoable.getShapes()[0]->thickness == 1.0f && undoable.getShapeBounds(thin).maxX == 8.5f;
+    if (either && inPlace && thicknessUndo) {
+        printTestResult("SUCCESS: Rejected ops are skipped alike in any order; register edits stay in place");
+    } else {
+        printTestResult("FAILED: Order-dependent rejection or in-place edits", false);
+    }
+}
+
+void testRoomServer() {
+    printTestHeader("ROOM SERVER TEST");
+    
+    ServerOptions options;
+    options.shards = 2;
+    RoomServer server(options);
+    LoopbackClient a(server, 1), b(server, 2), c(server, 3), other(server, 4);
+    a.join("alpha");
+    b.join("alpha");
+    c.join("alpha");
+    other.join("beta");
+    bool welcomed = true;
+    for (LoopbackClient* client : {&a, &b, &c, &other}) {
+        welcomed = client->waitUntil([client] { return client->welcomesReceived() == 1; }) && welcomed;
+    }
+    
+    // Ops fan out to the rest of the room, not back to the sender or to other rooms
+    ElementId stroke = a.document().createStroke(Color(1, 0, 0, 1), 2.0f, {Point(0, 0)});
+    a.document().appendPoints(stroke, {Point(5, 5), Point(10, 0)});
+    a.flush();
+    ElementId box = b.document().createRectangle(Point(1, 1), Point(4, 4), Color(0, 0, 1, 1), 1.0f);
+    b.flush();
+    bool delivered = a.waitUntil([&] { return a.document().hasShape(box); }) &&
+                     b.waitUntil([&] { return b.document().hasShape(stroke); }) &&
+                     c.waitUntil([&] { return c.document().shapeCount() == 2; });
+    std::vector<float> board = c.engine().getVertexBufferData();
+    bool same = a.engine().getVertexBufferData() == board && b.engine().getVertexBufferData() == board;
+    if (welcomed && delivered && same && a.framesReceived() == 2 && other.document().shapeCount() == 0) {
+        printTestResult("SUCCESS: Room members converge; other rooms see nothing");
+    } else {
+        printTestResult("FAILED: Fan-out within or across rooms", false);
+    }
+    
+    // A late joiner (and a client switching rooms) gets the board in its Welcome
+    LoopbackClient late(server, 5);
+    late.join("alpha");
+    other.join("alpha");
+    bool caughtUp = late.waitUntil([&] { return late.document().shapeCount() == 2; }) &&
+                    other.waitUntil([&] { return other.document().shapeCount() == 2; }) &&
+                    late.engine().getVertexBufferData() == board;
+    if (caughtUp && server.stats().rooms == 2 && server.stats().sessions == 5) {
+        printTestResult("SUCCESS: Late joiners and room switches load the room's state");
+    } else {
+        printTestResult("FAILED: Welcome state or session counts", false);
+    }
+    
+    // Errors go to the sender only; a malformed packet is not relayed
+    LoopbackClient stray(server, 6);
+    stray.send(RoomProtocol::frame(RoomProtocol::Ops));
+    stray.send({0x7f});
+    bool strayErrors = stray.waitUntil([&] { return stray.errorsReceived().size() == 2; }) &&
+                       stray.errorsReceived()[0] == RoomProtocol::NotJoined &&
+                       stray.errorsReceived()[1] == RoomProtocol::Malformed;
+    size_t before = b.framesReceived();
+    c.send(RoomProtocol::frame(RoomProtocol::Ops, std::vector<uint8_t>{0xff, 0x01}.data(), 2));
+    a.document().setColor(stroke, Color(0, 1, 0, 1));
+    a.flush();
+    bool isolated = c.waitUntil([&] { return c.errorsReceived().size() == 1; }) &&
+                    b.waitUntil([&] { return b.framesReceived() == before + 1; }) &&
+                    c.errorsReceived()[0] == RoomProtocol::Malformed && b.errorsReceived().empty();
+    if (strayErrors && isolated) {
+        printTestResult("SUCCESS: Protocol errors reach only the offending client");
+    } else {
+        printTestResult("FAILED: Error handling or relay of bad ops", false);
+    }
+}
+
+void testSendQueue() {
+    printTestHeader("BROADCAST SEND QUEUE TEST");
+    
+    // Frames are shared, not copied; past the frame limit Broadcasts merge
+    SendQueue queue(2, 1024);
+    RoomProtocol::SharedFrame first = RoomProtocol::share({RoomProtocol::Broadcast, 1, 2});
+    bool woke = queue.push(first) == SendQueue::Woke &&
+                queue.push(RoomProtocol::share({RoomProtocol::Broadcast, 3})) == SendQueue::Queued &&
+                queue.push(RoomProtocol::share({RoomProtocol::Broadcast, 4})) == SendQueue::Coalesced &&
+                queue.push(RoomProtocol::share({RoomProtocol::Broadcast, 5, 6})) == SendQueue::Coalesced &&
+                queue.push(RoomProtocol::share(RoomProtocol::error(RoomProtocol::Malformed))) == SendQueue::Queued;
+    std::vector<RoomProtocol::SharedFrame> out;
+    size_t drained = queue.drain(out);
+    bool merged = drained == 4 && out[0] == first &&
+                  *out[2] == std::vector<uint8_t>{RoomProtocol::Broadcast, 4, 5, 6} &&
+                  (*out[3])[0] == RoomProtocol::Error && queue.size() == 0;
+    SendQueue small(8, 4);
+    bool bounded = small.push(RoomProtocol::share(std::vector<uint8_t>(16, RoomProtocol::Broadcast))) == SendQueue::Woke &&
+                   small.push(RoomProtocol::share({RoomProtocol::Broadcast, 1})) == SendQueue::Overflow &&
+                   small.size() == 1;
+    SendQueue unbounded(0, 1024);
+    bool wakes = unbounded.push(RoomProtocol::share({RoomProtocol::Broadcast, 1})) == SendQueue::Woke &&
+                 unbounded.push(RoomProtocol::share({RoomProtocol::Broadcast, 2})) == SendQueue::Coalesced;
+    if (woke && merged && bounded && wakes) {
+        printTestResult("SUCCESS: Queue shares frames, coalesces Broadcasts and bounds bytes");
+    } else {
+        printTestResult("FAILED: SendQueue ordering or limits", false);
+    }
+    
+    // A consumer that stops reading stays bounded and still converges
+    for (size_t budget : {size_t(1) << 20, size_t(256)}) {
+        ServerOptions options;
+        options.shards = 2;
+        options.sendQueueFrames = 4;
+        options.sendQueueBytes = budget;
+        RoomServer server(options);
+        LoopbackClient writer(server, 1), fast(server, 2), slow(server, 3);
+        for (LoopbackClient* client : {&writer, &fast, &slow}) {
+            client->join("room");
+            client->waitUntil([client] { return client->welcomesReceived() == 1; });
+        }
+        ElementId stroke;
+        for (int i = 0; i < 60; i++) {
+            if (i % 20 == 0) stroke = writer.document().createStroke(Color(0, 0, 0, 1), 2.0f, {Point(i, 0)});
+            else writer.document().appendPoints(stroke, {Point(i, i % 7), Point(i + 0.5f, 3)});
+            writer.flush();
+        }
+        std::vector<float> board = writer.engine().getVertexBufferData();
+        bool relayed = fast.waitUntil([&] { return fast.engine().getVertexBufferData() == board; });
+        size_t backlog = slow.framesQueued();
+        ServerStats stats = server.stats();
+        bool converged = slow.waitUntil([&] { return slow.engine().getVertexBufferData() == board; });
+        bool limited = budget > 1024 ? stats.coalesced > 0 && stats.resyncs == 0 && backlog <= 5
+                                     : stats.resyncs > 0 && slow.welcomesReceived() >= 2;
+        if (relayed && converged && limited) {
+            printTestResult(budget > 1024 ? "SUCCESS: Slow consumer's ops coalesce into one frame"
+                                          : "SUCCESS: Slow consumer over its byte budget is resynced");
+        } else {
+            printTestResult("FAILED: Slow consumer handling", false);
+        }
+    }
+}
+
+void testPresence() {
+    printTestHeader("PRESENCE CHANNEL TEST");
+    
+    // Snapshot rate falls with room size and shard backlog, within bounds
+    ServerOptions options;
+    options.shards = 2;
+    bool adaptive = Presence::tickHz(10, 0, options) == options.presenceMaxHz &&
+                    Presence::tickHz(200, 0, options) < Presence::tickHz(100, 0, options) &&
+                    Presence::tickHz(100, 256, options) < Presence::tickHz(100, 0, options) &&
+                    Presence::tickHz(100000, 0, options) == options.presenceMinHz;
+    SendQueue queue(8, 1024);
+    queue.push(RoomProtocol::share(RoomProtocol::presence({{1, 0, 0}})));
+    queue.push(RoomProtocol::share({RoomProtocol::Broadcast, 1}));
+    RoomProtocol::SharedFrame newest = RoomProtocol::share(RoomProtocol::presence({{1, 5, 5}}));
+    bool replaced = queue.push(newest) == SendQueue::Coalesced && queue.size() == 2;
+    std::vector<RoomProtocol::SharedFrame> out;
+    queue.drain(out);
+    replaced = replaced && out[0] == newest;
+    if (adaptive && replaced) {
+        printTestResult("SUCCESS: Tick rate adapts; queued snapshots are replaced, not stacked");
+    } else {
+        printTestResult("FAILED: Presence rate or snapshot replacement", false);
+    }
+    
+    // Many cursor moves arrive as a few snapshots holding the latest of each
+    RoomServer server(options);
+    LoopbackClient a(server, 1), b(server, 2), c(server, 3);
+    for (LoopbackClient* client : {&a, &b, &c}) {
+        client->join("alpha");
+        client->waitUntil([client] { return client->welcomesReceived() == 1; });
+    }
+    ElementId stroke = a.document().createStroke(Color(0, 0, 0, 1), 2.0f, {Point(0, 0)});
+    for (int i = 0; i < 200; i++) {
+        a.moveCursor(float(i), 10.0f);
+        if (i % 50 == 0) {
+            a.document().appendPoints(stroke, {Point(float(i), 1.0f)});
+            a.flush();
+        }
+    }
+    c.moveCursor(-3.0f, 4.5f);
+    auto cursorAt = [](const LoopbackClient& client, uint32_t user, float x, float y) {
+        for (const RoomProtocol::CursorPosition& cursor : client.cursors()) {
+            if (cursor.user == user) return cursor.x == x && cursor.y == y;
+        }
+        return false;
+    };
+    bool latest = b.waitUntil([&] { return cursorAt(b, 1, 199.0f, 10.0f) && cursorAt(b, 3, -3.0f, 4.5f); });
+    bool ops = b.waitUntil([&] { return b.engine().getVertexBufferData() == a.engine().getVertexBufferData(); });
+    ServerStats stats = server.stats();
+    if (latest && ops && b.presencesReceived() < 50 && stats.cursorsIn == 201 && stats.framesIn == 4) {
+        printTestResult("SUCCESS: Cursors coalesce to the latest per user, ops unaffected");
+    } else {
+        printTestResult("FAILED: Cursor coalescing or op delivery", false);
+    }
+    
+    // Leaving drops the cursor from the next snapshot; cursors need a room
+    c.leave();
+    bool dropped = b.waitUntil([&] { return b.cursors().size() == 1; });
+    LoopbackClient stray(server, 4);
+    stray.moveCursor(1.0f, 1.0f);
+    bool rejected = stray.waitUntil([&] { return stray.errorsReceived().size() == 1; }) &&
+                    stray.errorsReceived()[0] == RoomProtocol::NotJoined;
+    if (dropped && rejected) {
+        printTestResult("SUCCESS: Departed users vanish; cursors outside a room are rejected");
+    } else {
+        printTestResult("FAILED: Presence membership", false);
+    }
+    
+    // Switching rooms takes the cursor out of the old room and does not
+    // carry its position into the new one
+    LoopbackClient d(server, 5);
+    d.join("beta");
+    d.waitUntil([&] { return d.welcomesReceived() == 1; });
+    d.moveCursor(2.0f, 2.0f);
+    d.waitUntil([&] { return cursorAt(d, 5, 2.0f, 2.0f); });
+    a.join("beta");
+    bool gone = b.waitUntil([&] { return b.cursors().empty(); });
+    a.waitUntil([&] { return a.welcomesReceived() == 2; });
+    d.moveCursor(3.0f, 3.0f);
+    bool fresh = d.waitUntil([&] { return cursorAt(d, 5, 3.0f, 3.0f); }) && !cursorAt(d, 1, 199.0f, 10.0f);
+    a.moveCursor(7.0f, 7.0f);
+    fresh = fresh && d.waitUntil([&] { return cursorAt(d, 1, 7.0f, 7.0f); });
+    if (gone && fresh) {
+        printTestResult("SUCCESS: A room switch moves the cursor only once it moves again");
+    } else {
+        printTestResult("FAILED: Cursor state across a room switch", false);
+    }
+}
+
 int main() {
     // Get current timestamp for filename
     time_t now = time(0);
@@ -457,6 +2053,30 @@ int main() {
     testClearing();
     testVertexBufferData();
     testShapeCreation();
+    testStableShapeIds();
+    testPointArena();
+    testIncrementalGpuBuffer();
+    testZeroCopyVertexView();
+    testSpatialQueries();
+    testViewportLevelOfDetail();
+    testIterativeSimplify();
+    testStreamingSimplify();
+    testStrokeTessellation();
+    testBinarySnapshot();
+    testPointFrameCodec();
+    testCommandBatch();
+    testUndoRedo();
+    testLazyTransforms();
+    testSelection();
+    testRectanglesAndEllipses();
+    testShapePools();
+    testBoardBounds();
+    testRasterizer();
+    testOperationalTransform();
+    testCrdtDocument();
+    testRoomServer();
+    testSendQueue();
+    testPresence();
     
     // Print summary
     std::string summary = "🎉 All tests completed successfully!";
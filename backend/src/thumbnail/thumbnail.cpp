@@ -0,0 +1,145 @@
+#include "DrawingEngine/DrawingEngine.hpp"
+#include "Rasterizer/Rasterizer.hpp"
+#include "Rasterizer/Png.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Renders board snapshots (DrawingEngine::saveSnapshotFile) to preview images.
+//
+//   build/thumbnail [--size WxH] [--margin PX] [--background RRGGBB[AA]]
+//                   [--format png|raw] [--threads N] [--out DIR] SNAPSHOT...
+//
+// Each SNAPSHOT is written to DIR (default: next to it) with its extension
+// replaced by .png or .rgba; raw output is width * height RGBA bytes, rows
+// top to bottom. One snapshot is split into tiles across the threads; a
+// batch renders one snapshot per thread instead, which keeps every core
+// busy without tiles contending. Exits non-zero if any snapshot failed.
+
+namespace {
+
+struct Options {
+    RasterOptions raster;
+    bool raw = false;
+    unsigned threads = 0;
+    std::string outDir;
+    std::vector<std::string> inputs;
+};
+
+bool parseSize(const char* text, uint32_t& width, uint32_t& height) {
+    unsigned w, h;
+    if (sscanf(text, "%ux%u", &w, &h) != 2 || w == 0 || h == 0 || w > 16384 || h > 16384) return false;
+    width = w;
+    height = h;
+    return true;
+}
+
+bool parseColor(const std::string& text, Color& color) {
+    std::string hex = text[0] == '#' ? text.substr(1) : text;
+    if (hex.size() != 6 && hex.size() != 8) return false;
+    if (hex.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos) return false;
+    unsigned long value = std::strtoul(hex.c_str(), nullptr, 16);
+    if (hex.size() == 6) value = (value << 8) | 0xff;
+    color = Color(((value >> 24) & 0xff) / 255.0f, ((value >> 16) & 0xff) / 255.0f,
+                  ((value >> 8) & 0xff) / 255.0f, (value & 0xff) / 255.0f);
+    return true;
+}
+
+std::string outputPath(const std::string& input, const Options& options) {
+    size_t slash = input.find_last_of('/');
+    std::string name = slash == std::string::npos ? input : input.substr(slash + 1);
+    size_t dot = name.find_last_of('.');
+    if (dot != std::string::npos && dot > 0) name = name.substr(0, dot);
+    name += options.raw ? ".rgba" : ".png";
+    if (!options.outDir.empty()) return options.outDir + "/" + name;
+    return slash == std::string::npos ? name : input.substr(0, slash + 1) + name;
+}
+
+bool renderOne(const std::string& input, const Options& options, unsigned threads) {
+    DrawingEngine engine;
+    if (!engine.loadSnapshotFile(input)) {
+        fprintf(stderr, "Cannot read snapshot %s\n", input.c_str());
+        return false;
+    }
+    RasterOptions raster = options.raster;
+    raster.threads = threads;
+    RasterImage image = Rasterizer::render(engine, raster);
+
+    std::string path = outputPath(input, options);
+    bool ok = Png::writeFile(path, options.raw ? image.rgba : Png::encode(image.rgba.data(), image.width, image.height));
+    if (!ok) fprintf(stderr, "Cannot write %s\n", path.c_str());
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string flag = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (flag.compare(0, 2, "--") != 0) {
+            options.inputs.push_back(flag);
+        } else if (flag == "--size" && hasValue) {
+            if (!parseSize(argv[++i], options.raster.width, options.raster.height)) {
+                fprintf(stderr, "Bad size %s (want WxH)\n", argv[i]);
+                return 1;
+            }
+        } else if (flag == "--margin" && hasValue) {
+            options.raster.margin = std::strtof(argv[++i], nullptr);
+        } else if (flag == "--background" && hasValue) {
+            if (!parseColor(argv[++i], options.raster.background)) {
+                fprintf(stderr, "Bad colour %s (want RRGGBB or RRGGBBAA)\n", argv[i]);
+                return 1;
+            }
+        } else if (flag == "--format" && hasValue) {
+            std::string format = argv[++i];
+            if (format != "png" && format != "raw") {
+                fprintf(stderr, "Unknown format %s\n", format.c_str());
+                return 1;
+            }
+            options.raw = format == "raw";
+        } else if (flag == "--threads" && hasValue) {
+            options.threads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (flag == "--out" && hasValue) {
+            options.outDir = argv[++i];
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (options.inputs.empty()) {
+        fprintf(stderr, "Usage: thumbnail [--size WxH] [--margin PX] [--background RRGGBB[AA]]\n"
+                        "                 [--format png|raw] [--threads N] [--out DIR] SNAPSHOT...\n");
+        return 1;
+    }
+
+    unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    auto start = std::chrono::steady_clock::now();
+    std::atomic<size_t> failed(0);
+    if (options.inputs.size() == 1) {
+        if (!renderOne(options.inputs[0], options, threads)) failed++;
+    } else {
+        std::atomic<size_t> next(0);
+        auto work = [&]() {
+            for (size_t i; (i = next++) < options.inputs.size();) {
+                if (!renderOne(options.inputs[i], options, 1)) failed++;
+            }
+        };
+        std::vector<std::thread> pool;
+        unsigned workers = static_cast<unsigned>(std::min<size_t>(threads, options.inputs.size()));
+        for (unsigned i = 1; i < workers; i++) pool.emplace_back(work);
+        work();
+        for (std::thread& thread : pool) thread.join();
+    }
+    double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    fprintf(stderr, "%zu of %zu snapshots rendered in %.1f ms\n",
+            options.inputs.size() - failed.load(), options.inputs.size(), elapsedMs);
+    return failed ? 1 : 0;
+}
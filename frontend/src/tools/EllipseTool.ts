@@ -55,7 +55,8 @@ export class EllipseTool implements DrawingTool {
   finishDrawing(): WASMShape | null {
     if (!this.startPoint || !this.currentPoint) return null;
 
-    // Create a stroke-based ellipse since ellipse shapes aren't implemented in WASM yet
+    // Stroke-based while the canvas renders from getStrokes(); the engine's
+    // addEllipse draws a real ellipse through the vertex/GPU buffers
     const centerX = (this.startPoint.x + this.currentPoint.x) / 2;
     const centerY = (this.startPoint.y + this.currentPoint.y) / 2;
     const radiusX = Math.abs(this.currentPoint.x - this.startPoint.x) / 2;
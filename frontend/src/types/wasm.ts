@@ -29,7 +29,14 @@ export interface WASMRectangleShape extends WASMBaseShape {
   bottomRight: WASMPoint;
 }
 
-export type WASMShape = WASMStrokeShape | WASMRectangleShape;
+export interface WASMEllipseShape extends WASMBaseShape {
+  type: "ellipse";
+  center: WASMPoint;
+  radiusX: number;
+  radiusY: number;
+}
+
+export type WASMShape = WASMStrokeShape | WASMRectangleShape | WASMEllipseShape;
 
 // Legacy interface for backward compatibility
 export interface WASMStroke {
@@ -38,20 +45,235 @@ export interface WASMStroke {
   thickness: number;
 }
 
+export interface WASMAABB {
+  minX: number;
+  minY: number;
+  maxX: number;
+  maxY: number;
+}
+
+// Byte span to re-upload with GPUQueue.writeBuffer
+export interface WASMDirtyRange {
+  offset: number;
+  size: number;
+}
+
+export interface WASMGpuBufferUpdate {
+  vertexRanges: { size(): number; get(i: number): WASMDirtyRange };
+  drawCommandRanges: { size(): number; get(i: number): WASMDirtyRange };
+  vertexByteLength: number;
+  drawCommandByteLength: number;
+  fullUpload: boolean;
+}
+
+// Embind enum members (Module.JoinStyle.Round, Module.CapStyle.Butt, ...)
+export interface WASMEnumValue {
+  value: number;
+}
+
+export interface WASMTessellationStyle {
+  join: WASMEnumValue;
+  cap: WASMEnumValue;
+  miterLimit: number;
+  arcTolerance: number;
+}
+
+// x' = a*x + c*y + tx, y' = b*x + d*y + ty (canvas setTransform order)
+export interface WASMAffine {
+  a: number;
+  b: number;
+  c: number;
+  d: number;
+  tx: number;
+  ty: number;
+}
+
+// Operational transform core (backend/src/implement/OperationalTransform).
+// Payloads stay in JS under `payload`; user and stroke ids are interned
+// integers, versions and stroke ids BigInt.
+export interface WASMOperation {
+  version: bigint;
+  baseVersion: bigint;
+  timestamp: bigint;
+  strokeId: bigint;
+  userId: number;
+  payload: number;
+  type: WASMEnumValue; // Module.OperationType.StrokeUpdate, ...
+  transforms: number;
+}
+
+export interface WASMOperationVector {
+  size(): number;
+  get(i: number): WASMOperation;
+  push_back(op: WASMOperation): void;
+  set(i: number, op: WASMOperation): boolean;
+}
+
+// One room's versioned ring log; null means the base version is outside
+// the window and the client has to resync
+export interface WASMOperationLog {
+  process(op: WASMOperation): WASMOperation | null;
+  append(op: WASMOperation): boolean;
+  since(version: bigint): WASMOperationVector | null;
+  currentVersion(): bigint;
+  oldestVersion(): bigint;
+  size(): number;
+  canTransform(baseVersion: bigint): boolean;
+  reset(currentVersion: bigint): void;
+}
+
+// CRDT document mode (backend/src/implement/CrdtDocument). Shapes are keyed
+// by Lamport ids; edits go through the document, which drives the engine.
+// Op packets are opaque bytes: send takeOps() output, feed received packets
+// to applyOps() in any order.
+export interface WASMElementId {
+  counter: bigint;
+  replica: number;
+}
+
+export interface WASMCrdtDocument {
+  replicaId(): number;
+  clock(): bigint;
+  // Points as flat [x0, y0, x1, y1, ...] in the shape's own space
+  createStroke(color: WASMColor, thickness: number, xy: Float32Array): WASMElementId;
+  createRectangle(topLeft: WASMPoint, bottomRight: WASMPoint, color: WASMColor, thickness: number): WASMElementId;
+  createEllipse(center: WASMPoint, radiusX: number, radiusY: number, color: WASMColor, thickness: number): WASMElementId;
+  appendPoints(stroke: WASMElementId, xy: Float32Array): boolean;
+  setColor(shape: WASMElementId, color: WASMColor): boolean;
+  setThickness(shape: WASMElementId, thickness: number): boolean;
+  setTransform(shape: WASMElementId, transform: WASMAffine): boolean;
+  moveShape(shape: WASMElementId, dx: number, dy: number): boolean;
+  deleteShape(shape: WASMElementId): boolean;
+  applyOps(bytes: Uint8Array): number;
+  takeOps(): Uint8Array;
+  hasPendingOps(): boolean;
+  encodeState(): Uint8Array;
+  hasShape(shape: WASMElementId): boolean;
+  shapeCount(): number;
+  getShapeIds(): { size(): number; get(i: number): WASMElementId };
+  engineId(shape: WASMElementId): bigint;
+  elementId(id: bigint): WASMElementId; // counter 0n if unknown
+  getTransform(shape: WASMElementId): WASMAffine;
+}
+
 export interface DrawingEngineWASM {
   // New polymorphic shape methods
   addShape(shape: WASMShape): void;
   removeShape(index: number): void;
   moveShape(index: number, dx: number, dy: number): void;
 
+  // Engine-drawn rectangles and ellipses (outlines in the vertex/GPU buffers)
+  addRectangle(
+    topLeft: WASMPoint,
+    bottomRight: WASMPoint,
+    color: WASMColor,
+    thickness: number,
+  ): bigint;
+  addEllipse(
+    center: WASMPoint,
+    radiusX: number,
+    radiusY: number,
+    color: WASMColor,
+    thickness: number,
+  ): bigint;
+
   // Legacy methods for backward compatibility
   addStroke(stroke: WASMStroke): void;
   addPointToStroke(strokeIndex: number, point: WASMPoint): void;
   removeStroke(index: number): void;
   moveStroke(index: number, dx: number, dy: number): void;
 
+  // Stable-ID methods (ids are 64-bit and arrive as BigInt)
+  hasShape(id: bigint): boolean;
+  addPointToStrokeById(id: bigint, point: WASMPoint): boolean;
+  removeShapeById(id: bigint): boolean;
+  moveShapeById(id: bigint, dx: number, dy: number): boolean;
+  simplifyStrokeById(id: bigint, epsilon: number): boolean;
+  beginStrokeSimplification(id: bigint, epsilon: number): boolean;
+  endStrokeSimplification(id: bigint): boolean;
+  getStrokeId(strokeIndex: number): bigint;
+
+  // Spatial queries (results are ShapeIdVectors)
+  queryRect(rect: WASMAABB): { size(): number; get(i: number): bigint };
+  hitTest(
+    x: number,
+    y: number,
+    radius: number,
+  ): { size(): number; get(i: number): bigint };
+  getShapeBounds(id: bigint): WASMAABB;
+  // Union of every shape's bounds, O(1); minX > maxX on an empty board
+  getBoardBounds(): WASMAABB;
+
+  // Selection; bulk edits return the number of shapes changed and undo as
+  // one step. selectByLasso takes the polygon as flat [x0, y0, x1, y1, ...]
+  selectByRect(rect: WASMAABB, additive: boolean): number;
+  selectByLasso(xy: Float32Array, additive: boolean): number;
+  selectIds(ids: { size(): number; get(i: number): bigint }, additive: boolean): number;
+  clearSelection(): void;
+  getSelection(): { size(): number; get(i: number): bigint };
+  moveSelection(dx: number, dy: number): number;
+  transformSelection(transform: WASMAffine): number;
+  recolorSelection(color: WASMColor): number;
+  deleteSelection(): number;
+
+  // Incremental GPU buffers
+  takeGpuBufferUpdate(): WASMGpuBufferUpdate;
+  getGpuVertexView(): Float32Array;
+  getGpuDrawCommandView(): Uint32Array;
+
   // Common methods
   clear(): void;
   getStrokes(): WASMStroke[];
   getVertexBufferData(): number[];
+
+  // Zero-copy vertex export (views are invalidated when the generation changes)
+  getVertexBufferView(): Float32Array;
+  getViewGeneration(): number;
+  getContentVersion(): bigint;
+
+  // Viewport-culled, level-of-detail output (zoom = screen pixels per world unit)
+  getVertexBufferDataForViewport(viewport: WASMAABB, zoom: number): number[];
+  getVertexBufferViewForViewport(viewport: WASMAABB, zoom: number): Float32Array;
+
+  // Batched mutations through a shared ring (see wasm/commandRing.ts)
+  initCommandRing(capacityWords: number): void;
+  getCommandRingView(): Uint32Array;
+  applyBatch(): number;
+  // NewStroke ids the last batch turned down (0 or already taken)
+  getRejectedStrokes(): { size(): number; get(i: number): bigint; delete(): void };
+  recolorShapeById(id: bigint, color: WASMColor): boolean;
+
+  // Lazy per-shape transforms, O(1) per call; bakeTransforms(true) folds
+  // in only those left alone since the previous call
+  transformShapeById(id: bigint, transform: WASMAffine): boolean;
+  scaleShapeById(id: bigint, sx: number, sy: number, cx: number, cy: number): boolean;
+  rotateShapeById(id: bigint, radians: number, cx: number, cy: number): boolean;
+  getShapeTransform(id: bigint): WASMAffine;
+  bakeTransforms(idleOnly: boolean): number;
+
+  // Undo/redo: off until a byte budget is set; a group undoes as one step
+  setHistoryBudget(bytes: number): void;
+  getHistoryBytes(): number;
+  undo(): boolean;
+  redo(): boolean;
+  canUndo(): boolean;
+  canRedo(): boolean;
+  beginHistoryGroup(): void;
+  endHistoryGroup(): void;
+  clearHistory(): void;
+
+  // Live point frames: apply a received packet in one call
+  applyPointFrames(bytes: Uint8Array): number;
+
+  // Binary board snapshots (quantum = point precision in world units)
+  saveSnapshot(quantum: number): Uint8Array;
+  loadSnapshot(bytes: Uint8Array): boolean;
+
+  // Triangulated strokes: [x, y, r, g, b, a] vertices + triangle indices
+  setTessellationStyle(style: WASMTessellationStyle): void;
+  getTessellationStyle(): WASMTessellationStyle;
+  getTessellationVertexView(): Float32Array;
+  getTessellationIndexView(): Uint32Array;
+  getStrokeMeshVertexView(id: bigint): Float32Array;
+  getStrokeMeshIndexView(id: bigint): Uint32Array;
 }
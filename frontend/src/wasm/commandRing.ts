@@ -0,0 +1,153 @@
+import type { DrawingEngineWASM, WASMColor } from "../types/wasm";
+
+// Opcodes and record layouts mirror backend/src/implement/DrawingEngine/CommandBuffer.hpp
+const CommandOp = {
+  Pad: 0,
+  NewStroke: 1,
+  AddPoint: 2,
+  Move: 3,
+  Delete: 4,
+  Recolor: 5,
+  Simplify: 6,
+} as const;
+type CommandOp = (typeof CommandOp)[keyof typeof CommandOp];
+
+const CONTROL_WORDS = 4;
+const WRITE_INDEX = 0;
+const READ_INDEX = 1;
+const CAPACITY = 2;
+const REJECTED = 3;
+
+// Writes packed mutation records straight into the engine's WASM-heap ring so
+// a whole burst of input or a remote backlog is applied by one applyBatch()
+// call instead of one embind call per mutation. When the ring fills up the
+// pending records are applied early and writing continues.
+//
+// Stroke ids are the caller's to pick. A NewStroke whose id is 0 or already
+// taken is rejected along with the rest of the batch's records for that id;
+// such ids are collected in rejected until the caller clears it.
+export class CommandRingWriter {
+  readonly rejected: bigint[] = [];
+  private engine: DrawingEngineWASM;
+  private words!: Uint32Array;
+  private floats!: Float32Array;
+  private generation = -1;
+
+  constructor(engine: DrawingEngineWASM, capacityWords = 1 << 16) {
+    this.engine = engine;
+    engine.initCommandRing(capacityWords);
+    this.refreshViews();
+  }
+
+  newStroke(id: bigint, color: WASMColor, thickness: number): void {
+    const at = this.reserve(CommandOp.NewStroke, 8, id);
+    this.putColor(at + 3, color);
+    this.floats[at + 7] = thickness;
+    this.commit(8);
+  }
+
+  addPoint(id: bigint, x: number, y: number): void {
+    this.idAndFloats(CommandOp.AddPoint, id, x, y);
+  }
+
+  move(id: bigint, dx: number, dy: number): void {
+    this.idAndFloats(CommandOp.Move, id, dx, dy);
+  }
+
+  remove(id: bigint): void {
+    this.reserve(CommandOp.Delete, 3, id);
+    this.commit(3);
+  }
+
+  recolor(id: bigint, color: WASMColor): void {
+    const at = this.reserve(CommandOp.Recolor, 7, id);
+    this.putColor(at + 3, color);
+    this.commit(7);
+  }
+
+  simplify(id: bigint, epsilon: number): void {
+    const at = this.reserve(CommandOp.Simplify, 4, id);
+    this.floats[at + 3] = epsilon;
+    this.commit(4);
+  }
+
+  // Applies everything written so far; returns how many records took effect
+  flush(): number {
+    const applied = this.engine.applyBatch();
+    this.refreshViews();
+    if (this.words[REJECTED] !== 0) {
+      const ids = this.engine.getRejectedStrokes();
+      for (let i = 0; i < ids.size(); i++) this.rejected.push(ids.get(i));
+      ids.delete();
+    }
+    return applied;
+  }
+
+  private idAndFloats(op: CommandOp, id: bigint, a: number, b: number): void {
+    const at = this.reserve(op, 5, id);
+    this.floats[at + 3] = a;
+    this.floats[at + 4] = b;
+    this.commit(5);
+  }
+
+  // Word index (into this.words) where the record starts
+  private reserve(op: CommandOp, length: number, id: bigint): number {
+    for (;;) {
+      if (this.words.buffer.byteLength === 0) this.refreshViews();
+      const words = this.words;
+      const capacity = words[CAPACITY];
+      if (length >= capacity) throw new Error("Command ring too small");
+      const write = words[WRITE_INDEX];
+      const read = words[READ_INDEX];
+      let start = -1;
+      if (read > write) {
+        if (read - write > length) start = write;
+      } else if (capacity - write < length) {
+        if (read > length) {
+          words[CONTROL_WORDS + write] = CommandOp.Pad | ((capacity - write) << 8);
+          words[WRITE_INDEX] = 0;
+          start = 0;
+        }
+      } else if (!(write + length === capacity && read === 0)) {
+        start = write;
+      }
+
+      if (start >= 0) {
+        const at = CONTROL_WORDS + start;
+        words[at] = op | (length << 8);
+        words[at + 1] = Number(id & 0xffffffffn);
+        words[at + 2] = Number((id >> 32n) & 0xffffffffn);
+        return at;
+      }
+      // Full: let the engine catch up, then try again
+      this.flush();
+    }
+  }
+
+  private commit(length: number): void {
+    const next = this.words[WRITE_INDEX] + length;
+    this.words[WRITE_INDEX] = next === this.words[CAPACITY] ? 0 : next;
+  }
+
+  private putColor(at: number, color: WASMColor): void {
+    this.floats[at] = color.r;
+    this.floats[at + 1] = color.g;
+    this.floats[at + 2] = color.b;
+    this.floats[at + 3] = color.a;
+  }
+
+  // Views die when the WASM heap grows, which only happens inside an engine
+  // call. flush() and the constructor ask the engine's generation; between
+  // them a detached buffer is enough to tell, without crossing into WASM.
+  private refreshViews(): void {
+    const generation = this.engine.getViewGeneration();
+    if (generation === this.generation) return;
+    this.words = this.engine.getCommandRingView();
+    this.floats = new Float32Array(
+      this.words.buffer,
+      this.words.byteOffset,
+      this.words.length,
+    );
+    this.generation = generation;
+  }
+}
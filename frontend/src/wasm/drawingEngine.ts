@@ -218,6 +218,31 @@ class DrawingEngineBridge {
     return this.engine.getVertexBufferData();
   }
 
+  // Zero-copy alternative to getVertexBufferData: a Float32Array aliasing the
+  // WASM heap that can go straight to GPUQueue.writeBuffer. The view is only
+  // valid until the next engine call, so it is re-created whenever the
+  // engine's view generation moves on.
+  private vertexView: Float32Array | null = null;
+  private vertexViewGeneration = -1;
+  private vertexViewVersion = -1n;
+
+  getVertexBufferView(): Float32Array {
+    if (!this.isReady()) throw new Error("WASM not loaded");
+    const version: bigint = this.engine.getContentVersion();
+    const generation: number = this.engine.getViewGeneration();
+    if (
+      this.vertexView === null ||
+      version !== this.vertexViewVersion ||
+      generation !== this.vertexViewGeneration
+    ) {
+      this.vertexView = this.engine.getVertexBufferView();
+      this.vertexViewVersion = version;
+      // Rebuilding may have moved the buffer, so read the generation again
+      this.vertexViewGeneration = this.engine.getViewGeneration();
+    }
+    return this.vertexView as Float32Array;
+  }
+
   // Polymorphic shape methods
   addShape(shape: WASMShape): void {
     if (shape.type === "stroke") {
@@ -228,7 +253,8 @@ class DrawingEngineBridge {
         thickness: strokeShape.thickness,
       });
     } else if (shape.type === "rectangle") {
-      // For now, convert rectangle to stroke since rectangle shapes aren't implemented in WASM yet
+      // Kept as a stroke while the canvas renders from getStrokes(); the
+      // engine's addRectangle draws it through the vertex/GPU buffers instead
       const rectShape = shape as {
         topLeft: { x: number; y: number };
         bottomRight: { x: number; y: number };